@@ -1,5 +1,8 @@
 QT += core
 
+# 公共头文件用到了 std::index_sequence、if constexpr 和折叠表达式
+CONFIG += c++17
+
 # 之前把xxx xxx.h xxx.cpp（比如QScriptEngine QScriptEngine.h QScriptEngine.cpp）放在一起时，会出现下面的问题
 # 包含此项目后，在linux下编译时，可能会出现 XXXX: No such file or directory的问题
 # 查看编译输出可以看到，主要是因为在编译scriptEngine文件夹中的某些cpp文件时，编译器直接试图将其编译成可执行文件
@@ -29,7 +32,13 @@ INCLUDEPATH += $$PWD/scriptEngine/include
         $$PWD/scriptEngine/QScriptValueIterator.cpp \
         $$PWD/scriptEngine/QScriptEngineAgent.cpp \
         $$PWD/scriptEngine/QScriptContextInfo.cpp \
-        $$PWD/scriptEngine/QScriptSyntaxCheckResult.cpp
+        $$PWD/scriptEngine/QScriptSyntaxCheckResult.cpp \
+        $$PWD/scriptEngine/QScriptProgram.cpp \
+        $$PWD/scriptEngine/QScriptEnginePool.cpp \
+        $$PWD/scriptEngine/QScriptTimerWheel.cpp \
+        $$PWD/scriptEngine/QScriptString.cpp \
+        $$PWD/scriptEngine/QScriptClass.cpp \
+        $$PWD/scriptEngine/QScriptClassPropertyIterator.cpp
 
 
 HEADERS += \
@@ -46,7 +55,14 @@ HEADERS += \
     $$PWD/scriptEngine/include/QScriptValueIterator.h \
     $$PWD/scriptEngine/include/QScriptEngineAgent.h \
     $$PWD/scriptEngine/include/QScriptContextInfo.h \
-    $$PWD/scriptEngine/include/QScriptSyntaxCheckResult.h
+    $$PWD/scriptEngine/include/QScriptSyntaxCheckResult.h \
+    $$PWD/scriptEngine/include/QScriptProgram.h \
+    $$PWD/scriptEngine/include/QScriptEnginePool.h \
+    $$PWD/scriptEngine/include/QScriptTimerWheel.h \
+    $$PWD/scriptEngine/include/QScriptTypedFunction.h \
+    $$PWD/scriptEngine/include/QScriptString.h \
+    $$PWD/scriptEngine/include/QScriptClass.h \
+    $$PWD/scriptEngine/include/QScriptClassPropertyIterator.h
 
 
 win32: {
@@ -70,4 +86,18 @@ win32: {
 }
 
 # 还是直接固定使用吧。否则在window下使用mingw时，又被钻了空子
+# 这里定义的 EMSCRIPTEN 只是为了让上面那段判断得到 DIRECT_DISPATCH 0，并不是在为 Emscripten 编译：
+# Emscripten 编译器自己定义的是 __EMSCRIPTEN__，quickjs 中真正的平台相关代码用的也是它。
+# 升级 quickjs 子模块时需要确认 quickjs.c 中 defined(EMSCRIPTEN) 仍然只出现在 DIRECT_DISPATCH 这一处
+#
+# 如果不需要 QScriptEngineAgent 的逐指令回调（positionChange），可以在 .pro 中 include 本文件之前加上
+#   CONFIG += qscript_fast_dispatch
+# 这样就不会定义 EMSCRIPTEN，quickjs.c 在gcc/clang下会使用 computed goto（DIRECT_DISPATCH 1），解释器更快。
+# 此时agent仍然可以收到 scriptLoad/functionEntry/functionExit/exceptionThrow，但收不到 positionChange，
+# setAgent() 时会输出警告。两种分派的差别可以用 tests/benchmarks/dispatch 测量。
+# MSVC 没有 computed goto，本来就是 DIRECT_DISPATCH 0，这个选项在MSVC下不起作用，positionChange 照常可用
+qscript_fast_dispatch:!msvc {
+    DEFINES += QSCRIPT_FAST_DISPATCH
+} else {
     DEFINES += EMSCRIPTEN
+}
@@ -0,0 +1,67 @@
+﻿#include <QScriptClass>
+#include <QScriptClassPropertyIterator>
+#include <QScriptEngine>
+
+QScriptClass::QScriptClass(QScriptEngine *engine)
+    : m_engine(engine)
+{
+}
+
+QScriptClass::~QScriptClass()
+{
+}
+
+QScriptEngine *QScriptClass::engine() const
+{
+    return m_engine;
+}
+
+QScriptClass::QueryFlags QScriptClass::queryProperty(const QScriptValue &object, const QScriptString &name,
+                                                     QueryFlags flags, uint *id)
+{
+    Q_UNUSED(object);
+    Q_UNUSED(name);
+    Q_UNUSED(flags);
+    Q_UNUSED(id);
+    return QueryFlags();
+}
+
+QScriptValue QScriptClass::property(const QScriptValue &object, const QScriptString &name, uint id)
+{
+    Q_UNUSED(object);
+    Q_UNUSED(name);
+    Q_UNUSED(id);
+    return QScriptValue();
+}
+
+void QScriptClass::setProperty(QScriptValue &object, const QScriptString &name, uint id, const QScriptValue &value)
+{
+    Q_UNUSED(object);
+    Q_UNUSED(name);
+    Q_UNUSED(id);
+    Q_UNUSED(value);
+}
+
+QScriptValue::PropertyFlags QScriptClass::propertyFlags(const QScriptValue &object, const QScriptString &name, uint id)
+{
+    Q_UNUSED(object);
+    Q_UNUSED(name);
+    Q_UNUSED(id);
+    return QScriptValue::PropertyFlags();
+}
+
+QScriptClassPropertyIterator *QScriptClass::newIterator(const QScriptValue &object)
+{
+    Q_UNUSED(object);
+    return nullptr;
+}
+
+QScriptValue QScriptClass::prototype() const
+{
+    return QScriptValue();
+}
+
+QString QScriptClass::name() const
+{
+    return QString();
+}
@@ -0,0 +1,25 @@
+﻿#include <QScriptClassPropertyIterator>
+
+QScriptClassPropertyIterator::QScriptClassPropertyIterator(const QScriptValue &object)
+    : m_object(object)
+{
+}
+
+QScriptClassPropertyIterator::~QScriptClassPropertyIterator()
+{
+}
+
+QScriptValue QScriptClassPropertyIterator::object() const
+{
+    return m_object;
+}
+
+uint QScriptClassPropertyIterator::id() const
+{
+    return 0;
+}
+
+QScriptValue::PropertyFlags QScriptClassPropertyIterator::flags() const
+{
+    return QScriptValue::PropertyFlags();
+}
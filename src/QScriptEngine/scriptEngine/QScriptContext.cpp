@@ -17,16 +17,36 @@ QScriptContext::QScriptContext(JSContext *ctx,
     m_engine(engine),
     m_callee(callee)
 {
+    m_ownedArgs.reserve(argc);
     for (int i = 0; i < argc; ++i) {
-        m_args.push_back(JS_DupValue(ctx, argv[i]));
+        m_ownedArgs.append(JS_DupValue(ctx, argv[i]));
     }
+    m_argv = m_ownedArgs.constData();
+    m_argc = argc;
+}
+
+QScriptContext::QScriptContext(BorrowArgumentsTag,
+                               JSContext *ctx,
+                               JSValueConst this_val,
+                               int argc,
+                               JSValueConst *argv,
+                               QScriptEngine *engine,
+                               JSValueConst callee)
+    : m_ctx(ctx),
+    m_this(this_val),
+    m_argv(argv),
+    m_argc(argc),
+    m_ownsThis(false),
+    m_engine(engine),
+    m_callee(callee)
+{
 }
 
 QScriptContext::~QScriptContext()
 {
     if(m_ctx)
     {
-        if (!JS_IsUndefined(m_this) && !JS_IsNull(m_this)) {
+        if (m_ownsThis && !JS_IsUndefined(m_this) && !JS_IsNull(m_this)) {
             JS_FreeValue(m_ctx, m_this);
         }
 
@@ -35,8 +55,9 @@ QScriptContext::~QScriptContext()
             m_activation = JS_UNDEFINED;
         }
 
-        for (int i = 0; i < m_args.size(); ++i) {
-            JS_FreeValue(m_ctx, m_args.at(i));
+        // 借用模式下 m_ownedArgs 为空
+        for (int i = 0; i < m_ownedArgs.size(); ++i) {
+            JS_FreeValue(m_ctx, m_ownedArgs.at(i));
         }
     }
 }
@@ -64,10 +85,10 @@ QScriptValue QScriptContext::argumentsObject() const
 {
     if (!m_ctx)
         return QScriptValue();
-    uint32_t n = (uint32_t)m_args.size();
+    uint32_t n = (uint32_t)m_argc;
     JSValue arr = JS_NewArray(m_ctx);
     for (uint32_t i = 0; i < n; ++i) {
-        JS_SetPropertyUint32(m_ctx, arr, i, JS_DupValue(m_ctx, m_args[i]));
+        JS_SetPropertyUint32(m_ctx, arr, i, JS_DupValue(m_ctx, m_argv[i]));
     }
 
     auto qVal = QScriptValue(m_ctx, arr, m_engine);
@@ -118,13 +139,15 @@ void QScriptContext::setThisObject(const QScriptValue &thisObject)
 {
     if (!m_ctx)
         return;
-    if (!JS_IsUndefined(m_this) && !JS_IsNull(m_this)) {
+    if (m_ownsThis && !JS_IsUndefined(m_this) && !JS_IsNull(m_this)) {
         JS_FreeValue(m_ctx, m_this);
     }
     if (thisObject.isValid())
         m_this = JS_DupValue(m_ctx, thisObject.rawValue());
     else
         m_this = JS_UNDEFINED;
+    // 新的 this 总是自己持有引用
+    m_ownsThis = true;
 }
 
 QScriptContext::ExecutionState QScriptContext::state() const
@@ -136,19 +159,19 @@ QScriptContext::ExecutionState QScriptContext::state() const
 
 QScriptValue QScriptContext::argument(int index) const
 {
-    if (!m_ctx || index < 0 || index >= (int)m_args.size())
+    if (!m_ctx || index < 0 || index >= m_argc)
         return QScriptValue();
 
-    // auto str = JS_ToCString(m_ctx, m_args[index]);
-    // qDebug() << "argv:" << index << str << JS_IsObject(m_args[index]);
+    // auto str = JS_ToCString(m_ctx, m_argv[index]);
+    // qDebug() << "argv:" << index << str << JS_IsObject(m_argv[index]);
     // JS_FreeCString(m_ctx, str);
 
-    return QScriptValue(m_ctx, m_args[index], m_engine);
+    return QScriptValue(m_ctx, m_argv[index], m_engine);
 }
 
 int QScriptContext::argumentCount() const
 {
-    return (int)m_args.size();
+    return m_argc;
 }
 
 QStringList QScriptContext::backtrace() const
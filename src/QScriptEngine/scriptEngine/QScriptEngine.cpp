@@ -2,16 +2,45 @@
 #include <QScriptValue>
 #include <QScriptContext>
 #include <QScriptEngineAgent>
+#include <QScriptTimerWheel>
+#include <QScriptClass>
+#include <QScriptClassPropertyIterator>
 #include <QMetaProperty>
+#include <QPointer>
 
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QSysInfo>
+#include <QThread>
+#include <QRecursiveMutex>
+#include <QFutureInterface>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QCoreApplication>
+#include <QEvent>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
 
 #include <mutex>
 #include <vector>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <memory>
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#else
+#include <time.h>
+#endif
 
 extern "C" {
 #include "quickjs.h"
@@ -86,11 +115,113 @@ inline JSCFunctionListEntry JS_OBJECT_DEF_CPP(const char* name, const JSCFunctio
     return entry;
 }
 
+// 模块字节码缓存
+// 缓存文件名为 <模块路径hash>-<源码/模块名/引擎版本hash>.qjsc
+// 源码或者引擎版本变化后key就会变化，旧的缓存文件在写入新缓存时被删除
+static QString moduleCachePrefix(const QString &absolutePath)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(absolutePath.toUtf8(),
+                                                        QCryptographicHash::Sha1).toHex().left(16));
+}
+
+static QString moduleCacheFileName(const QString &absolutePath,
+                                   const char *module_name,
+                                   const QByteArray &content)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(content);
+    hash.addData(QByteArray(1, '\0'));
+    // 字节码中记录了模块名，因此也要加入key
+    hash.addData(QByteArray(module_name));
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(QByteArray(JS_GetVersion()));
+    hash.addData(QSysInfo::buildAbi().toLatin1());
+
+    return moduleCachePrefix(absolutePath)
+           + "-"
+           + QString::fromLatin1(hash.result().toHex())
+           + ".qjsc";
+}
+
+static JSModuleDef *readCachedModule(JSContext *ctx, const QString &cacheFile)
+{
+    QFile file(cacheFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    QByteArray buf = file.readAll();
+    file.close();
+
+    JSValue obj = JS_ReadObject(ctx,
+                                reinterpret_cast<const uint8_t *>(buf.constData()),
+                                buf.size(),
+                                JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(obj) || JS_VALUE_GET_TAG(obj) != JS_TAG_MODULE)
+    {
+        // 缓存损坏，丢弃并重新编译
+        if (JS_IsException(obj))
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        else
+            JS_FreeValue(ctx, obj);
+
+        QFile::remove(cacheFile);
+        return nullptr;
+    }
+
+    JSModuleDef *m = static_cast<JSModuleDef *>JS_VALUE_GET_PTR(obj);
+    JS_FreeValue(ctx, obj);
+    return m;
+}
+
+static void writeCachedModule(JSContext *ctx,
+                              JSValueConst moduleVal,
+                              const QString &cacheDir,
+                              const QString &cacheFile,
+                              const QString &prefix)
+{
+    size_t size = 0;
+    uint8_t *buf = JS_WriteObject(ctx, &size, moduleVal, JS_WRITE_OBJ_BYTECODE);
+    if (!buf)
+    {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return;
+    }
+
+    QDir().mkpath(cacheDir);
+
+    // QSaveFile 先写临时文件再重命名，多个引擎同时写也不会读到半个文件
+    QSaveFile file(cacheFile);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(reinterpret_cast<const char *>(buf), (qint64)size);
+        if (!file.commit())
+        {
+            qWarning() << "Failed to write module cache:" << cacheFile;
+        }
+    }
+    js_free(ctx, buf);
+
+    // 删除同一模块的过期缓存
+    QDir dir(cacheDir);
+    const QStringList stale = dir.entryList(QStringList() << prefix + "-*.qjsc", QDir::Files);
+    for (const QString &name : stale)
+    {
+        QString path = dir.filePath(name);
+        if (QFileInfo(path) != QFileInfo(cacheFile))
+        {
+            QFile::remove(path);
+        }
+    }
+}
+
 // 读取本地模块加载函数
 static JSModuleDef *js_module_loader_qt(JSContext *ctx,
                                         const char *module_name,
                                         void *opaque) {
-    QScriptEngine *engine = static_cast<QScriptEngine*>(opaque);
+    Q_UNUSED(opaque);
+
+    // 共享runtime的多个引擎使用同一个加载器，通过context找到引擎
+    QScriptEngine *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
     if (!engine) return nullptr;
 
     QString moduleName(module_name);
@@ -195,6 +326,17 @@ static JSModuleDef *js_module_loader_qt(JSContext *ctx,
     QByteArray content = file.readAll();
     file.close();
 
+    // 优先使用字节码缓存
+    QString cacheDir = engine->moduleCacheDirectory();
+    QString cacheFile;
+    if (!cacheDir.isEmpty()) {
+        cacheFile = QDir(cacheDir).filePath(moduleCacheFileName(absolutePath, module_name, content));
+        JSModuleDef *cached = readCachedModule(ctx, cacheFile);
+        if (cached) {
+            return cached;
+        }
+    }
+
     // 编译并执行模块
     JSValue val = JS_Eval(ctx,
                           content.constData(),
@@ -207,6 +349,10 @@ static JSModuleDef *js_module_loader_qt(JSContext *ctx,
         return nullptr;
     }
 
+    if (!cacheFile.isEmpty()) {
+        writeCachedModule(ctx, val, cacheDir, cacheFile, moduleCachePrefix(absolutePath));
+    }
+
     // 获取并返回模块对象
     JSModuleDef *m = static_cast<JSModuleDef *>JS_VALUE_GET_PTR(val);
     JS_FreeValue(ctx, val);
@@ -215,83 +361,48 @@ static JSModuleDef *js_module_loader_qt(JSContext *ctx,
 
 // 下面这堆操作是为了实现 QScriptEngine::ScriptOwnership
 // 当指定 ownership 为 QScriptEngine::ScriptOwnership时，脚本引擎在合适的时候释放掉QObject资源
-struct ObjectProp
+// 同一个 QMetaObject 的所有包装对象共用的绑定信息
+// 包装对象上什么都不定义，属性和方法由包装类的exotic回调在第一次访问时按名字解析，
+// 解析结果按atom缓存，方法对应的JS函数也只创建一次，因此包装一个对象只需要分配一个JS对象
+struct QScriptMetaObjectMember
 {
-    QObject *object = nullptr;
-    QMetaProperty prop;
-
-    QVariant read()
-    {
-        return prop.read(object);
-    }
-
-    bool write(QVariant var)
-    {
-        return prop.write(object, var);
-    }
+    enum Kind { None, Property, Method, Signal };
+    Kind kind{None};
+    int index{-1};                      // 属性的下标，信号的方法下标，或者方法在 QScriptEngine::methodOverloads() 中的下标
+    JSValue function{JS_UNDEFINED};     // 方法对应的JS函数
+    int directType{QMetaType::UnknownType}; // 可以直接通过 metacall 读写的属性类型
 };
-struct ObjectMethod
-{
-    QObject *object = nullptr;
-    QMetaMethod method;
-
-    QVariant invoke(QList<QGenericArgument> argList)
-    {
-        bool success = false;
-
-        QString var;
-        QGenericReturnArgument retVal = Q_RETURN_ARG(QString, var);
-
-        // QGenericReturnArgument retVal(method.typeName());
-
-        // Qt最多支持10个参数的，后面再补上
-        switch (argList.length()) {
-        case 0: // 添加无参数的情况
-            success = method.invoke(object, retVal);
-            break;
-        case 1:
-            success = method.invoke(object, retVal, argList[0]);
-            break;
-        case 2:
-            success = method.invoke(object, retVal, argList[0], argList[1]);
-            break;
-        case 3:
-            success = method.invoke(object, retVal, argList[0], argList[1], argList[2]);
-            break;
-        case 4:
-            success = method.invoke(object, retVal, argList[0], argList[1], argList[2], argList[3]);
-            break;
-        default:
-            break;
-        }
-
-        qDebug() << "success:" << success;
-
-        if(success == false)
-        {
-            return QVariant();
-        }
-
-        // 返回值这里还有问题，不能这样返
-        switch (method.returnType()) {
-        case QMetaType::QString:
-            return *(QString*)retVal.data();
-            break;
-        default:
-            break;
-        }
-
-        return QVariant();
-    }
 
+// 同一个 QMetaObject 按不同的 QObjectWrapOptions 包装时各有一份
+struct QScriptMetaObjectBinding
+{
+    const QMetaObject *metaObject{nullptr};
+    QScriptEngine::QObjectWrapOptions options;
+    // 包装对象的原型，没有对应成员的名字到这里查找
+    JSValue prototype{JS_UNDEFINED};
+    // 持有atom的引用
+    QHash<JSAtom, QScriptMetaObjectMember> members;
+    // 方法名 -> QScriptEngine::methodOverloads() 的下标，第一次查找方法时建立
+    QHash<QByteArray, int> methodSlots;
+    // 信号名 -> 方法下标，重载的信号取第一个
+    QHash<QByteArray, int> signalIndexes;
+    bool methodsIndexed{false};
+    // 用于枚举，第一次枚举时建立，持有atom的引用
+    QVector<JSAtom> memberNames;
+    bool namesIndexed{false};
 };
+
 // QObject wrapper for QuickJS opaque
+// 包装对象本身只记录目标对象，成员见 QScriptMetaObjectBinding
 struct QObjectWrapper {
-    QObject *obj;
-    QScriptEngine::ValueOwnership ownership;
-
-    QList<ObjectProp>   propList;
-    QList<ObjectMethod> methodList;
+    QPointer<QObject> obj;      // QObject 被删除后自动变为空
+    QScriptEngine::ValueOwnership ownership{QScriptEngine::QtOwnership};
+    QScriptMetaObjectBinding *binding{nullptr};
+
+    // 以 PreferExistingWrapperObject 创建、登记在引擎的包装对象缓存中时才有效
+    QScriptEngine *cacheOwner{nullptr};
+    QObject *cacheKey{nullptr};
+    JSValue self{JS_UNDEFINED};     // 不持有引用，包装对象被回收时从缓存中移除，使用前要检查 JS_IsLiveObject
 };
 static JSClassID s_qobjectClassId = 0;
 static void qobject_finalizer(JSRuntime *rt, JSValueConst val)
@@ -300,9 +411,10 @@ static void qobject_finalizer(JSRuntime *rt, JSValueConst val)
     if (!p)
         return;
 
-    qDebug() << "qobject_finalizer:------------>";
-
     QObjectWrapper *w = static_cast<QObjectWrapper*>(p);
+    if (w->cacheOwner) {
+        w->cacheOwner->removeCachedWrapper(w);
+    }
     if (w->ownership == QScriptEngine::ScriptOwnership) {
         if (w->obj) {
             // delete QObject immediately. In complex apps you might prefer deleteLater().
@@ -310,574 +422,3817 @@ static void qobject_finalizer(JSRuntime *rt, JSValueConst val)
             w->obj = nullptr;
         }
     }
-    // clear lists (no heap allocations for elements)
-    w->propList.clear();
-    w->methodList.clear();
 
     delete w;
     JS_SetOpaque(val, nullptr);
 }
 
-// 要明确知道什么时候该用JS_DupValue/JS_FreeValue，什么时候不该用
-// 不然就会出现 资源未释放/资源重复释放的问题
+// 调用 QMetaMethod 时一个参数（或返回值）的存储
+// 不超过 InlineSize 的类型直接在栈上构造，不经过 QVariant
+struct QScriptMetaArgument
+{
+    // MaxArguments 是调用时栈上预留的参数个数，更多参数的方法改在堆上分配
+    enum { InlineSize = 32, MaxArguments = 10 };
 
+    alignas(std::max_align_t) char buffer[InlineSize];
+    void *data{nullptr};
+    QMetaType type;
 
-// 中断函数，用于实现 abortEval
-static int custom_interrupt_handler(JSRuntime *rt, void *opaque) {
-    QScriptEngine *engine = static_cast<QScriptEngine*>(opaque);
-    if (!engine)
-        return 1;
+    QScriptMetaArgument() = default;
+    ~QScriptMetaArgument() { clear(); }
+    Q_DISABLE_COPY(QScriptMetaArgument)
 
-    // 检查中断标志
-    if (std::atomic_load(&engine->interrupt_flag)) {
-        // 可以在这里进行清理
-        qDebug() << "Interrupting script execution" << QDateTime::currentDateTime();
-        return 1;  // 返回1表示请求中断
+    // copy 为空时默认构造
+    bool construct(int typeId, const void *copy = nullptr)
+    {
+        clear();
+        type = QMetaType(typeId);
+        if (typeId == QMetaType::UnknownType || !type.isValid())
+            return false;
+
+        const int size = type.sizeOf();
+        void *where = (size <= InlineSize) ? static_cast<void *>(buffer) : ::operator new(size_t(size));
+        data = type.construct(where, copy);
+        if (!data && where != buffer)
+            ::operator delete(where);
+        return data != nullptr;
     }
-    return 0;
+
+    void clear()
+    {
+        if (!data)
+            return;
+        type.destruct(data);
+        if (data != buffer)
+            ::operator delete(data);
+        data = nullptr;
+    }
+};
+
+// null/undefined 以及不是包装对象的值得到 nullptr，不抛出异常
+static QObject *toQObject(JSContext *ctx, QScriptEngine *engine, JSValueConst value)
+{
+    if (!JS_IsObject(value) || !JS_GetOpaque(value, engine->qObjectClassId()))
+        return nullptr;
+    return engine->qobjectFromJSValue(ctx, value);
 }
 
-// 处理注册的c++函数
-static JSValue nativeFunctionShim(JSContext *ctx,
-                                  JSValueConst this_val,
-                                  int argc, JSValueConst *argv,
-                                  int magic)
+// 把JS值直接转换成 typeId 类型，内置类型不经过 QVariant
+static bool convertToMetaType(JSContext *ctx, QScriptEngine *engine, JSValueConst value, int typeId, QScriptMetaArgument &arg)
 {
-    // qDebug() << "magic:" << magic;
+    switch (typeId) {
+    case QMetaType::Int: {
+        int32_t v = 0;
+        if (JS_ToInt32(ctx, &v, value))
+            return false;
+        int i = v;
+        return arg.construct(typeId, &i);
+    }
+    case QMetaType::UInt: {
+        int64_t v = 0;
+        if (JS_ToInt64(ctx, &v, value))
+            return false;
+        uint u = uint(v);
+        return arg.construct(typeId, &u);
+    }
+    case QMetaType::LongLong: {
+        int64_t v = 0;
+        if (JS_ToInt64(ctx, &v, value))
+            return false;
+        qint64 i = v;
+        return arg.construct(typeId, &i);
+    }
+    case QMetaType::ULongLong: {
+        int64_t v = 0;
+        if (JS_ToInt64(ctx, &v, value))
+            return false;
+        quint64 u = quint64(v);
+        return arg.construct(typeId, &u);
+    }
+    case QMetaType::Double: {
+        double d = 0;
+        if (JS_ToFloat64(ctx, &d, value))
+            return false;
+        return arg.construct(typeId, &d);
+    }
+    case QMetaType::Float: {
+        double d = 0;
+        if (JS_ToFloat64(ctx, &d, value))
+            return false;
+        float f = float(d);
+        return arg.construct(typeId, &f);
+    }
+    case QMetaType::Bool: {
+        int b = JS_ToBool(ctx, value);
+        if (b < 0)
+            return false;
+        bool v = b != 0;
+        return arg.construct(typeId, &v);
+    }
+    case QMetaType::QString: {
+        QString str;
+        if (!JS_IsNull(value) && !JS_IsUndefined(value))
+        {
+            size_t len = 0;
+            const char *s = JS_ToCStringLen(ctx, &len, value);
+            if (!s)
+                return false;
+            str = QString::fromUtf8(s, int(len));
+            JS_FreeCString(ctx, s);
+        }
+        return arg.construct(typeId, &str);
+    }
+    case QMetaType::QVariant: {
+        QVariant v = QScriptValue(ctx, value, engine).toVariant();
+        return arg.construct(typeId, &v);
+    }
+    case QMetaType::QObjectStar: {
+        QObject *object = toQObject(ctx, engine, value);
+        return arg.construct(typeId, &object);
+    }
+    default:
+        break;
+    }
 
-    // retrieve the QScriptEngine associated with this JSContext
-    void *opaque = JS_GetContextOpaque(ctx);
-    QScriptEngine *engine = static_cast<QScriptEngine*>(opaque);
-    if (!engine)
-        return JS_UNDEFINED;
+    if (typeId == qMetaTypeId<QScriptValue>())
+    {
+        QScriptValue v(ctx, value, engine);
+        return arg.construct(typeId, &v);
+    }
 
-    // 检查中断标志
-    if (std::atomic_load(&engine->interrupt_flag)) {
-        auto value = JS_ThrowTypeError(ctx, "%s", "stop");
-        return value;
+    // 指向 QObject 子类的指针，类型不符时传空指针
+    QMetaType type(typeId);
+    if (type.flags() & QMetaType::PointerToQObject)
+    {
+        QObject *object = toQObject(ctx, engine, value);
+        const QMetaObject *expected = type.metaObject();
+        if (object && expected && !object->metaObject()->inherits(expected))
+            object = nullptr;
+        return arg.construct(typeId, &object);
     }
 
-    QScriptEngine::FunctionWithArgSignature func = nullptr;
-    void *arg = nullptr;
-    JSValue callee;
-    if (!engine->getNativeEntry(magic, func, &arg, callee))
+    // 其它注册过的类型经过 QVariant 转换
+    QVariant v = QScriptValue(ctx, value, engine).toVariant();
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    if (v.metaType() != type && !v.convert(type))
+        return false;
+#else
+    if (v.userType() != typeId && !v.convert(typeId))
+        return false;
+#endif
+    return arg.construct(typeId, v.constData());
+}
+
+// 把 typeId 类型的值直接转换成JS值，内置类型不经过 QVariant
+static JSValue metaTypeToJSValue(JSContext *ctx, QScriptEngine *engine, int typeId, const void *data)
+{
+    switch (typeId) {
+    case QMetaType::Void:
         return JS_UNDEFINED;
+    case QMetaType::Int:
+        return JS_NewInt32(ctx, *static_cast<const int *>(data));
+    case QMetaType::UInt:
+        return JS_NewUint32(ctx, *static_cast<const uint *>(data));
+    case QMetaType::LongLong:
+        return JS_NewInt64(ctx, *static_cast<const qint64 *>(data));
+    case QMetaType::ULongLong:
+        return JS_NewFloat64(ctx, double(*static_cast<const quint64 *>(data)));
+    case QMetaType::Double:
+        return JS_NewFloat64(ctx, *static_cast<const double *>(data));
+    case QMetaType::Float:
+        return JS_NewFloat64(ctx, *static_cast<const float *>(data));
+    case QMetaType::Bool:
+        return JS_NewBool(ctx, *static_cast<const bool *>(data));
+    case QMetaType::QString: {
+        const QByteArray utf8 = static_cast<const QString *>(data)->toUtf8();
+        return JS_NewStringLen(ctx, utf8.constData(), utf8.size());
+    }
+    case QMetaType::QVariant:
+        return QScriptValue::toJSValue(ctx, *static_cast<const QVariant *>(data));
+    default:
+        break;
+    }
 
-    // 进入函数
-    auto agent = engine->agent();
-    if(agent != nullptr)
+    if (typeId == qMetaTypeId<QScriptValue>())
     {
-        agent->functionEntry(-1);
+        const QScriptValue *v = static_cast<const QScriptValue *>(data);
+        return v->isVariant() ? QScriptValue::toJSValue(ctx, v->data()) : JS_DupValue(ctx, v->rawValue());
     }
 
-    QScriptContext qctx(ctx, this_val, argc, argv, engine, callee);
-    // detect whether function was called as constructor
-    bool calledAsCtor = JS_IsConstructor(ctx, this_val);
-    qctx.setCalledAsConstructor(calledAsCtor);
-    QScriptValue res = func(&qctx, engine, arg);
-
-    // 退出函数
-    if(agent != nullptr)
+    QMetaType type(typeId);
+    if (typeId == QMetaType::QObjectStar || (type.flags() & QMetaType::PointerToQObject))
     {
-        agent->functionExit(-1, res);
+        QObject *object = *static_cast<QObject * const *>(data);
+        if (!object)
+            return JS_NULL;
+        QScriptValue wrapper = engine->newQObject(object);
+        return JS_DupValue(ctx, wrapper.rawValue());
     }
 
-    // qDebug() << "the returnd val:"
-    //          << res.data()
-    //          << res.engine()
-    //          << JS_IsUndefined(res.rawValue())
-    //          << res.toString();
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return QScriptValue::toJSValue(ctx, QVariant(type, data));
+#else
+    return QScriptValue::toJSValue(ctx, QVariant(typeId, data));
+#endif
+}
 
-    // 假如返回值是普通值，需要构建成JSValue
-    if (res.isVariant()) {
-        return QScriptValue::toJSValue(ctx, res.data());
-    }
+// obj.someSignal 得到的信号对象，原型上有 connect/disconnect
+struct QScriptSignalHandle
+{
+    QPointer<QObject> sender;
+    int signalIndex{-1};
+};
+static JSClassID s_signalClassId = 0;
+static void signalFinalizer(JSRuntime *rt, JSValueConst val)
+{
+    Q_UNUSED(rt);
+    delete static_cast<QScriptSignalHandle*>(JS_GetOpaque(val, s_signalClassId));
+}
 
-    // 如果返回的是 undefined/null 或 无效值，且这是构造调用（new Foo()），
-    // 则应返回 thisObject()（遵循 Qt 的 QScriptBehavior）。
-    if (!res.isValid() || res.isUndefined()) {
-        // qDebug() << !res.isValid() << res.isUndefined();
-        if (qctx.isCalledAsConstructor()) {
-            QScriptValue thisObj = qctx.thisObject();
-            if (thisObj.isValid()) {
-                return JS_DupValue(ctx, thisObj.rawValue());
-            }
-        }
-        return JS_UNDEFINED;
-    }
+// 以下是QObject包装类的exotic回调
+// 包装对象自己定义过的属性（脚本赋值的动态属性）由QuickJS先查找，找不到时才进入这里
+static QObjectWrapper *qobjectWrapper(JSContext *ctx, JSValueConst obj, QScriptEngine **engine)
+{
+    *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
+    if (!*engine)
+        return nullptr;
+    return static_cast<QObjectWrapper*>(JS_GetOpaque(obj, (*engine)->qObjectClassId()));
+}
 
-    // 有效的 JS 值，直接 dup 并返回
-    auto val = JS_DupValue(ctx, res.rawValue());
-    return val;
+// int、double、bool、QString、qint64 类型的属性直接读写栈上的存储，不经过 QVariant
+static int directPropertyType(const QMetaProperty &prop)
+{
+    if (prop.isEnumType() || prop.isFlagType())
+        return QMetaType::UnknownType;
+
+    switch (prop.userType()) {
+    case QMetaType::Int:
+    case QMetaType::Double:
+    case QMetaType::Bool:
+    case QMetaType::QString:
+    case QMetaType::LongLong:
+        return prop.userType();
+    default:
+        return QMetaType::UnknownType;
+    }
 }
 
-// Adapter: wrap old FunctionSignature into FunctionWithArgSignature
-static QScriptValue functionSignatureAdapter(QScriptContext *context, QScriptEngine *engine, void *arg)
+// 参数的布局与 QMetaProperty::read() 相同
+static JSValue readPropertyDirect(JSContext *ctx, QScriptEngine *engine, QObject *object,
+                                  const QScriptMetaObjectMember &member)
 {
-    if (!arg)
-        return QScriptValue();
+    QScriptMetaArgument value;
+    if (!value.construct(member.directType))
+        return JS_ThrowInternalError(ctx, "cannot read property");
 
-    // arg stores the FunctionSignature as a pointer-sized value
-    auto sig = reinterpret_cast<QScriptEngine::FunctionSignature>(arg);
-    if (!sig)
-        return QScriptValue();
+    QVariant unused;
+    int status = -1;
+    void *argv[] = { value.data, &unused, &status };
+    QMetaObject::metacall(object, QMetaObject::ReadProperty, member.index, argv);
 
-    return sig(context, engine);
+    // 实现可以让 argv[0] 指向自己的存储
+    return metaTypeToJSValue(ctx, engine, member.directType, argv[0]);
 }
 
-QScriptEngine::QScriptEngine(QObject *parent)
-    : QObject(parent)
+// 写入被拒绝时，严格模式（JS_PROP_THROW）抛出 TypeError，否则返回0，与只读属性一样
+static int rejectPropertyWrite(JSContext *ctx, const QMetaProperty &prop, int flags)
 {
-    qRegisterMetaType<QScriptValue>();
-
-    m_rt = JS_NewRuntime();
-    if(!m_rt)
+    if (flags & JS_PROP_THROW)
     {
-        qCritical() << "create js runtime fail";
-        return;
+        JS_ThrowTypeError(ctx, "failed to set property '%s'", prop.name());
+        return -1;
     }
+    return 0;
+}
 
-    // // JS_SetMemoryLimit 设置堆的大小
-    // // JS_SetMaxStackSize 设置栈的大小
-    // // JS_SetGCThreshold 设置GC触发阈值的大小
-    // JS_SetMemoryLimit(m_rt, 0);
-    // JS_SetMaxStackSize(m_rt, 0);
-    // JS_SetGCThreshold(m_rt, -1);
-
+// 参数的布局与 QMetaProperty::write() 相同
+static int writePropertyDirect(JSContext *ctx, QScriptEngine *engine, QObject *object,
+                               const QScriptMetaObjectMember &member, JSValueConst value, int flags)
+{
+    const QMetaProperty prop = object->metaObject()->property(member.index);
 
-    m_ctx = JS_NewContext(m_rt);
-    if(!m_ctx)
+    QScriptMetaArgument arg;
+    if (!convertToMetaType(ctx, engine, value, member.directType, arg))
     {
-        qCritical() << "create js context fail";
-        JS_FreeRuntime(m_rt);
-        m_rt = nullptr;
-        return;
+        if (JS_HasException(ctx))
+            return -1;
+        JS_ThrowTypeError(ctx, "cannot convert value to %s for property '%s'", prop.typeName(), prop.name());
+        return -1;
     }
 
-    // associate C++ object with the QuickJS context
-    JS_SetContextOpaque(m_ctx, this);
+    // status 保持 -1 表示成功，实现可以把它置为0表示拒绝；metacall 返回非负数表示没有人处理这个属性
+    QVariant unused;
+    int status     = -1;
+    int writeFlags = 0;
+    void *argv[] = { arg.data, &unused, &status, &writeFlags };
+    if (QMetaObject::metacall(object, QMetaObject::WriteProperty, member.index, argv) >= 0 || status == 0)
+        return rejectPropertyWrite(ctx, prop, flags);
+    return 1;
+}
 
-    // 重置中断标志
-    std::atomic_store(&interrupt_flag, 0);
-    // 设置中断处理器
-    JS_SetInterruptHandler(m_rt, custom_interrupt_handler, this);
+// 读取成员的值，属性读取QObject，方法返回共用的函数
+static JSValue qobjectMemberValue(JSContext *ctx, QScriptEngine *engine, QObjectWrapper *w,
+                                  const QScriptMetaObjectMember &member)
+{
+    if (member.kind == QScriptMetaObjectMember::Method)
+        return JS_DupValue(ctx, member.function);
 
-    // 这样是实现对QObject对象的析构
-    // Register a QuickJS class to wrap QObject pointers
-    if (m_rt) {
-        JS_NewClassID(m_rt, &m_qobjectClassId);
-        s_qobjectClassId = m_qobjectClassId;
-        JSClassDef cd;
-        memset(&cd, 0, sizeof(cd));
-        cd.class_name = "QScriptQObject";
-        cd.finalizer = qobject_finalizer;
-        JS_NewClass(m_rt, m_qobjectClassId, &cd);
-    }
+    if (!w->obj)
+        return JS_ThrowTypeError(ctx, "cannot read property of a deleted QObject");
 
-    if(mCurCtx == nullptr)
+    if (member.kind == QScriptMetaObjectMember::Signal)
+        return engine->newSignalObject(w->obj, member.index);
+
+    if (member.directType != QMetaType::UnknownType)
+        return readPropertyDirect(ctx, engine, w->obj, member);
+
+    QMetaProperty prop = w->binding->metaObject->property(member.index);
+
+    // 枚举和标志读出的 QVariant 是枚举自己的类型，toJSValue 不认识，按整数返回
+    if (prop.isEnumType() || prop.isFlagType())
+        return JS_NewInt32(ctx, prop.read(w->obj).toInt());
+
+    return QScriptValue::toJSValue(ctx, prop.read(w->obj));
+}
+
+static int qobjectGetOwnProperty(JSContext *ctx, JSPropertyDescriptor *desc, JSValueConst obj, JSAtom prop)
+{
+    QScriptEngine *engine = nullptr;
+    QObjectWrapper *w = qobjectWrapper(ctx, obj, &engine);
+    if (!w)
+        return 0;
+
+    QScriptMetaObjectMember member = engine->metaObjectMember(w->binding, prop);
+    if (member.kind == QScriptMetaObjectMember::None)
+        return 0;
+
+    if (desc)
     {
-        mCurCtx = new QScriptContext(m_ctx, JS_UNDEFINED, 0, nullptr, this, JS_UNDEFINED);
+        JSValue value = qobjectMemberValue(ctx, engine, w, member);
+        if (JS_IsException(value))
+            return -1;
+
+        desc->flags = JS_PROP_CONFIGURABLE;
+        if (member.kind != QScriptMetaObjectMember::Property)
+        {
+            desc->flags |= JS_PROP_WRITABLE;
+            if (!(w->binding->options & QScriptEngine::SkipMethodsInEnumeration))
+                desc->flags |= JS_PROP_ENUMERABLE;
+        }
+        else
+        {
+            desc->flags |= JS_PROP_ENUMERABLE;
+            if (w->binding->metaObject->property(member.index).isWritable())
+                desc->flags |= JS_PROP_WRITABLE;
+        }
+        desc->value  = value;
+        desc->getter = JS_UNDEFINED;
+        desc->setter = JS_UNDEFINED;
     }
+    return 1;
+}
 
-    // GlobalObject
-    {
-        JSValue g = JS_GetGlobalObject(m_ctx);
+static int qobjectGetOwnPropertyNames(JSContext *ctx, JSPropertyEnum **ptab, uint32_t *plen, JSValueConst obj)
+{
+    *ptab = nullptr;
+    *plen = 0;
 
-        mGlobalObject = new QScriptValue(m_ctx, g, this);
+    QScriptEngine *engine = nullptr;
+    QObjectWrapper *w = qobjectWrapper(ctx, obj, &engine);
+    if (!w)
+        return 0;
 
-        // 这个不能调用释放，一旦释放会报错
-        // 这里奇怪得很，假如在debug模式，不执行释放的话，会导致报错：list_empty(&rt->gc_obj_list)
-        // 但是，在release时，假如加上了，又会报0xc000005错误,估计是重复释放
-        JS_FreeValue(m_ctx, g);
+    const QVector<JSAtom> &names = engine->metaObjectMemberNames(w->binding);
+    if (names.isEmpty())
+        return 0;
+
+    JSPropertyEnum *tab = static_cast<JSPropertyEnum*>(js_malloc(ctx, sizeof(JSPropertyEnum) * size_t(names.size())));
+    if (!tab)
+        return -1;
+
+    for (int i = 0; i < names.size(); ++i)
+    {
+        tab[i].is_enumerable = true;
+        tab[i].atom = JS_DupAtom(ctx, names.at(i));
     }
-    JS_SetModuleLoaderFunc(m_rt, nullptr, js_module_loader_qt, this); // 传递 this
+    *ptab = tab;
+    *plen = uint32_t(names.size());
+    return 0;
 }
 
-QScriptEngine::~QScriptEngine()
+// 不是元对象成员的名字：动态属性（AutoCreateDynamicProperties）和同名的子对象（没有 ExcludeChildObjects）
+// 与对象的状态有关，不能缓存；选项都关掉时不做任何额外的工作
+static bool qobjectDynamicMember(JSContext *ctx, QScriptEngine *engine, QObjectWrapper *w, JSAtom atom, JSValue *value)
 {
-    clearDefaultPrototypes(); // 首先清空存储的默认类型，不然会崩溃
-    
-    if(agent() != nullptr)
+    const QScriptEngine::QObjectWrapOptions options = w->binding->options;
+    const bool dynamicProperties = options & QScriptEngine::AutoCreateDynamicProperties;
+    const bool childObjects = !(options & QScriptEngine::ExcludeChildObjects);
+    if (!w->obj)
+        return false;
+    if (!dynamicProperties && (!childObjects || w->obj->children().isEmpty()))
+        return false;
+
+    const char *name = JS_AtomToCString(ctx, atom);
+    if (!name)
     {
-        // 这里会导致程序崩溃，后面再处理
-        // for (int i = 0; i < mFileNameBuffer.length(); ++i) {
-        //     agent()->scriptUnload(i);
-        // }
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return false;
     }
 
-    // 清理模块系统
-    m_moduleRegistry.clear();
-    JS_SetModuleLoaderFunc(m_rt, nullptr, nullptr, nullptr);
-    JS_SetInterruptHandler(m_rt, nullptr, nullptr);
-    
-    // 要先释放申请的资源，最后再释放引擎
-    if(mCurCtx != nullptr)
+    bool found = false;
+    if (dynamicProperties && w->obj->dynamicPropertyNames().contains(QByteArray(name)))
     {
-        delete mCurCtx;
-        mCurCtx = nullptr;
+        found = true;
+        if (value)
+            *value = QScriptValue::toJSValue(ctx, w->obj->property(name));
     }
-    if(mGlobalObject != nullptr)
+    else if (childObjects)
     {
-        delete mGlobalObject;
-        mGlobalObject = nullptr;
+        QObject *child = w->obj->findChild<QObject*>(QString::fromUtf8(name), Qt::FindDirectChildrenOnly);
+        if (child)
+        {
+            found = true;
+            if (value)
+            {
+                QScriptValue wrapper = engine->newQObject(child, QScriptEngine::QtOwnership, options);
+                *value = JS_DupValue(ctx, wrapper.rawValue());
+            }
+        }
     }
 
-    if (m_ctx) {
-        // clear context opaque to avoid dangling pointer
-        JS_SetContextOpaque(m_ctx, nullptr);
-        JS_FreeContext(m_ctx);
-        m_ctx = nullptr;
+    JS_FreeCString(ctx, name);
+    return found;
+}
+
+static int qobjectHasProperty(JSContext *ctx, JSValueConst obj, JSAtom atom)
+{
+    QScriptEngine *engine = nullptr;
+    QObjectWrapper *w = qobjectWrapper(ctx, obj, &engine);
+    if (!w)
+        return 0;
+
+    if (engine->metaObjectMember(w->binding, atom).kind != QScriptMetaObjectMember::None)
+        return 1;
+    if (qobjectDynamicMember(ctx, engine, w, atom, nullptr))
+        return 1;
+
+    // has_property 接管了整条原型链的查找：先查自己定义过的属性，再查原型
+    int ret = JS_GetOwnProperty(ctx, nullptr, obj, atom);
+    if (ret != 0)
+        return ret;
+    return JS_HasProperty(ctx, w->binding->prototype, atom);
+}
+
+static JSValue qobjectGetProperty(JSContext *ctx, JSValueConst obj, JSAtom atom, JSValueConst receiver)
+{
+    Q_UNUSED(receiver);
+
+    QScriptEngine *engine = nullptr;
+    QObjectWrapper *w = qobjectWrapper(ctx, obj, &engine);
+    if (!w)
+        return JS_UNDEFINED;
+
+    QScriptMetaObjectMember member = engine->metaObjectMember(w->binding, atom);
+    if (member.kind != QScriptMetaObjectMember::None)
+        return qobjectMemberValue(ctx, engine, w, member);
+
+    JSValue value = JS_UNDEFINED;
+    if (qobjectDynamicMember(ctx, engine, w, atom, &value))
+        return value;
+
+    // 不是QObject的成员（例如 toString），到原型上查找
+    return JS_GetProperty(ctx, w->binding->prototype, atom);
+}
+
+static int qobjectSetProperty(JSContext *ctx, JSValueConst obj, JSAtom atom, JSValueConst value, JSValueConst receiver, int flags)
+{
+    Q_UNUSED(receiver);
+
+    QScriptEngine *engine = nullptr;
+    QObjectWrapper *w = qobjectWrapper(ctx, obj, &engine);
+    if (!w)
+        return 0;
+
+    QScriptMetaObjectMember member = engine->metaObjectMember(w->binding, atom);
+    if (member.kind == QScriptMetaObjectMember::Property)
+    {
+        if (!w->obj)
+        {
+            JS_ThrowTypeError(ctx, "cannot set property of a deleted QObject");
+            return -1;
+        }
+
+        QMetaProperty prop = w->binding->metaObject->property(member.index);
+        if (!prop.isWritable())
+        {
+            if (flags & JS_PROP_THROW)
+            {
+                JS_ThrowTypeError(ctx, "property '%s' is read-only", prop.name());
+                return -1;
+            }
+            return 0;
+        }
+
+        if (member.directType != QMetaType::UnknownType)
+            return writePropertyDirect(ctx, engine, w->obj, member, value, flags);
+
+        // 脚本里的数字转换成 double，枚举和标志只接受整数（或者名字的字符串）
+        QVariant variant = QScriptValue(ctx, value, engine).toVariant();
+        if ((prop.isEnumType() || prop.isFlagType()) && variant.userType() == QMetaType::Double)
+            variant = QVariant(int(qint64(variant.toDouble())));
+
+        if (!prop.write(w->obj, variant))
+            return rejectPropertyWrite(ctx, prop, flags);
+        return 1;
     }
 
-    if (m_rt) {
-        JS_SetRuntimeOpaque(m_rt, nullptr);
-        JS_FreeRuntime(m_rt);
-        m_rt = nullptr;
+    // AutoCreateDynamicProperties：其它名字作为QObject的动态属性
+    if ((w->binding->options & QScriptEngine::AutoCreateDynamicProperties)
+        && member.kind == QScriptMetaObjectMember::None && w->obj)
+    {
+        const char *name = JS_AtomToCString(ctx, atom);
+        if (!name)
+            return -1;
+        w->obj->setProperty(name, QScriptValue(ctx, value, engine).toVariant());
+        JS_FreeCString(ctx, name);
+        return 1;
     }
+
+    // 其它名字（包括覆盖方法）作为包装对象自己的动态属性，之后由QuickJS直接找到
+    return JS_DefinePropertyValue(ctx, obj, atom, JS_DupValue(ctx, value), JS_PROP_C_W_E);
 }
 
-bool QScriptEngine::isEvaluating() const
+static JSClassExoticMethods s_qobjectExoticMethods;
+
+// QScriptClass 创建的对象，data 是 newObject() 的第二个参数
+struct QScriptClassObject
 {
-    return m_evalCount.load(std::memory_order_relaxed) > 0;
+    QScriptClass *scriptClass{nullptr};
+    JSValue data{JS_UNDEFINED};
+};
+
+// 每个 QScriptClass 各自是一个JS类，回调中按对象自己的类取 opaque
+static QScriptClassObject *scriptClassObject(JSContext *ctx, JSValueConst obj, QScriptEngine **engine)
+{
+    *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
+    if (!*engine)
+        return nullptr;
+    return static_cast<QScriptClassObject*>(JS_GetOpaque(obj, JS_GetClassID(obj)));
 }
 
-void QScriptEngine::abortEvaluation(const QScriptValue &result)
+static void scriptClassFinalizer(JSRuntime *rt, JSValueConst val)
 {
-    // if (!m_ctx)
-    //     return;
-    // JS_Throw(m_ctx, JS_DupValue(m_ctx, result.rawValue()));
+    QScriptClassObject *o = static_cast<QScriptClassObject*>(JS_GetOpaque(val, JS_GetClassID(val)));
+    if (!o)
+        return;
+    JS_FreeValueRT(rt, o->data);
+    delete o;
+}
 
-    std::atomic_store(&interrupt_flag, 1);
+static void scriptClassMark(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func)
+{
+    QScriptClassObject *o = static_cast<QScriptClassObject*>(JS_GetOpaque(val, JS_GetClassID(val)));
+    if (o)
+        JS_MarkValue(rt, o->data, mark_func);
 }
 
-void QScriptEngine::setAgent(QScriptEngineAgent *agent)
+static JSValue scriptValueToJS(JSContext *ctx, const QScriptValue &value)
 {
-    m_agent = agent;
+    return value.isVariant() ? QScriptValue::toJSValue(ctx, value.data()) : JS_DupValue(ctx, value.rawValue());
 }
 
-QScriptEngineAgent *QScriptEngine::agent() const
+// 以下是QScriptClass对象的exotic回调，属性在访问时才向C++查询
+// 回调中通过 QScriptContext 抛出的异常原样传给脚本
+static int scriptClassGetOwnProperty(JSContext *ctx, JSPropertyDescriptor *desc, JSValueConst obj, JSAtom atom)
 {
-    return m_agent;
+    QScriptEngine *engine = nullptr;
+    QScriptClassObject *o = scriptClassObject(ctx, obj, &engine);
+    if (!o)
+        return 0;
+
+    QScriptValue object(ctx, obj, engine);
+    QScriptString name(ctx, atom);
+    uint id = 0;
+    if (!(o->scriptClass->queryProperty(object, name, QScriptClass::HandlesReadAccess, &id) & QScriptClass::HandlesReadAccess))
+        return JS_HasException(ctx) ? -1 : 0;
+
+    if (desc)
+    {
+        const QScriptValue value = o->scriptClass->property(object, name, id);
+        if (JS_HasException(ctx))
+            return -1;
+
+        const QScriptValue::PropertyFlags flags = o->scriptClass->propertyFlags(object, name, id);
+        desc->flags = 0;
+        if (!(flags & QScriptValue::ReadOnly))
+            desc->flags |= JS_PROP_WRITABLE;
+        if (!(flags & QScriptValue::Undeletable))
+            desc->flags |= JS_PROP_CONFIGURABLE;
+        if (!(flags & QScriptValue::SkipInEnumeration))
+            desc->flags |= JS_PROP_ENUMERABLE;
+        desc->value  = scriptValueToJS(ctx, value);
+        desc->getter = JS_UNDEFINED;
+        desc->setter = JS_UNDEFINED;
+    }
+    return 1;
 }
 
-void QScriptEngine::collectGarbage()
+static int scriptClassGetOwnPropertyNames(JSContext *ctx, JSPropertyEnum **ptab, uint32_t *plen, JSValueConst obj)
 {
-    if (m_rt)
-        JS_RunGC(m_rt);
+    *ptab = nullptr;
+    *plen = 0;
+
+    QScriptEngine *engine = nullptr;
+    QScriptClassObject *o = scriptClassObject(ctx, obj, &engine);
+    if (!o)
+        return 0;
+
+    std::unique_ptr<QScriptClassPropertyIterator> it(o->scriptClass->newIterator(QScriptValue(ctx, obj, engine)));
+    if (!it)
+        return JS_HasException(ctx) ? -1 : 0;
+
+    QVector<JSPropertyEnum> names;
+    while (it->hasNext())
+    {
+        it->next();
+        const QScriptString name = it->name();
+        if (!name.isValid())
+            continue;
+
+        JSPropertyEnum entry;
+        entry.is_enumerable = !(it->flags() & QScriptValue::SkipInEnumeration);
+        entry.atom = JS_DupAtom(ctx, name.atom());
+        names.append(entry);
+    }
+
+    JSPropertyEnum *tab = nullptr;
+    if (!names.isEmpty() && !JS_HasException(ctx))
+    {
+        tab = static_cast<JSPropertyEnum*>(js_malloc(ctx, sizeof(JSPropertyEnum) * size_t(names.size())));
+    }
+    if (!tab)
+    {
+        for (const JSPropertyEnum &entry : std::as_const(names))
+        {
+            JS_FreeAtom(ctx, entry.atom);
+        }
+        return JS_HasException(ctx) ? -1 : 0;
+    }
+
+    memcpy(tab, names.constData(), sizeof(JSPropertyEnum) * size_t(names.size()));
+    *ptab = tab;
+    *plen = uint32_t(names.size());
+    return 0;
 }
 
-QScriptContext *QScriptEngine::currentContext() const
+static JSValue scriptClassGetProperty(JSContext *ctx, JSValueConst obj, JSAtom atom, JSValueConst receiver)
 {
-    // QScriptContext
-    return mCurCtx;
+    Q_UNUSED(receiver);
+
+    QScriptEngine *engine = nullptr;
+    QScriptClassObject *o = scriptClassObject(ctx, obj, &engine);
+    if (!o)
+        return JS_UNDEFINED;
+
+    // 不需要属性描述，不调用 propertyFlags()
+    QScriptValue object(ctx, obj, engine);
+    QScriptString name(ctx, atom);
+    uint id = 0;
+    if (o->scriptClass->queryProperty(object, name, QScriptClass::HandlesReadAccess, &id) & QScriptClass::HandlesReadAccess)
+    {
+        const QScriptValue value = o->scriptClass->property(object, name, id);
+        if (JS_HasException(ctx))
+            return JS_EXCEPTION;
+        return scriptValueToJS(ctx, value);
+    }
+    if (JS_HasException(ctx))
+        return JS_EXCEPTION;
+
+    // 没有接管的名字到原型上查找
+    JSValue proto = JS_GetPrototype(ctx, obj);
+    if (JS_IsException(proto))
+        return proto;
+    JSValue value = JS_IsObject(proto) ? JS_GetProperty(ctx, proto, atom) : JS_UNDEFINED;
+    JS_FreeValue(ctx, proto);
+    return value;
 }
 
-QScriptValue QScriptEngine::evaluate(const QString &program, const QString &fileName, int lineNumber)
+static int scriptClassSetProperty(JSContext *ctx, JSValueConst obj, JSAtom atom, JSValueConst value, JSValueConst receiver, int flags)
 {
-    if (!m_ctx)
-        return QScriptValue();
+    Q_UNUSED(flags);
 
-    mFileNameBuffer.push_back(fileName);
-    qint64 scriptId = mFileNameBuffer.length() - 1;
-    if(agent() != nullptr)
+    QScriptEngine *engine = nullptr;
+    QScriptClassObject *o = scriptClassObject(ctx, obj, &engine);
+    if (!o)
+        return 0;
+
+    QScriptValue object(ctx, obj, engine);
+    QScriptString name(ctx, atom);
+    uint id = 0;
+    if (o->scriptClass->queryProperty(object, name, QScriptClass::HandlesWriteAccess, &id) & QScriptClass::HandlesWriteAccess)
     {
-        agent()->scriptLoad(scriptId, program, fileName, lineNumber);
-        agent()->functionEntry(scriptId);
-        agent()->mFuncStackCounter++;
+        o->scriptClass->setProperty(object, name, id, QScriptValue(ctx, value, engine));
+        return JS_HasException(ctx) ? -1 : 1;
     }
+    if (JS_HasException(ctx))
+        return -1;
 
-    struct EvalGuard {
-        std::atomic<int> &cnt;
-        EvalGuard(std::atomic<int> &c) : cnt(c) { cnt.fetch_add(1, std::memory_order_relaxed); }
-        ~EvalGuard() { cnt.fetch_sub(1, std::memory_order_relaxed); }
-    } guard(m_evalCount);
+    // 没有接管的名字作为普通属性定义在接收者上，之后由QuickJS直接找到
+    JSValueConst target = JS_IsObject(receiver) ? receiver : obj;
+    return JS_DefinePropertyValue(ctx, target, atom, JS_DupValue(ctx, value), JS_PROP_C_W_E);
+}
 
-    // 中断标志位复位
-    std::atomic_store(&interrupt_flag, 0);
+static JSClassExoticMethods s_scriptClassExoticMethods;
 
-    QByteArray ba   = program.toUtf8();
-    QByteArray fnba = fileName.toUtf8();
-    const char *fn  = fileName.isEmpty() ? "<eval>" : fnba.constData();
-    JSValue val;
+// 要明确知道什么时候该用JS_DupValue/JS_FreeValue，什么时候不该用
+// 不然就会出现 资源未释放/资源重复释放的问题
 
-    // 使用带有flag的eval调用函数
-    JSEvalOptions options;
-    options.version    = JS_EVAL_OPTIONS_VERSION;
-    // options.eval_flags = JS_EVAL_TYPE_MODULE;  //JS_EVAL_TYPE_GLOBAL
-    options.eval_flags = JS_EVAL_TYPE_GLOBAL;
-    options.filename   = fn;
-    options.line_num   = (lineNumber > 0) ? lineNumber : 1;
 
-    // 这是加载外部的模块（js实现）
-    // JS_SetModuleLoaderFunc(m_rt, nullptr, js_module_loader_qt, nullptr);
+// 同一个 JSRuntime 上所有引擎共享的数据
+struct QScriptRuntimeData
+{
+    JSRuntime *rt{nullptr};
+    std::atomic<int> ref{1};
+    JSClassID qobjectClassId{0};
+    // 当前正在执行脚本的引擎，中断处理器是runtime级别的，需要靠它找到对应的引擎
+    QScriptEngine *current{nullptr};
+    // 正在执行的 evaluate/任务 的层数，只有最外层结束时才执行Promise任务
+    int depth{0};
+
+    // QuickJS 不是线程安全的，同一时刻只允许一个线程使用runtime
+    QRecursiveMutex lock;
+    QThread *thread{nullptr};
+
+    // 堆、栈和GC的配置，见 QScriptEngine::setHeapLimit
+    size_t heapLimit{0};
+    size_t maxStackSize{JS_DEFAULT_STACK_SIZE};
+    size_t gcThreshold{0};
+
+    // 最外层执行的限制，由中断处理器检查
+    struct ActiveLimits {
+        bool active{false};
+        qint64 wallDeadlineNs{0};   // clock 上的截止时间，0表示不限制
+        qint64 cpuDeadlineNs{0};    // 线程CPU时间的截止时间，0表示不限制
+        qint64 checksLeft{0};       // 还允许的中断回调次数，0表示不限制
+        QScriptEngine::EvaluationLimits config;
+        QScriptEngine::LimitKind exceeded{QScriptEngine::NoLimitExceeded};
+    } limits;
+    QElapsedTimer clock;
+
+    QScriptRuntimeData() { clock.start(); }
+
+    void armLimits(const QScriptEngine::EvaluationLimits &config);
+
+    // QScriptClass 注册的JS类。类ID属于runtime，同一runtime中的引擎共用，
+    // 一个 QScriptClass 在不同的runtime中有各自的类ID
+    QHash<const QScriptClass*, JSClassID> scriptClassIds;
+    QSet<JSClassID> scriptClasses;
+};
 
-    val = JS_Eval2(m_ctx, ba.constData(), ba.size(), &options);
-    QScriptValue qVal = QScriptValue(m_ctx, val, const_cast<QScriptEngine*>(this));
+// 与 quickjs 中的 JS_INTERRUPT_COUNTER_INIT 一致：解释器每执行这么多次跳转/调用回调一次中断处理器
+static const int s_interruptCheckInterval = 10000;
 
-    // 需要通知agent
-    if (JS_IsException(val))
+// 当前线程消耗的CPU时间（纳秒）
+static qint64 threadCpuTimeNs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0;
+    auto toNs = [](const FILETIME &t) {
+        return ((qint64(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 100;
+    };
+    return toNs(kernel) + toNs(user);
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+void QScriptRuntimeData::armLimits(const QScriptEngine::EvaluationLimits &config)
+{
+    limits = ActiveLimits();
+    limits.config = config;
+    if (config.wallTimeMs > 0)
     {
-        // 假如是主动停止导致抛出的异常，那就不要通知 agent
-        // 否则就要通知
-        if (std::atomic_load(&interrupt_flag) == 0)
-        {
-            // wrap exception
-            JSValue exception = JS_GetException(m_ctx);
-            QScriptValue qVal = QScriptValue(m_ctx, exception, const_cast<QScriptEngine*>(this));
+        limits.wallDeadlineNs = clock.nsecsElapsed() + qint64(config.wallTimeMs) * 1000000;
+    }
+    if (config.cpuTimeMs > 0)
+    {
+        limits.cpuDeadlineNs = threadCpuTimeNs() + qint64(config.cpuTimeMs) * 1000000;
+    }
+    if (config.instructionLimit > 0)
+    {
+        limits.checksLeft = qMax<qint64>(1, (config.instructionLimit + s_interruptCheckInterval - 1) / s_interruptCheckInterval);
+    }
+    limits.active = limits.wallDeadlineNs > 0 || limits.cpuDeadlineNs > 0 || limits.checksLeft > 0;
+}
 
-            // JS_GetException 之后，exception会被复位为 JS_UNINITIALIZED
-            // 因此自己再搞回去
-            JS_Throw(m_ctx, exception);
+// 超出执行限制时抛给调用者的异常，name 为 "TimeoutError"，limit 属性说明超出的是哪一项
+static JSValue newLimitExceededError(JSContext *ctx, const QScriptRuntimeData *runtime)
+{
+    const QScriptEngine::EvaluationLimits &config = runtime->limits.config;
+    const char *limit = "";
+    QByteArray message;
+    switch (runtime->limits.exceeded)
+    {
+    case QScriptEngine::WallTimeLimitExceeded:
+        limit = "wallTime";
+        message = QByteArray("script execution exceeded the wall-clock time limit of ")
+                  + QByteArray::number(config.wallTimeMs) + " ms";
+        break;
+    case QScriptEngine::CpuTimeLimitExceeded:
+        limit = "cpuTime";
+        message = QByteArray("script execution exceeded the CPU time limit of ")
+                  + QByteArray::number(config.cpuTimeMs) + " ms";
+        break;
+    case QScriptEngine::InstructionLimitExceeded:
+        limit = "instructions";
+        message = QByteArray("script execution exceeded the instruction limit of ")
+                  + QByteArray::number(config.instructionLimit);
+        break;
+    default:
+        break;
+    }
 
-            // 放回去之后，就不能再调用这个了
-            // JS_FreeValue(m_ctx, exception);
+    JSValue error = JS_NewError(ctx);
+    JS_SetPropertyStr(ctx, error, "name", JS_NewString(ctx, "TimeoutError"));
+    JS_SetPropertyStr(ctx, error, "message", JS_NewStringLen(ctx, message.constData(), message.size()));
+    JS_SetPropertyStr(ctx, error, "limit", JS_NewString(ctx, limit));
+    return error;
+}
 
-            if(agent() != nullptr)
-            {
-                agent()->exceptionThrow(scriptId, qVal, false);
-            }
+// 进入runtime前加锁；换了线程执行时需要重新记录栈顶，否则栈溢出检查会误判
+struct RuntimeLocker {
+    QScriptRuntimeData *runtime;
+    explicit RuntimeLocker(QScriptRuntimeData *r)
+        : runtime(r)
+    {
+        runtime->lock.lock();
+        QThread *thread = QThread::currentThread();
+        if (runtime->thread != thread)
+        {
+            runtime->thread = thread;
+            JS_UpdateStackTop(runtime->rt);
         }
     }
-
-    if(agent() != nullptr)
+    ~RuntimeLocker()
     {
-        agent()->checkFunctionPair(scriptId, qVal);
+        runtime->lock.unlock();
     }
+};
 
-    JS_FreeValue(m_ctx, val);
+// evaluateAsync 的任务
+struct QScriptAsyncJob
+{
+    QString program;
+    QString fileName;
+    int lineNumber{1};
+    QScriptProgram compiled;
+    QFutureInterface<QScriptValue> future;
+};
 
-    return qVal;
+// 异步执行的工作线程，第一次调用 evaluateAsync 时创建
+struct QScriptAsyncState
+{
+    QThread thread;
+    // 属于工作线程，用于把任务投递到工作线程的事件循环
+    QObject *context{nullptr};
+
+    QMutex mutex;
+    QList<QScriptAsyncJob> queue;
+    bool stopping{false};
+
+    // 结果为Promise、还没有完成的任务，只在工作线程中访问
+    struct Pending {
+        JSValue promise;
+        QFutureInterface<QScriptValue> future;
+    };
+    QList<Pending> pending;
+    // pending 的个数，其它线程执行任务后据此判断是否需要让工作线程检查一遍
+    std::atomic<int> unsettled{0};
+    std::atomic<bool> settleScheduled{false};
+};
+
+// 中断函数，用于实现 abortEval 和执行限制
+static int custom_interrupt_handler(JSRuntime *rt, void *opaque) {
+    QScriptRuntimeData *runtime = static_cast<QScriptRuntimeData*>(opaque);
+    if (!runtime)
+        return 1;
+
+    // 执行限制，没有设置时只多读一个标志
+    QScriptRuntimeData::ActiveLimits &limits = runtime->limits;
+    if (limits.active) {
+        if (limits.exceeded != QScriptEngine::NoLimitExceeded)
+            return 1;
+
+        if (limits.checksLeft > 0 && --limits.checksLeft == 0)
+            limits.exceeded = QScriptEngine::InstructionLimitExceeded;
+        else if (limits.wallDeadlineNs > 0 && runtime->clock.nsecsElapsed() >= limits.wallDeadlineNs)
+            limits.exceeded = QScriptEngine::WallTimeLimitExceeded;
+        else if (limits.cpuDeadlineNs > 0 && threadCpuTimeNs() >= limits.cpuDeadlineNs)
+            limits.exceeded = QScriptEngine::CpuTimeLimitExceeded;
+
+        if (limits.exceeded != QScriptEngine::NoLimitExceeded)
+            return 1;
+    }
+
+    QScriptEngine *engine = runtime->current;
+    if (!engine)
+        return 0;
+
+    // 检查中断标志
+    if (std::atomic_load(&engine->interrupt_flag)
+        || engine->async_stopping.load(std::memory_order_relaxed)) {
+        return 1;  // 返回1表示请求中断
+    }
+    return 0;
 }
 
-QScriptValue QScriptEngine::globalObject() const
+// 一个函数名的调用统计，计数器都是原子的，调用线程直接更新
+struct QScriptNativeFunctionProfile
 {
-    return *mGlobalObject;
+    enum { HistogramSize = QScriptEngine::NativeFunctionStatistics::HistogramSize };
+
+    QString name;
+    std::atomic<qint64> calls{0};
+    std::atomic<qint64> totalNs{0};
+    std::atomic<qint64> minNs{std::numeric_limits<qint64>::max()};
+    std::atomic<qint64> maxNs{0};
+    std::atomic<qint64> histogram[HistogramSize]{};
+
+    void record(qint64 ns)
+    {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+        qint64 cur = minNs.load(std::memory_order_relaxed);
+        while (ns < cur && !minNs.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {}
+        cur = maxNs.load(std::memory_order_relaxed);
+        while (ns > cur && !maxNs.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {}
+
+        // 按微秒取对数分桶
+        const quint64 us = quint64(ns) / 1000;
+        int bucket = us == 0 ? 0 : 64 - qCountLeadingZeroBits(us);
+        histogram[qMin(bucket, int(HistogramSize) - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        calls.store(0, std::memory_order_relaxed);
+        totalNs.store(0, std::memory_order_relaxed);
+        minNs.store(std::numeric_limits<qint64>::max(), std::memory_order_relaxed);
+        maxNs.store(0, std::memory_order_relaxed);
+        for (auto &count : histogram)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+static inline qint64 profilerNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
-void QScriptEngine::setGlobalObject(const QScriptValue &object)
+// 原生函数表
+// 每个原生函数占一个表项，表项的地址保存在函数的数据对象上，调用时直接取到，不需要查表
+// 函数对象被回收时，数据对象的finalizer把表项放回空闲链表，供后面注册的函数复用
+// 表项按段分配，段一旦分配就不会移动。表由引擎和所有存活的表项共同持有，
+// 因此引擎析构之后才被回收的函数（例如共享runtime中仍被引用的函数）也能安全地归还表项
+struct QScriptNativeFunctionTable
 {
-    Q_UNUSED(object);
-    // Not implemented: replacing the global object is non-trivial in QuickJS.
+    struct Entry {
+        QScriptEngine::FunctionWithArgSignature func{nullptr};
+        void *arg{nullptr};
+        JSValue callee{JS_UNDEFINED};     // 不持有引用，表项只在函数存活时使用
+        QScriptNativeFunctionProfile *profile{nullptr};
+        QScriptNativeFunctionTable *table{nullptr};
+        Entry *nextFree{nullptr};
+    };
+
+    enum { SegmentSize = 1024 };
+
+    std::mutex mutex;
+    std::vector<Entry*> segments;
+    int used{SegmentSize};      // 最后一个段中已经分配出去的表项数
+    Entry *freeList{nullptr};
+    std::atomic<int> ref{1};
+
+    // 调用统计按函数名合并，和表一起释放
+    QHash<QString, QScriptNativeFunctionProfile*> profiles;
+
+    ~QScriptNativeFunctionTable()
+    {
+        for (Entry *segment : segments)
+        {
+            delete[] segment;
+        }
+        qDeleteAll(profiles);
+    }
+
+    QScriptNativeFunctionProfile *profileFor(const QString &name)
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        QScriptNativeFunctionProfile *&profile = profiles[name];
+        if (!profile)
+        {
+            profile = new QScriptNativeFunctionProfile;
+            profile->name = name;
+        }
+        return profile;
+    }
+
+    Entry *acquire()
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        Entry *entry = freeList;
+        if (entry)
+        {
+            freeList = entry->nextFree;
+            entry->nextFree = nullptr;
+        }
+        else
+        {
+            if (used == SegmentSize)
+            {
+                segments.push_back(new Entry[SegmentSize]);
+                used = 0;
+            }
+            entry = &segments.back()[used++];
+            entry->table = this;
+        }
+
+        ref.fetch_add(1, std::memory_order_relaxed);
+        return entry;
+    }
+
+    void release(Entry *entry)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            entry->func     = nullptr;
+            entry->arg      = nullptr;
+            entry->callee   = JS_UNDEFINED;
+            entry->profile  = nullptr;
+            entry->nextFree = freeList;
+            freeList = entry;
+        }
+        deref();
+    }
+
+    void deref()
+    {
+        if (ref.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+};
+
+static JSClassID s_nativeFunctionClassId = 0;
+static void nativeFunctionFinalizer(JSRuntime *rt, JSValueConst val)
+{
+    Q_UNUSED(rt);
+    auto *entry = static_cast<QScriptNativeFunctionTable::Entry*>(JS_GetOpaque(val, s_nativeFunctionClassId));
+    if (entry)
+    {
+        entry->table->release(entry);
+    }
 }
 
-QScriptValue QScriptEngine::newObject()
+// 处理注册的c++函数
+static JSValue nativeFunctionShim(JSContext *ctx,
+                                  JSValueConst this_val,
+                                  int argc, JSValueConst *argv,
+                                  int magic, JSValueConst *func_data)
 {
-    if (!m_ctx)
-        return QScriptValue();
+    Q_UNUSED(magic);
+
+    // retrieve the QScriptEngine associated with this JSContext
+    void *opaque = JS_GetContextOpaque(ctx);
+    QScriptEngine *engine = static_cast<QScriptEngine*>(opaque);
+    if (!engine)
+        return JS_UNDEFINED;
+
+    // 检查中断标志
+    if (std::atomic_load(&engine->interrupt_flag)) {
+        auto value = JS_ThrowTypeError(ctx, "%s", "stop");
+        return value;
+    }
+
+    auto *entry = static_cast<QScriptNativeFunctionTable::Entry*>(JS_GetOpaque(func_data[0], s_nativeFunctionClassId));
+    if (!entry || !entry->func)
+        return JS_UNDEFINED;
+
+    QScriptEngine::FunctionWithArgSignature func = entry->func;
+    void *arg = entry->arg;
+    JSValue callee = entry->callee;
+    QScriptNativeFunctionProfile *profile = entry->profile;
+
+    // 进入函数
+    auto agent = engine->agent();
+    if(agent != nullptr)
+    {
+        agent->functionEntry(-1);
+    }
+
+    // 调用期间借用参数，不做引用计数
+    QScriptContext qctx(QScriptContext::BorrowArguments, ctx, this_val, argc, argv, engine, callee);
+    // detect whether function was called as constructor
+    bool calledAsCtor = JS_IsConstructor(ctx, this_val);
+    qctx.setCalledAsConstructor(calledAsCtor);
+    QScriptValue res;
+    {
+        QScriptNativeCallTimer timer(engine, profile);
+        res = func(&qctx, engine, arg);
+    }
+
+    // 退出函数
+    if(agent != nullptr)
+    {
+        agent->functionExit(-1, res);
+    }
+
+    // 不在 evaluate() 中（由宿主直接调用的JS函数触发），原生函数排下的Promise任务没有人执行，交给事件循环
+    if (!engine->isEvaluating() && JS_IsJobPending(JS_GetRuntime(ctx)))
+    {
+        engine->scheduleJobDrain();
+    }
+
+    // qDebug() << "the returnd val:"
+    //          << res.data()
+    //          << res.engine()
+    //          << JS_IsUndefined(res.rawValue())
+    //          << res.toString();
+
+    // 假如返回值是普通值，需要构建成JSValue
+    if (res.isVariant()) {
+        return QScriptValue::toJSValue(ctx, res.data());
+    }
+
+    // 如果返回的是 undefined/null 或 无效值，且这是构造调用（new Foo()），
+    // 则应返回 thisObject()（遵循 Qt 的 QScriptBehavior）。
+    if (!res.isValid() || res.isUndefined()) {
+        // qDebug() << !res.isValid() << res.isUndefined();
+        if (qctx.isCalledAsConstructor()) {
+            QScriptValue thisObj = qctx.thisObject();
+            if (thisObj.isValid()) {
+                return JS_DupValue(ctx, thisObj.rawValue());
+            }
+        }
+        return JS_UNDEFINED;
+    }
+
+    // 有效的 JS 值，直接 dup 并返回
+    auto val = JS_DupValue(ctx, res.rawValue());
+    return val;
+}
+
+// 统计正在执行的 evaluate 的层数，用于 isEvaluating()
+// 同时记录runtime上当前执行脚本的引擎，供中断处理器使用
+// 最外层的执行开始计算执行限制，limits 为空时使用引擎的 evaluationLimits()
+struct EvalGuard {
+    std::atomic<int> &cnt;
+    QScriptRuntimeData *runtime;
+    QScriptEngine *engine;
+    QScriptEngine *previous;
+    bool outermost{false};
+    EvalGuard(std::atomic<int> &c, QScriptRuntimeData *r, QScriptEngine *e,
+              const QScriptEngine::EvaluationLimits *limits = nullptr)
+        : cnt(c), runtime(r), engine(e), previous(r->current)
+    {
+        cnt.fetch_add(1, std::memory_order_relaxed);
+        runtime->depth++;
+        runtime->current = engine;
+
+        if (runtime->depth == 1)
+        {
+            outermost = true;
+            runtime->armLimits(limits ? *limits : engine->m_limits);
+        }
+    }
+    ~EvalGuard()
+    {
+        if (outermost)
+        {
+            engine->m_lastExceededLimit = runtime->limits.exceeded;
+            runtime->limits = QScriptRuntimeData::ActiveLimits();
+            engine->clearAbortedTimers();
+        }
+        runtime->current = previous;
+        runtime->depth--;
+        cnt.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+// Adapter: wrap old FunctionSignature into FunctionWithArgSignature
+static QScriptValue functionSignatureAdapter(QScriptContext *context, QScriptEngine *engine, void *arg)
+{
+    if (!arg)
+        return QScriptValue();
+
+    // arg stores the FunctionSignature as a pointer-sized value
+    auto sig = reinterpret_cast<QScriptEngine::FunctionSignature>(arg);
+    if (!sig)
+        return QScriptValue();
+
+    return sig(context, engine);
+}
+
+// 内部类的ID是进程级的，所有runtime共用，只在第一个runtime中分配一次，回调表也只填一次；
+// 之后每个新的runtime用同样的ID各自注册。JS_NewClassID 按runtime当前的类数量分配，
+// 必须紧跟着 JS_NewClass，所以分配和第一次注册一起放在 call_once 中
+static std::once_flag s_internalClassesOnce;
+
+static void registerInternalClasses(JSRuntime *rt)
+{
+    JSClassDef cd;
+    memset(&cd, 0, sizeof(cd));
+    cd.class_name = "QScriptQObject";
+    cd.finalizer = qobject_finalizer;
+    cd.exotic = &s_qobjectExoticMethods;
+
+    // 原生函数的数据对象，回收时归还原生函数表项
+    JSClassDef nd;
+    memset(&nd, 0, sizeof(nd));
+    nd.class_name = "QScriptNativeFunction";
+    nd.finalizer = nativeFunctionFinalizer;
+
+    // QObject 的信号对象
+    JSClassDef sd;
+    memset(&sd, 0, sizeof(sd));
+    sd.class_name = "QScriptSignal";
+    sd.finalizer = signalFinalizer;
+
+    bool registered = false;
+    std::call_once(s_internalClassesOnce, [rt, &cd, &nd, &sd, &registered]() {
+        // 成员在第一次访问时解析
+        memset(&s_qobjectExoticMethods, 0, sizeof(s_qobjectExoticMethods));
+        s_qobjectExoticMethods.get_own_property       = qobjectGetOwnProperty;
+        s_qobjectExoticMethods.get_own_property_names = qobjectGetOwnPropertyNames;
+        s_qobjectExoticMethods.has_property           = qobjectHasProperty;
+        s_qobjectExoticMethods.get_property           = qobjectGetProperty;
+        s_qobjectExoticMethods.set_property           = qobjectSetProperty;
+
+        // QScriptClass 的JS类在第一次 newObject 时才注册，回调都是同一组
+        memset(&s_scriptClassExoticMethods, 0, sizeof(s_scriptClassExoticMethods));
+        s_scriptClassExoticMethods.get_own_property       = scriptClassGetOwnProperty;
+        s_scriptClassExoticMethods.get_own_property_names = scriptClassGetOwnPropertyNames;
+        s_scriptClassExoticMethods.get_property           = scriptClassGetProperty;
+        s_scriptClassExoticMethods.set_property           = scriptClassSetProperty;
+
+        JS_NewClassID(rt, &s_qobjectClassId);
+        JS_NewClass(rt, s_qobjectClassId, &cd);
+        JS_NewClassID(rt, &s_nativeFunctionClassId);
+        JS_NewClass(rt, s_nativeFunctionClassId, &nd);
+        JS_NewClassID(rt, &s_signalClassId);
+        JS_NewClass(rt, s_signalClassId, &sd);
+        registered = true;
+    });
+
+    if (!registered)
+    {
+        JS_NewClass(rt, s_qobjectClassId, &cd);
+        JS_NewClass(rt, s_nativeFunctionClassId, &nd);
+        JS_NewClass(rt, s_signalClassId, &sd);
+    }
+}
+
+QScriptEngine::QScriptEngine(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<QScriptValue>();
+
+    m_rt = JS_NewRuntime();
+    if(!m_rt)
+    {
+        qCritical() << "create js runtime fail";
+        return;
+    }
+
+    // 堆的大小、栈的大小和GC触发阈值默认使用 QuickJS 的设置，
+    // 可以通过 setHeapLimit()、setMaxStackSize()、setGCThreshold() 修改
+    m_runtime = new QScriptRuntimeData;
+    m_runtime->rt = m_rt;
+    m_runtime->gcThreshold = JS_GetGCThreshold(m_rt);
+    JS_SetRuntimeOpaque(m_rt, m_runtime);
+
+    // 设置中断处理器
+    JS_SetInterruptHandler(m_rt, custom_interrupt_handler, m_runtime);
+
+    // 这样是实现对QObject对象的析构
+    // Register a QuickJS class to wrap QObject pointers
+    registerInternalClasses(m_rt);
+    m_runtime->qobjectClassId = s_qobjectClassId;
+
+    // 模块加载器是runtime级别的，加载时通过 JSContext 找到对应的引擎
+    JS_SetModuleLoaderFunc(m_rt, nullptr, js_module_loader_qt, nullptr);
+
+    initContext();
+}
+
+QScriptEngine::QScriptEngine(SharedRuntimeTag, QScriptEngine *sibling, QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<QScriptValue>();
+
+    if (!sibling || !sibling->m_runtime)
+    {
+        qCritical() << "create sibling engine fail: no runtime to share";
+        return;
+    }
+
+    m_runtime = sibling->m_runtime;
+    m_runtime->ref.fetch_add(1);
+    m_rt = m_runtime->rt;
+
+    initContext();
+}
+
+void QScriptEngine::initContext()
+{
+    m_ctx = JS_NewContext(m_rt);
+    if(!m_ctx)
+    {
+        qCritical() << "create js context fail";
+        releaseRuntime();
+        return;
+    }
+
+    // associate C++ object with the QuickJS context
+    JS_SetContextOpaque(m_ctx, this);
+
+    // 重置中断标志
+    std::atomic_store(&interrupt_flag, 0);
+
+    // 定时器总是在引擎所属的线程中触发
+    m_timerWheel = new QScriptTimerWheel();
+    m_timerDriver = new QTimer(this);
+    m_timerDriver->setSingleShot(true);
+    m_timerDriver->setTimerType(Qt::PreciseTimer);
+    connect(m_timerDriver, &QTimer::timeout, this, [this]() {
+        fireTimers();
+    });
+    m_timerClock.start();
+
+    // QObject 包装类在runtime中只注册一次
+    m_qobjectClassId = m_runtime->qobjectClassId;
+
+    m_nativeFunctions = new QScriptNativeFunctionTable;
+
+    if(mCurCtx == nullptr)
+    {
+        mCurCtx = new QScriptContext(m_ctx, JS_UNDEFINED, 0, nullptr, this, JS_UNDEFINED);
+    }
+
+    // GlobalObject
+    {
+        JSValue g = JS_GetGlobalObject(m_ctx);
+
+        mGlobalObject = new QScriptValue(m_ctx, g, this);
+
+        // 内置定时器
+        JS_SetPropertyStr(m_ctx, g, "setTimeout",
+                          JS_NewCFunctionMagic(m_ctx, js_setTimer, "setTimeout", 2, JS_CFUNC_generic_magic, 0));
+        JS_SetPropertyStr(m_ctx, g, "setInterval",
+                          JS_NewCFunctionMagic(m_ctx, js_setTimer, "setInterval", 2, JS_CFUNC_generic_magic, 1));
+        JS_SetPropertyStr(m_ctx, g, "clearTimeout",
+                          JS_NewCFunction(m_ctx, js_clearTimer, "clearTimeout", 1));
+        JS_SetPropertyStr(m_ctx, g, "clearInterval",
+                          JS_NewCFunction(m_ctx, js_clearTimer, "clearInterval", 1));
+
+        // 这个不能调用释放，一旦释放会报错
+        // 这里奇怪得很，假如在debug模式，不执行释放的话，会导致报错：list_empty(&rt->gc_obj_list)
+        // 但是，在release时，假如加上了，又会报0xc000005错误,估计是重复释放
+        JS_FreeValue(m_ctx, g);
+    }
+}
+
+void QScriptEngine::releaseRuntime()
+{
+    if (m_runtime == nullptr)
+        return;
+
+    // 最后一个使用该runtime的引擎负责释放
+    if (m_runtime->ref.fetch_sub(1) == 1)
+    {
+        JS_SetModuleLoaderFunc(m_rt, nullptr, nullptr, nullptr);
+        JS_SetInterruptHandler(m_rt, nullptr, nullptr);
+        JS_SetRuntimeOpaque(m_rt, nullptr);
+        JS_FreeRuntime(m_rt);
+        delete m_runtime;
+    }
+
+    m_runtime = nullptr;
+    m_rt = nullptr;
+}
+
+QScriptEngine *QScriptEngine::createSiblingEngine(QObject *parent)
+{
+    if (!m_runtime)
+        return nullptr;
+
+    return new QScriptEngine(SharedRuntimeTag(), this, parent);
+}
+
+bool QScriptEngine::sharesRuntimeWith(const QScriptEngine *other) const
+{
+    return other != nullptr && m_runtime != nullptr && m_runtime == other->m_runtime;
+}
+
+QScriptEngine::~QScriptEngine()
+{
+    // 先停止异步执行的工作线程，之后引擎只在当前线程中使用
+    stopAsyncWorker();
+
+    if (m_runtime)
+    {
+        // 兄弟引擎可能正在其它线程中使用同一个runtime
+        RuntimeLocker locker(m_runtime);
+
+        clearDefaultPrototypes(); // 首先清空存储的默认类型，不然会崩溃
+        clearWrapperCache();
+        clearMetaObjectBindings();
+        clearSignalConnections();
+        clearStringHandles();
+
+        clearTimers();
+        delete m_timerWheel;
+        m_timerWheel = nullptr;
+
+        // 释放在本引擎中编译过的 QScriptProgram 字节码
+        const auto programs = m_programs;
+        for (QScriptProgramPrivate *program : programs)
+        {
+            releaseProgram(program);
+        }
+
+        if(agent() != nullptr)
+        {
+            // 这里会导致程序崩溃，后面再处理
+            // for (int i = 0; i < mFileNameBuffer.length(); ++i) {
+            //     agent()->scriptUnload(i);
+            // }
+
+            // agent可能比引擎活得久，断开它对引擎的引用
+            agent()->m_engine = nullptr;
+            setAgent(nullptr);
+        }
+
+        // 清理模块系统
+        m_moduleRegistry.clear();
+
+        // 要先释放申请的资源，最后再释放引擎
+        if(mCurCtx != nullptr)
+        {
+            delete mCurCtx;
+            mCurCtx = nullptr;
+        }
+        if(mGlobalObject != nullptr)
+        {
+            delete mGlobalObject;
+            mGlobalObject = nullptr;
+        }
+
+        if (m_ctx) {
+            // clear context opaque to avoid dangling pointer
+            JS_SetContextOpaque(m_ctx, nullptr);
+            JS_FreeContext(m_ctx);
+            m_ctx = nullptr;
+        }
+
+        // 还没有被回收的原生函数各自持有表的引用
+        if (m_nativeFunctions)
+        {
+            m_nativeFunctions->deref();
+            m_nativeFunctions = nullptr;
+        }
+    }
+
+    // 与兄弟引擎共享的runtime由最后一个引擎释放
+    releaseRuntime();
+}
+
+bool QScriptEngine::isEvaluating() const
+{
+    return m_evalCount.load(std::memory_order_relaxed) > 0;
+}
+
+void QScriptEngine::abortEvaluation(const QScriptValue &result)
+{
+    // if (!m_ctx)
+    //     return;
+    // JS_Throw(m_ctx, JS_DupValue(m_ctx, result.rawValue()));
+
+    std::atomic_store(&interrupt_flag, 1);
+
+    // 还没有触发的定时器全部取消；下一次 evaluate 会复位中断标志，不能留给 fireTimers 判断
+    // 其它线程正在执行脚本时不在这里等锁，由那个线程在执行结束或者定时器醒来时取消
+    m_timersAborted.store(true);
+    if (m_runtime && m_runtime->lock.tryLock())
+    {
+        clearAbortedTimers();
+        m_runtime->lock.unlock();
+    }
+}
+
+void QScriptEngine::setAgent(QScriptEngineAgent *agent)
+{
+    if (m_agent == agent)
+        return;
+
+    m_agent = agent;
+
+    if (!m_ctx)
+        return;
+
+#ifdef QSCRIPT_FAST_DISPATCH
+    // computed goto 分派下逐指令回调不可用，见 ScriptEngine.pri
+    if (agent != nullptr)
+    {
+        qWarning() << "QScriptEngineAgent: built with qscript_fast_dispatch, positionChange() will not be reported";
+    }
+#else
+    // 只有设置了agent时才安装逐指令回调，没有agent时解释器不做任何额外的工作
+    if (agent != nullptr)
+    {
+        JS_SetOPChangedHandler(m_ctx, scriptOPChanged, agent);
+    }
+    else
+    {
+        JS_SetOPChangedHandler(m_ctx, nullptr, nullptr);
+    }
+#endif
+}
+
+QScriptEngineAgent *QScriptEngine::agent() const
+{
+    return m_agent;
+}
+
+void QScriptEngine::collectGarbage()
+{
+    if (!m_rt)
+        return;
+
+    RuntimeLocker locker(m_runtime);
+    JS_RunGC(m_rt);
+}
+
+void QScriptEngine::setHeapLimit(size_t bytes)
+{
+    if (!m_rt)
+        return;
+
+    RuntimeLocker locker(m_runtime);
+    m_runtime->heapLimit = bytes;
+    JS_SetMemoryLimit(m_rt, bytes);
+}
+
+size_t QScriptEngine::heapLimit() const
+{
+    return m_runtime ? m_runtime->heapLimit : 0;
+}
+
+void QScriptEngine::setMaxStackSize(size_t bytes)
+{
+    if (!m_rt)
+        return;
+
+    if (bytes == 0)
+        bytes = JS_DEFAULT_STACK_SIZE;
+
+    RuntimeLocker locker(m_runtime);
+    m_runtime->maxStackSize = bytes;
+    JS_SetMaxStackSize(m_rt, bytes);
+}
+
+size_t QScriptEngine::maxStackSize() const
+{
+    return m_runtime ? m_runtime->maxStackSize : 0;
+}
+
+void QScriptEngine::setGCThreshold(size_t bytes)
+{
+    if (!m_rt)
+        return;
+
+    RuntimeLocker locker(m_runtime);
+    m_runtime->gcThreshold = bytes;
+    JS_SetGCThreshold(m_rt, bytes);
+}
+
+size_t QScriptEngine::gcThreshold() const
+{
+    return m_runtime ? m_runtime->gcThreshold : 0;
+}
+
+// QuickJS 分配失败时抛出的 "InternalError: out of memory"
+static bool isOutOfMemoryError(JSContext *ctx, JSValueConst exception)
+{
+    if (!JS_IsError(ctx, exception))
+        return false;
+
+    JSValue message = JS_GetPropertyStr(ctx, exception, "message");
+    const char *str = JS_ToCString(ctx, message);
+    bool result = str && strcmp(str, "out of memory") == 0;
+    if (str)
+        JS_FreeCString(ctx, str);
+    JS_FreeValue(ctx, message);
+    if (JS_HasException(ctx))
+        JS_FreeValue(ctx, JS_GetException(ctx));
+    return result;
+}
+
+// 连错误对象都分配不出来时，QuickJS-ng 抛出的是 null 而不是 InternalError。
+// 脚本自己也可以 throw null，所以只有堆的用量确实到了限制附近时才当作内存不足：
+// 错误对象只有几百字节，能让它分配失败的剩余空间远小于这个余量
+static const size_t s_outOfMemorySlack = 64 * 1024;
+
+static bool isHeapExhausted(JSRuntime *rt, size_t heapLimit)
+{
+    if (heapLimit == 0)
+        return false;
+    JSMemoryUsage usage;
+    JS_ComputeMemoryUsage(rt, &usage);
+    return usage.malloc_size >= 0 && size_t(usage.malloc_size) + s_outOfMemorySlack >= heapLimit;
+}
+
+QScriptContext *QScriptEngine::currentContext() const
+{
+    // QScriptContext
+    return mCurCtx;
+}
+
+QScriptValue QScriptEngine::evaluate(const QString &program, const QString &fileName, int lineNumber)
+{
+    return evaluateSource(program, fileName, lineNumber, nullptr);
+}
+
+QScriptValue QScriptEngine::evaluate(const QString &program, const QString &fileName, int lineNumber, const EvaluationLimits &limits)
+{
+    return evaluateSource(program, fileName, lineNumber, &limits);
+}
+
+void QScriptEngine::setEvaluationLimits(const EvaluationLimits &limits)
+{
+    m_limits = limits;
+}
+
+QScriptEngine::EvaluationLimits QScriptEngine::evaluationLimits() const
+{
+    return m_limits;
+}
+
+QScriptEngine::LimitKind QScriptEngine::lastExceededLimit() const
+{
+    return m_lastExceededLimit;
+}
+
+QScriptValue QScriptEngine::evaluateSource(const QString &program, const QString &fileName, int lineNumber, const EvaluationLimits *limits)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    RuntimeLocker locker(m_runtime);
+
+    qint64 scriptId = registerScriptFileName(fileName);
+    if(agent() != nullptr)
+    {
+        agent()->scriptLoad(scriptId, program, fileName, lineNumber);
+        agent()->functionEntry(scriptId);
+        agent()->mFuncStackCounter++;
+    }
+
+    EvalGuard guard(m_evalCount, m_runtime, this, limits);
+
+    // 中断标志位复位
+    std::atomic_store(&interrupt_flag, 0);
+
+    QByteArray ba   = program.toUtf8();
+    QByteArray fnba = fileName.toUtf8();
+    const char *fn  = fileName.isEmpty() ? "<eval>" : fnba.constData();
+    JSValue val;
+
+    // 使用带有flag的eval调用函数
+    JSEvalOptions options;
+    options.version    = JS_EVAL_OPTIONS_VERSION;
+    // options.eval_flags = JS_EVAL_TYPE_MODULE;  //JS_EVAL_TYPE_GLOBAL
+    options.eval_flags = JS_EVAL_TYPE_GLOBAL;
+    options.filename   = fn;
+    options.line_num   = (lineNumber > 0) ? lineNumber : 1;
+
+    // 这是加载外部的模块（js实现）
+    // JS_SetModuleLoaderFunc(m_rt, nullptr, js_module_loader_qt, nullptr);
+
+    val = JS_Eval2(m_ctx, ba.constData(), ba.size(), &options);
+
+    return finishEvaluate(val, scriptId);
+}
+
+QScriptValue QScriptEngine::evaluate(const QScriptProgram &program)
+{
+    if (!m_ctx || program.isNull())
+        return QScriptValue();
+
+    RuntimeLocker locker(m_runtime);
+
+    QScriptProgramPrivate *d = program.d_ptr.data();
+
+    // 第一次在本引擎中执行时才分配scriptId并通知agent，与 evaluate(QString) 的行为保持一致
+    qint64 scriptId = -1;
+    bool firstRun = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        auto it = d->compiled.find(this);
+        if (it == d->compiled.end())
+        {
+            QScriptProgramPrivate::CompiledProgram compiled;
+            compiled.scriptId = registerScriptFileName(d->fileName);
+            it = d->compiled.insert(this, compiled);
+            m_programs.insert(d);
+            firstRun = true;
+        }
+        scriptId = it->scriptId;
+    }
+
+    if(agent() != nullptr)
+    {
+        if (firstRun)
+        {
+            agent()->scriptLoad(scriptId, d->sourceCode, d->fileName, d->firstLineNumber);
+        }
+        agent()->functionEntry(scriptId);
+        agent()->mFuncStackCounter++;
+    }
+
+    EvalGuard guard(m_evalCount, m_runtime, this);
+
+    // 中断标志位复位
+    std::atomic_store(&interrupt_flag, 0);
+
+    JSValue val = JS_UNDEFINED;
+    JSValue fun = JS_UNDEFINED;
+    if (!compileProgram(d, &fun))
+    {
+        // 编译失败（语法错误），异常已经在上下文中
+        val = JS_EXCEPTION;
+    }
+    else
+    {
+        // JS_EvalFunction 会释放传入的函数对象，compileProgram 返回的是dup过的
+        val = JS_EvalFunction(m_ctx, fun);
+    }
+
+    return finishEvaluate(val, scriptId);
+}
+
+bool QScriptEngine::compileProgram(QScriptProgramPrivate *program, JSValue *fun)
+{
+    QMutexLocker locker(&program->mutex);
+
+    QScriptProgramPrivate::CompiledProgram &compiled = program->compiled[this];
+    if (JS_IsUndefined(compiled.bytecode))
+    {
+        JSValue bytecode = JS_UNDEFINED;
+
+        // 已经在其它引擎中编译过，直接从字节码实例化
+        if (!program->serializedBytecode.isEmpty())
+        {
+            bytecode = JS_ReadObject(m_ctx,
+                                     reinterpret_cast<const uint8_t *>(program->serializedBytecode.constData()),
+                                     program->serializedBytecode.size(),
+                                     JS_READ_OBJ_BYTECODE);
+            if (JS_IsException(bytecode))
+            {
+                JS_FreeValue(m_ctx, JS_GetException(m_ctx));
+                bytecode = JS_UNDEFINED;
+            }
+        }
+
+        if (JS_IsUndefined(bytecode))
+        {
+            const char *fn = program->fileName.isEmpty() ? "<eval>" : program->fileNameUtf8.constData();
+
+            JSEvalOptions options;
+            options.version    = JS_EVAL_OPTIONS_VERSION;
+            options.eval_flags = JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY;
+            options.filename   = fn;
+            options.line_num   = (program->firstLineNumber > 0) ? program->firstLineNumber : 1;
+
+            bytecode = JS_Eval2(m_ctx,
+                                program->sourceUtf8.constData(),
+                                program->sourceUtf8.size(),
+                                &options);
+            if (JS_IsException(bytecode))
+                return false;
+
+            if (program->serializedBytecode.isEmpty())
+            {
+                size_t size = 0;
+                uint8_t *buf = JS_WriteObject(m_ctx, &size, bytecode, JS_WRITE_OBJ_BYTECODE);
+                if (buf)
+                {
+                    program->serializedBytecode = QByteArray(reinterpret_cast<const char *>(buf), (int)size);
+                    js_free(m_ctx, buf);
+                }
+                else
+                {
+                    JS_FreeValue(m_ctx, JS_GetException(m_ctx));
+                }
+            }
+        }
+
+        compiled.bytecode = bytecode;
+    }
+
+    *fun = JS_DupValue(m_ctx, compiled.bytecode);
+    return true;
+}
+
+void QScriptEngine::releaseProgram(QScriptProgramPrivate *program)
+{
+    // 程序可能在其它线程中析构，先拿到runtime再释放字节码
+    RuntimeLocker runtimeLocker(m_runtime);
+    QMutexLocker locker(&program->mutex);
+
+    auto it = program->compiled.find(this);
+    if (it != program->compiled.end())
+    {
+        if (m_ctx && !JS_IsUndefined(it->bytecode))
+        {
+            JS_FreeValue(m_ctx, it->bytecode);
+        }
+        program->compiled.erase(it);
+    }
+
+    m_programs.remove(program);
+}
+
+qint64 QScriptEngine::registerScriptFileName(const QString &fileName)
+{
+    mFileNameBuffer.push_back(fileName);
+    qint64 scriptId = mFileNameBuffer.length() - 1;
+
+    // 与 QStringList::indexOf 的结果保持一致：同名文件取第一次出现的位置
+    if (!m_scriptIdByFileName.contains(fileName))
+    {
+        m_scriptIdByFileName.insert(fileName, scriptId);
+    }
+
+    return scriptId;
+}
+
+QScriptValue QScriptEngine::finishEvaluate(JSValue val, qint64 scriptId, bool isCall)
+{
+    QScriptValue qVal = QScriptValue(m_ctx, val, const_cast<QScriptEngine*>(this));
+
+    // 超出执行限制而被终止的，换成可以区分的 TimeoutError
+    if (JS_IsException(val) && m_runtime->depth == 1
+        && m_runtime->limits.exceeded != NoLimitExceeded)
+    {
+        JS_FreeValue(m_ctx, JS_GetException(m_ctx));
+        JS_Throw(m_ctx, newLimitExceededError(m_ctx, m_runtime));
+    }
+    // 超出堆限制：回收脚本留下的垃圾，保证引擎之后还能继续使用
+    // 连异常对象都分配不出来时异常值是 null（或者没有异常值），回收之后补一个真正的错误
+    else if (JS_IsException(val) && m_runtime->depth == 1 && m_runtime->heapLimit > 0)
+    {
+        JSValue exception = JS_GetException(m_ctx);
+        if (JS_IsUninitialized(exception)
+            || (JS_IsNull(exception) && isHeapExhausted(m_rt, m_runtime->heapLimit)))
+        {
+            JS_RunGC(m_rt);
+            JS_ThrowInternalError(m_ctx, "out of memory");
+        }
+        else
+        {
+            if (isOutOfMemoryError(m_ctx, exception))
+            {
+                JS_RunGC(m_rt);
+            }
+            JS_Throw(m_ctx, exception);
+        }
+    }
+
+    // 需要通知agent
+    if (JS_IsException(val))
+    {
+        // 假如是主动停止导致抛出的异常，那就不要通知 agent
+        // 否则就要通知
+        if (std::atomic_load(&interrupt_flag) == 0)
+        {
+            // wrap exception
+            JSValue exception = JS_GetException(m_ctx);
+            QScriptValue qVal = QScriptValue(m_ctx, exception, const_cast<QScriptEngine*>(this));
+
+            // JS_GetException 之后，exception会被复位为 JS_UNINITIALIZED
+            // 因此自己再搞回去
+            JS_Throw(m_ctx, exception);
+
+            // 放回去之后，就不能再调用这个了
+            // JS_FreeValue(m_ctx, exception);
+
+            if(agent() != nullptr)
+            {
+                agent()->exceptionThrow(scriptId, qVal, false);
+            }
+        }
+    }
+
+    if(agent() != nullptr)
+    {
+        if (isCall)
+        {
+            agent()->functionExit(scriptId, qVal);
+        }
+        else
+        {
+            agent()->checkFunctionPair(scriptId, qVal);
+        }
+    }
+
+    JS_FreeValue(m_ctx, val);
+
+    // 最外层的脚本执行完后，执行它排下的Promise任务
+    // 嵌套在原生函数中的 evaluate() 不执行，否则会在脚本执行到一半时插入微任务
+    if (m_runtime->depth == 1 && std::atomic_load(&interrupt_flag) == 0
+        && m_runtime->limits.exceeded == NoLimitExceeded)
+    {
+        // 保留脚本本身抛出的异常，供 hasUncaughtException() 使用
+        bool hasException = JS_HasException(m_ctx);
+        JSValue exception = hasException ? JS_GetException(m_ctx) : JS_UNDEFINED;
+
+        drainPendingJobs();
+
+        if (hasException)
+        {
+            JS_Throw(m_ctx, exception);
+        }
+        else if (m_runtime->limits.exceeded != NoLimitExceeded)
+        {
+            // 脚本排下的Promise任务超出了执行限制
+            JS_Throw(m_ctx, newLimitExceededError(m_ctx, m_runtime));
+        }
+    }
+
+    return qVal;
+}
+
+QFuture<QScriptValue> QScriptEngine::evaluateAsync(const QString &program, const QString &fileName, int lineNumber)
+{
+    QScriptAsyncJob job;
+    job.program    = program;
+    job.fileName   = fileName;
+    job.lineNumber = lineNumber;
+    return enqueueAsync(job);
+}
+
+QFuture<QScriptValue> QScriptEngine::evaluateAsync(const QScriptProgram &program)
+{
+    QScriptAsyncJob job;
+    job.compiled = program;
+    return enqueueAsync(job);
+}
+
+QFuture<QScriptValue> QScriptEngine::enqueueAsync(QScriptAsyncJob &job)
+{
+    job.future.reportStarted();
+    QFuture<QScriptValue> future = job.future.future();
+
+    if (!m_ctx)
+    {
+        job.future.reportResult(QScriptValue());
+        job.future.reportFinished();
+        return future;
+    }
+
+    // 工作线程和任务队列都属于引擎，只允许在引擎所属的线程中提交任务
+    if (QThread::currentThread() != thread())
+    {
+        qWarning() << "QScriptEngine::evaluateAsync: must be called from the thread the engine lives in";
+        job.future.reportCanceled();
+        job.future.reportFinished();
+        return future;
+    }
+
+    if (m_async == nullptr)
+    {
+        m_async = new QScriptAsyncState;
+        m_async->thread.setObjectName("QScriptEngine async");
+        m_async->context = new QObject;
+        m_async->context->moveToThread(&m_async->thread);
+        m_async->thread.start();
+    }
+
+    {
+        QMutexLocker locker(&m_async->mutex);
+        m_async->queue.append(job);
+    }
+
+    QMetaObject::invokeMethod(m_async->context, [this]() {
+        runAsyncJobs();
+    }, Qt::QueuedConnection);
+
+    return future;
+}
+
+// 在工作线程中执行
+void QScriptEngine::runAsyncJobs()
+{
+    forever
+    {
+        QScriptAsyncJob job;
+        {
+            QMutexLocker locker(&m_async->mutex);
+            if (m_async->stopping || m_async->queue.isEmpty())
+                break;
+            job = m_async->queue.takeFirst();
+        }
+
+        if (job.future.isCanceled())
+        {
+            job.future.reportFinished();
+            continue;
+        }
+
+        RuntimeLocker locker(m_runtime);
+
+        // 等锁期间引擎可能开始析构了，取出的任务不再执行
+        if (async_stopping.load())
+        {
+            job.future.reportCanceled();
+            job.future.reportFinished();
+            break;
+        }
+
+        QScriptValue result = job.compiled.isNull()
+                                  ? evaluate(job.program, job.fileName, job.lineNumber)
+                                  : evaluate(job.compiled);
+
+        JSValue val = result.rawValue();
+        if (JS_IsPromise(val) && JS_PromiseState(m_ctx, val) == JS_PROMISE_PENDING)
+        {
+            // 等Promise完成后再结束future，期间不占用工作线程
+            QScriptAsyncState::Pending pending;
+            pending.promise = JS_DupValue(m_ctx, val);
+            pending.future  = job.future;
+            m_async->pending.append(pending);
+            m_async->unsettled.store(m_async->pending.size());
+        }
+        else
+        {
+            job.future.reportResult(result);
+            job.future.reportFinished();
+        }
+    }
+
+    settleAsyncJobs();
+}
+
+// 执行积压的Promise任务，并结束已经完成的异步任务
+void QScriptEngine::settleAsyncJobs()
+{
+    if (m_async == nullptr)
+        return;
+
+    RuntimeLocker locker(m_runtime);
+
+    // 非Promise结果的脚本也可能通过 then() 排了任务，这里一并执行
+    drainPendingJobs();
+
+    for (int i = 0; i < m_async->pending.size(); )
+    {
+        QScriptAsyncState::Pending &pending = m_async->pending[i];
+        JSPromiseStateEnum state = JS_PromiseState(m_ctx, pending.promise);
+        if (state == JS_PROMISE_PENDING)
+        {
+            ++i;
+            continue;
+        }
+
+        // rejected 时结果为抛出的错误，与 evaluate() 出错时返回错误对象的行为一致
+        JSValue value = JS_PromiseResult(m_ctx, pending.promise);
+        QScriptValue result(m_ctx, value, this);
+        JS_FreeValue(m_ctx, value);
+        JS_FreeValue(m_ctx, pending.promise);
+
+        pending.future.reportResult(result);
+        pending.future.reportFinished();
+        m_async->pending.removeAt(i);
+    }
+    m_async->unsettled.store(m_async->pending.size());
+}
+
+// 异步任务等待的Promise可能在其它线程中完成：引擎线程中的 evaluate()、processPendingJobs()、
+// 信号处理函数、定时器，或者执行了整个队列的兄弟引擎。Promise被直接resolve时不一定有任务执行，
+// 所以只要还有没完成的异步任务，就让工作线程再检查一遍（同一时刻最多投递一次）
+void QScriptEngine::scheduleAsyncSettle()
+{
+    if (m_async == nullptr || m_async->unsettled.load() == 0)
+        return;
+
+    // 工作线程自己执行任务时，由 runAsyncJobs()/settleAsyncJobs() 负责检查
+    if (QThread::currentThread() == &m_async->thread)
+        return;
+
+    if (m_async->settleScheduled.exchange(true))
+        return;
+
+    QMetaObject::invokeMethod(m_async->context, [this]() {
+        m_async->settleScheduled = false;
+        settleAsyncJobs();
+    }, Qt::QueuedConnection);
+}
+
+// 执行一批Promise任务，超出批次限制时把剩下的任务投递到事件循环
+int QScriptEngine::drainPendingJobs()
+{
+    if (!m_rt)
+        return 0;
+
+    EvalGuard guard(m_evalCount, m_runtime, this);
+
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 budgetNs = (m_jobTimeBudgetMs > 0) ? qint64(m_jobTimeBudgetMs) * 1000000 : -1;
+
+    int executed = 0;
+    int siblingJobs = 0;
+    bool deferred = false;
+    JSContext *jobCtx = nullptr;
+    while (std::atomic_load(&interrupt_flag) == 0
+           && m_runtime->limits.exceeded == NoLimitExceeded)
+    {
+        if ((m_jobBatchSize > 0 && executed >= m_jobBatchSize)
+            || (budgetNs > 0 && timer.nsecsElapsed() >= budgetNs))
+        {
+            deferred = JS_IsJobPending(m_rt);
+            break;
+        }
+
+        int ret = JS_ExecutePendingJob(m_rt, &jobCtx);
+        if (ret == 0)
+            break;
+
+        ++executed;
+        if (ret < 0 && jobCtx)
+        {
+            // 任务中未捕获的异常会体现在对应Promise的状态上，这里只需要在任务所属的context中清掉
+            JS_FreeValue(jobCtx, JS_GetException(jobCtx));
+        }
+
+        // 兄弟引擎排下的任务记到它自己的统计中
+        QScriptEngine *owner = jobCtx ? static_cast<QScriptEngine*>(JS_GetContextOpaque(jobCtx)) : nullptr;
+        if (owner != nullptr && owner != this)
+        {
+            ++siblingJobs;
+            {
+                QMutexLocker locker(&owner->m_jobStatsMutex);
+                owner->m_jobStats.jobsExecuted++;
+            }
+            owner->scheduleAsyncSettle();
+        }
+    }
+
+    if (executed > 0 || deferred)
+    {
+        const qint64 ns = timer.nsecsElapsed();
+
+        QMutexLocker locker(&m_jobStatsMutex);
+        m_jobStats.jobsExecuted += executed - siblingJobs;
+        m_jobStats.batchCount++;
+        m_jobStats.totalNs += ns;
+        m_jobStats.maxBatchNs = qMax(m_jobStats.maxBatchNs, ns);
+        if (deferred)
+        {
+            m_jobStats.deferredCount++;
+        }
+    }
+
+    if (deferred)
+    {
+        scheduleJobDrain();
+    }
+
+    scheduleAsyncSettle();
+
+    return executed;
+}
+
+// 在当前线程的事件循环中继续执行剩下的任务
+void QScriptEngine::scheduleJobDrain()
+{
+    QObject *receiver = nullptr;
+    QThread *current = QThread::currentThread();
+    if (m_async != nullptr && current == &m_async->thread)
+    {
+        receiver = m_async->context;
+    }
+    else if (current == thread())
+    {
+        receiver = this;
+    }
+
+    // 不知道当前线程的事件循环，剩下的任务留给下一次 evaluate() 或 processPendingJobs()
+    if (receiver == nullptr)
+        return;
+
+    if (m_jobDrainScheduled.exchange(true))
+        return;
+
+    QMetaObject::invokeMethod(receiver, [this]() {
+        m_jobDrainScheduled = false;
+        if (m_async != nullptr && QThread::currentThread() == &m_async->thread)
+        {
+            settleAsyncJobs();
+        }
+        else
+        {
+            processPendingJobs();
+        }
+    }, Qt::QueuedConnection);
+}
+
+int QScriptEngine::processPendingJobs()
+{
+    if (!m_ctx)
+        return 0;
+
+    RuntimeLocker locker(m_runtime);
+    return drainPendingJobs();
+}
+
+void QScriptEngine::setJobBatchSize(int size)
+{
+    m_jobBatchSize = size;
+}
+
+int QScriptEngine::jobBatchSize() const
+{
+    return m_jobBatchSize;
+}
+
+void QScriptEngine::setJobTimeBudget(int msecs)
+{
+    m_jobTimeBudgetMs = msecs;
+}
+
+int QScriptEngine::jobTimeBudget() const
+{
+    return m_jobTimeBudgetMs;
+}
+
+QScriptEngine::JobStatistics QScriptEngine::jobStatistics() const
+{
+    QMutexLocker locker(&m_jobStatsMutex);
+    return m_jobStats;
+}
+
+void QScriptEngine::resetJobStatistics()
+{
+    QMutexLocker locker(&m_jobStatsMutex);
+    m_jobStats = JobStatistics();
+}
+
+JSValue QScriptEngine::js_setTimer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic)
+{
+    Q_UNUSED(this_val);
+
+    QScriptEngine *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
+    if (!engine || !engine->m_timerWheel)
+        return JS_UNDEFINED;
+
+    const bool repeat = (magic == 1);
+    if (argc < 1 || !JS_IsFunction(ctx, argv[0]))
+    {
+        return JS_ThrowTypeError(ctx, "%s: callback is not a function", repeat ? "setInterval" : "setTimeout");
+    }
+
+    double delay = 0;
+    if (argc > 1 && JS_ToFloat64(ctx, &delay, argv[1]) < 0)
+        return JS_EXCEPTION;
+    // NaN、负数按0处理；setInterval 至少间隔1毫秒，否则会一直占住事件循环
+    if (!(delay >= 0))
+        delay = 0;
+    delay = qMin(delay, double(INT_MAX));
+    if (repeat)
+        delay = qMax(delay, 1.0);
+
+    TimerEntry timer;
+    timer.func     = JS_DupValue(ctx, argv[0]);
+    timer.interval = qint64(delay);
+    timer.repeat   = repeat;
+    for (int i = 2; i < argc; ++i)
+    {
+        timer.args.append(JS_DupValue(ctx, argv[i]));
+    }
+
+    // id 回绕之后跳过还在使用的，不能覆盖还没触发的定时器
+    const QHash<int, TimerEntry> &timers = engine->m_timers;
+    const int id = QScriptTimerWheel::allocateId(engine->m_nextTimerId, [&timers](int candidate) {
+        return timers.contains(candidate);
+    });
+
+    engine->m_timers.insert(id, timer);
+    engine->m_timerWheel->start(id, timer.interval, engine->m_timerClock.elapsed());
+    engine->armTimerDriver();
+
+    return JS_NewInt32(ctx, id);
+}
+
+JSValue QScriptEngine::js_clearTimer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv)
+{
+    Q_UNUSED(this_val);
+
+    QScriptEngine *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
+    if (!engine || !engine->m_timerWheel || argc < 1)
+        return JS_UNDEFINED;
+
+    int32_t id = 0;
+    if (JS_ToInt32(ctx, &id, argv[0]) < 0)
+        return JS_EXCEPTION;
+
+    auto it = engine->m_timers.find(id);
+    if (it == engine->m_timers.end())
+        return JS_UNDEFINED;
+
+    JS_FreeValue(ctx, it->func);
+    for (JSValue arg : it->args)
+    {
+        JS_FreeValue(ctx, arg);
+    }
+    engine->m_timers.erase(it);
+    engine->m_timerWheel->stop(id);
+
+    // 不主动停掉驱动定时器，空转一次的开销可以忽略
+    return JS_UNDEFINED;
+}
+
+void QScriptEngine::clearTimers()
+{
+    if (!m_ctx || !m_timerWheel)
+        return;
+
+    RuntimeLocker locker(m_runtime);
+
+    for (TimerEntry &timer : m_timers)
+    {
+        JS_FreeValue(m_ctx, timer.func);
+        for (JSValue arg : timer.args)
+        {
+            JS_FreeValue(m_ctx, arg);
+        }
+    }
+    m_timers.clear();
+    m_timerWheel->clear();
+
+    if (QThread::currentThread() == thread())
+    {
+        m_timerDriver->stop();
+    }
+}
+
+void QScriptEngine::clearAbortedTimers()
+{
+    if (m_timersAborted.exchange(false))
+    {
+        clearTimers();
+    }
+}
+
+// 根据时间轮中最近的槽重新设置驱动定时器，调用者需要持有runtime锁
+void QScriptEngine::armTimerDriver()
+{
+    // QTimer 只能在它所属的线程中启动，在工作线程里添加的定时器交给引擎所属线程处理
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, [this]() {
+            RuntimeLocker locker(m_runtime);
+            armTimerDriver();
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    qint64 timeout = m_timerWheel->nextTimeout(m_timerClock.elapsed());
+    if (timeout < 0)
+    {
+        m_timerDriver->stop();
+    }
+    else
+    {
+        m_timerDriver->start(int(qMin<qint64>(timeout, INT_MAX)));
+    }
+}
+
+void QScriptEngine::fireTimers()
+{
+    if (!m_ctx || !m_timerWheel)
+        return;
+
+    RuntimeLocker locker(m_runtime);
+
+    clearAbortedTimers();
+
+    QList<int> expired;
+    m_timerWheel->advance(m_timerClock.elapsed(), expired);
+
+    for (int id : expired)
+    {
+        auto it = m_timers.find(id);
+        if (it == m_timers.end())
+            continue;
+
+        // 回调中可能清除自己，先持有一份引用
+        JSValue func = JS_DupValue(m_ctx, it->func);
+        QVector<JSValue> args;
+        args.reserve(it->args.size());
+        for (JSValue arg : it->args)
+        {
+            args.append(JS_DupValue(m_ctx, arg));
+        }
+        const bool repeat = it->repeat;
+        const qint64 interval = it->interval;
+
+        // setTimeout 触发后就失效了
+        if (!repeat)
+        {
+            JS_FreeValue(m_ctx, it->func);
+            for (JSValue arg : it->args)
+            {
+                JS_FreeValue(m_ctx, arg);
+            }
+            m_timers.erase(it);
+        }
+
+        {
+            EvalGuard guard(m_evalCount, m_runtime, this);
+
+            JSValue ret = JS_Call(m_ctx, func, JS_UNDEFINED, args.size(), args.data());
+            if (JS_IsException(ret))
+            {
+                JSValue exception = JS_GetException(m_ctx);
+                if (m_runtime->limits.exceeded != NoLimitExceeded)
+                {
+                    JS_FreeValue(m_ctx, exception);
+                    exception = newLimitExceededError(m_ctx, m_runtime);
+                }
+                if (std::atomic_load(&interrupt_flag) == 0)
+                {
+                    QScriptValue qVal(m_ctx, exception, this);
+                    qWarning() << "Uncaught exception in timer callback:" << qVal.toString();
+                    if(agent() != nullptr)
+                    {
+                        agent()->exceptionThrow(-1, qVal, false);
+                    }
+                }
+                JS_FreeValue(m_ctx, exception);
+            }
+            JS_FreeValue(m_ctx, ret);
+        }
+
+        JS_FreeValue(m_ctx, func);
+        for (JSValue arg : args)
+        {
+            JS_FreeValue(m_ctx, arg);
+        }
+
+        // 回调被打断，说明调用了 abortEvaluation()，剩下的定时器已经（或者马上）被它取消
+        if (std::atomic_load(&interrupt_flag))
+        {
+            clearAbortedTimers();
+            return;
+        }
+
+        // 回调中没有被 clearInterval 时才重新计时
+        if (repeat && m_timers.contains(id))
+        {
+            m_timerWheel->start(id, interval, m_timerClock.elapsed());
+        }
+
+        // 每个回调之后执行它排下的Promise任务
+        drainPendingJobs();
+    }
+
+    armTimerDriver();
+}
+
+void QScriptEngine::stopAsyncWorker()
+{
+    if (m_async == nullptr)
+        return;
+
+    // 在工作线程里等它自己退出会永远等下去
+    if (QThread::currentThread() == &m_async->thread)
+    {
+        qFatal("QScriptEngine: the engine cannot be destroyed from a script running in evaluateAsync()");
+    }
+
+    QList<QScriptAsyncJob> queued;
+    {
+        QMutexLocker locker(&m_async->mutex);
+        m_async->stopping = true;
+        queued.swap(m_async->queue);
+    }
+
+    // 打断正在执行的脚本，然后等待工作线程退出
+    // 只设置 interrupt_flag 不够：工作线程刚取出的任务调用 evaluate() 时会把它复位
+    async_stopping.store(true);
+    std::atomic_store(&interrupt_flag, 1);
+    m_async->thread.quit();
+    m_async->thread.wait();
+    std::atomic_store(&interrupt_flag, 0);
+    async_stopping.store(false);
+
+    delete m_async->context;
+    m_async->context = nullptr;
+
+    for (QScriptAsyncJob &job : queued)
+    {
+        job.future.reportCanceled();
+        job.future.reportFinished();
+    }
+
+    if (!m_async->pending.isEmpty())
+    {
+        RuntimeLocker locker(m_runtime);
+        for (QScriptAsyncState::Pending &pending : m_async->pending)
+        {
+            JS_FreeValue(m_ctx, pending.promise);
+            pending.future.reportCanceled();
+            pending.future.reportFinished();
+        }
+        m_async->pending.clear();
+        m_async->unsettled.store(0);
+    }
+
+    delete m_async;
+    m_async = nullptr;
+}
+
+QScriptValue QScriptEngine::callFunction(JSValueConst func, JSValueConst thisObject, int argc, JSValueConst *argv, bool construct)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    RuntimeLocker locker(m_runtime);
+
+    if(agent() != nullptr)
+    {
+        agent()->functionEntry(-1);
+    }
+
+    EvalGuard guard(m_evalCount, m_runtime, this);
+
+    // 只有最外层的调用才复位中断标志，原生函数里的回调不能清掉外层脚本的中断请求
+    if (m_runtime->depth == 1)
+    {
+        std::atomic_store(&interrupt_flag, 0);
+    }
+
+    JSValue val;
+    if (construct && !JS_IsConstructor(m_ctx, func))
+    {
+        // 箭头函数、方法、普通原生函数等不能 new，和脚本里 new 一样抛 TypeError
+        val = JS_ThrowTypeError(m_ctx, "not a constructor");
+    }
+    else
+    {
+        val = construct
+                  ? JS_CallConstructor(m_ctx, func, argc, argv)
+                  : JS_Call(m_ctx, func, thisObject, argc, argv);
+    }
+
+    return finishEvaluate(val, -1, true);
+}
+
+int QScriptEngine::callFunctionBatch(JSValueConst func, JSValueConst thisObject, int rowCount, int argc,
+                                     const std::function<void(JSContext *, int, JSValue *)> &fillArguments,
+                                     QScriptValueList &results, QList<bool> *failed)
+{
+    if (!m_ctx || rowCount <= 0)
+        return 0;
+
+    RuntimeLocker locker(m_runtime);
+
+    // 整批调用对agent来说是一次函数调用
+    if(agent() != nullptr)
+    {
+        agent()->functionEntry(-1);
+    }
+
+    int called = 0;
+    {
+        EvalGuard guard(m_evalCount, m_runtime, this);
+
+        if (m_runtime->depth == 1)
+        {
+            std::atomic_store(&interrupt_flag, 0);
+        }
+
+        results.reserve(results.size() + rowCount);
+        if (failed)
+        {
+            failed->reserve(failed->size() + rowCount);
+        }
+
+        // 所有行复用同一个参数缓冲区
+        QVarLengthArray<JSValue, 8> argv(argc);
+
+        for (int row = 0; row < rowCount; ++row)
+        {
+            // 每行只多读一次标志：中断处理器要执行上万次跳转才回调一次，
+            // 回调中途调用的 abortEvaluation() 等不到它，剩下的行会继续执行
+            if (std::atomic_load_explicit(&interrupt_flag, std::memory_order_relaxed))
+                break;
+
+            fillArguments(m_ctx, row, argv.data());
+            JSValue ret = JS_Call(m_ctx, func, thisObject, argc, argv.data());
+            for (int i = 0; i < argc; ++i)
+            {
+                JS_FreeValue(m_ctx, argv[i]);
+            }
+
+            if (JS_IsException(ret))
+            {
+                JSValue exception = JS_GetException(m_ctx);
+
+                // 被打断时剩下的行不再调用
+                if (std::atomic_load(&interrupt_flag))
+                {
+                    JS_FreeValue(m_ctx, exception);
+                    break;
+                }
+
+                // 超出执行限制时这一行的结果是 TimeoutError，剩下的行不再调用
+                if (m_runtime->limits.exceeded != NoLimitExceeded)
+                {
+                    JS_FreeValue(m_ctx, exception);
+                    exception = newLimitExceededError(m_ctx, m_runtime);
+                    QScriptValue qVal(m_ctx, exception, this);
+                    JS_FreeValue(m_ctx, exception);
+                    results.append(qVal);
+                    if (failed)
+                        failed->append(true);
+                    ++called;
+                    break;
+                }
+
+                QScriptValue qVal(m_ctx, exception, this);
+                JS_FreeValue(m_ctx, exception);
+                if(agent() != nullptr)
+                {
+                    agent()->exceptionThrow(-1, qVal, false);
+                }
+                results.append(qVal);
+                if (failed)
+                    failed->append(true);
+            }
+            else
+            {
+                results.append(QScriptValue(m_ctx, ret, this));
+                JS_FreeValue(m_ctx, ret);
+                if (failed)
+                    failed->append(false);
+            }
+            ++called;
+        }
+
+        // 整批结束后执行一次Promise任务
+        if (m_runtime->depth == 1 && std::atomic_load(&interrupt_flag) == 0
+            && m_runtime->limits.exceeded == NoLimitExceeded)
+        {
+            drainPendingJobs();
+        }
+    }
+
+    if(agent() != nullptr)
+    {
+        agent()->functionExit(-1, QScriptValue());
+    }
+
+    return called;
+}
+
+QScriptValue QScriptEngine::globalObject() const
+{
+    return *mGlobalObject;
+}
+
+void QScriptEngine::setGlobalObject(const QScriptValue &object)
+{
+    Q_UNUSED(object);
+    // Not implemented: replacing the global object is non-trivial in QuickJS.
+}
+
+QScriptValue QScriptEngine::newObject()
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    JSValue val = JS_NewObject(m_ctx);
+
+    QScriptValue qVal = QScriptValue(m_ctx, val, this);
+
+    JS_FreeValue(m_ctx, val);
+
+    return qVal;
+}
+
+QScriptValue QScriptEngine::newObject(QScriptClass *scriptClass, const QScriptValue &data)
+{
+    if (!m_ctx)
+        return QScriptValue();
+    if (!scriptClass)
+        return newObject();
+
+    RuntimeLocker locker(m_runtime);
+
+    const JSClassID classId = scriptClassId(scriptClass);
+    if (classId == 0)
+        return QScriptValue();
+
+    const QScriptValue proto = scriptClass->prototype();
+    JSValue obj = proto.isObject()
+                      ? JS_NewObjectProtoClass(m_ctx, proto.rawValue(), classId)
+                      : JS_NewObjectClass(m_ctx, classId);
+    if (JS_IsException(obj))
+        return QScriptValue();
+
+    QScriptClassObject *o = new QScriptClassObject;
+    o->scriptClass = scriptClass;
+    o->data        = scriptValueToJS(m_ctx, data);
+    JS_SetOpaque(obj, o);
+
+    QScriptValue qVal = QScriptValue(m_ctx, obj, this);
+
+    JS_FreeValue(m_ctx, obj);
+
+    return qVal;
+}
+
+JSClassID QScriptEngine::scriptClassId(QScriptClass *scriptClass)
+{
+    // 每个 QScriptClass 在一个runtime中只注册一次，同一runtime中的引擎共用类ID
+    JSClassID classId = m_runtime->scriptClassIds.value(scriptClass, 0);
+    if (classId == 0)
+    {
+        QByteArray className = scriptClass->name().toUtf8();
+        if (className.isEmpty())
+            className = "Object";
+
+        JS_NewClassID(m_rt, &classId);
+        JSClassDef def;
+        memset(&def, 0, sizeof(def));
+        def.class_name = className.constData();
+        def.finalizer  = scriptClassFinalizer;
+        def.gc_mark    = scriptClassMark;
+        def.exotic     = &s_scriptClassExoticMethods;
+        if (JS_NewClass(m_rt, classId, &def) < 0)
+            return 0;
+
+        m_runtime->scriptClassIds.insert(scriptClass, classId);
+        m_runtime->scriptClasses.insert(classId);
+    }
+
+    // 默认原型是每个context各自的，第一次在本引擎中用到时设置；prototype() 无效时使用 Object.prototype
+    if (!m_scriptClassProtos.contains(classId))
+    {
+        JSValue plain = JS_NewObject(m_ctx);
+        JS_SetClassProto(m_ctx, classId, JS_GetPrototype(m_ctx, plain));
+        JS_FreeValue(m_ctx, plain);
+        m_scriptClassProtos.insert(classId);
+    }
+    return classId;
+}
+
+QScriptClass *QScriptEngine::scriptClassFromJSValue(JSValueConst val, QScriptValue *data) const
+{
+    if (!JS_IsObject(val))
+        return nullptr;
+
+    // 同一runtime中其它引擎创建的对象也能识别
+    const JSClassID classId = JS_GetClassID(val);
+    if (!m_runtime->scriptClasses.contains(classId))
+        return nullptr;
+
+    QScriptClassObject *o = static_cast<QScriptClassObject*>(JS_GetOpaque(val, classId));
+    if (!o)
+        return nullptr;
+    if (data)
+        *data = QScriptValue(m_ctx, o->data, const_cast<QScriptEngine*>(this));
+    return o->scriptClass;
+}
+
+// 属性名的缓存最多 StringHandleCacheSize 项，满了淘汰最久没用到的，
+// 大量一次性的名字（例如逐个访问百万个键）不会占住内存，也不会把常用的名字一起清掉
+QScriptString QScriptEngine::toStringHandle(const QString &str)
+{
+    if (!m_ctx)
+        return QScriptString();
+
+    RuntimeLocker locker(m_runtime);
+
+    if (const CachedAtom *cached = m_stringHandles.object(str))
+        return QScriptString(m_ctx, cached->atom);
+
+    const QByteArray utf8 = str.toUtf8();
+    const JSAtom atom = JS_NewAtomLen(m_ctx, utf8.constData(), size_t(utf8.size()));
+    if (atom == JS_ATOM_NULL)
+        return QScriptString();
+
+    // 先构造返回值，缓存项可能立即被淘汰
+    QScriptString handle(m_ctx, atom);
+    m_stringHandles.insert(str, new CachedAtom{m_ctx, atom, QString()});
+    return handle;
+}
+
+QString QScriptEngine::atomName(JSAtom atom)
+{
+    if (!m_ctx)
+        return QString();
+
+    RuntimeLocker locker(m_runtime);
+
+    if (const CachedAtom *cached = m_atomNames.object(atom))
+        return cached->name;
+
+    const char *str = JS_AtomToCString(m_ctx, atom);
+    if (!str)
+        return QString();
+    const QString name = QString::fromUtf8(str);
+    JS_FreeCString(m_ctx, str);
+
+    // 缓存项持有atom，保证键在缓存期间不会被回收后分配给别的字符串
+    m_atomNames.insert(atom, new CachedAtom{m_ctx, JS_DupAtom(m_ctx, atom), name});
+    return name;
+}
+
+void QScriptEngine::clearStringHandles()
+{
+    m_stringHandles.clear();
+    m_atomNames.clear();
+}
+
+QScriptValue QScriptEngine::newArray(uint length)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    JSValue arr = JS_NewArray(m_ctx);
+
+    if (length > 0)
+        JS_SetLength(m_ctx, arr, length);
+
+    QScriptValue qVal = QScriptValue(m_ctx, arr, this);
+
+    JS_FreeValue(m_ctx, arr);
+
+    return qVal;
+}
+
+
+QScriptValue QScriptEngine::newFunction(FunctionSignature signature, int length)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    // Wrap the FunctionSignature into a FunctionWithArgSignature via adapter.
+    void *arg = reinterpret_cast<void *>(signature);
+    return registerNativeFunction(functionSignatureAdapter, arg, length, JS_CFUNC_constructor_or_func_magic);
+}
+
+QScriptValue QScriptEngine::newFunction(FunctionSignature signature, int length, const QString &name)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    void *arg = reinterpret_cast<void *>(signature);
+    return registerNativeFunction(functionSignatureAdapter, arg, length, JS_CFUNC_constructor_or_func_magic, name);
+}
+
+QScriptValue QScriptEngine::newFunction(FunctionSignature signature,
+                                        const QScriptValue &prototype,
+                                        int length)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    void *arg = reinterpret_cast<void *>(signature);
+    QScriptValue fn = registerNativeFunction(functionSignatureAdapter, arg, length, JS_CFUNC_constructor_or_func_magic);
+
+    if (prototype.isValid()) {
+        // set function prototype using QuickJS constructor helper
+        JS_SetConstructor(m_ctx, fn.rawValue(), prototype.rawValue());
+    }
+
+    return fn;
+}
+
+QScriptValue QScriptEngine::newFunction(FunctionWithArgSignature signature, void *arg)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    return registerNativeFunction(signature, arg, 0, JS_CFUNC_generic_magic);
+}
+
+QScriptValue QScriptEngine::newFunction(FunctionWithArgSignature signature, void *arg, const QString &name)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    return registerNativeFunction(signature, arg, 0, JS_CFUNC_generic_magic, name);
+}
+
+QScriptValue QScriptEngine::newVariant(const QVariant &value)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    // 下面这些都得释放掉
+    JSValue jVal = JS_UNDEFINED;
+
+    if (value.type() == QVariant::String) {
+        jVal = JS_NewString(m_ctx, value.toString().toUtf8().constData());
+    }
+    else if (value.type() == QVariant::Bool) {
+        jVal = JS_NewBool(m_ctx, value.toBool());
+    }
+    else if (value.canConvert<double>()) {
+        jVal = JS_NewFloat64(m_ctx, value.toDouble());
+    }
+
+    QScriptValue qVal = QScriptValue(m_ctx, jVal, this);
+
+    if(!JS_IsUndefined(jVal))
+    {
+        JS_FreeValue(m_ctx, jVal);
+    }
+
+    return qVal;
+}
+
+QScriptValue QScriptEngine::newVariant(const QScriptValue &object, const QVariant &value)
+{
+    Q_UNUSED(object);
+    return newVariant(value);
+}
+
+// 包装对象的方法，func_data[0] 是 QScriptEngine::methodOverloads() 的下标
+// 下标是整个引擎的方法组计数，会超过 magic 的 int16 范围，所以放在函数数据上
+static JSValue qobjectMethodCall(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic, JSValueConst *func_data)
+{
+    Q_UNUSED(magic);
+    const int slot = JS_VALUE_GET_INT(func_data[0]);
+
+    QScriptEngine *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
+    if (!engine)
+        return JS_UNDEFINED;
+
+    // 检查中断标志
+    if (std::atomic_load(&engine->interrupt_flag))
+        return JS_ThrowTypeError(ctx, "%s", "stop");
+
+    QObject *object = engine->qobjectFromJSValue(ctx, this_val);
+    if (!object)
+    {
+        if (JS_HasException(ctx))
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        return JS_ThrowTypeError(ctx, "not a QObject wrapper or the QObject has been deleted");
+    }
+
+    // 方法下标只对所属的类有效，a.method.call(b) 中 b 的类型不对时会调用到别的方法上
+    const QMetaObject *owner = engine->methodOwner(slot);
+    if (!object->metaObject()->inherits(owner))
+    {
+        return JS_ThrowTypeError(ctx, "%s method called on an object of type %s",
+                                 owner->className(), object->metaObject()->className());
+    }
+
+    // 参数个数相同的重载优先，其次是参数最多、但不超过实参个数的重载（多余的实参忽略）
+    // 都需要更多参数时取第一个，下面会因为参数不够抛出 TypeError
+    const QVector<int> &overloads = engine->methodOverloads(slot);
+    QMetaMethod method = owner->method(overloads.first());
+    int bestCount = -1;
+    for (int index : overloads)
+    {
+        QMetaMethod candidate = owner->method(index);
+        const int count = candidate.parameterCount();
+        if (count == argc)
+        {
+            method = candidate;
+            break;
+        }
+        if (count < argc && count > bestCount)
+        {
+            method = candidate;
+            bestCount = count;
+        }
+    }
+
+    // 带默认值的参数 moc 会生成参数较少的重载，其余情况参数不够时不用默认构造的值凑数
+    const int paramCount = method.parameterCount();
+    if (argc < paramCount)
+    {
+        return JS_ThrowTypeError(ctx, "%s: expected %d arguments, got %d",
+                                 method.methodSignature().constData(), paramCount, argc);
+    }
+
+    // args[0] 是返回值，后面依次是参数，一般都在栈上构造，参数太多的方法才在堆上分配
+    QScriptMetaArgument inlineStorage[QScriptMetaArgument::MaxArguments + 1];
+    void *inlineArgs[QScriptMetaArgument::MaxArguments + 1] = {};
+    std::unique_ptr<QScriptMetaArgument[]> heapStorage;
+    std::unique_ptr<void *[]> heapArgs;
+    QScriptMetaArgument *storage = inlineStorage;
+    void **args = inlineArgs;
+    if (paramCount > QScriptMetaArgument::MaxArguments)
+    {
+        heapStorage.reset(new QScriptMetaArgument[paramCount + 1]);
+        heapArgs.reset(new void *[paramCount + 1]());
+        storage = heapStorage.get();
+        args = heapArgs.get();
+    }
+
+    const int returnType = method.returnType();
+    if (returnType != QMetaType::Void)
+    {
+        if (!storage[0].construct(returnType))
+        {
+            return JS_ThrowTypeError(ctx, "%s: unsupported return type %s",
+                                     method.methodSignature().constData(), method.typeName());
+        }
+        args[0] = storage[0].data;
+    }
+
+    for (int i = 0; i < paramCount; ++i)
+    {
+        if (!convertToMetaType(ctx, engine, argv[i], method.parameterType(i), storage[i + 1]))
+        {
+            if (JS_HasException(ctx))
+                return JS_EXCEPTION;
+            return JS_ThrowTypeError(ctx, "%s: cannot convert argument %d to %s",
+                                     method.methodSignature().constData(), i + 1,
+                                     method.parameterTypes().at(i).constData());
+        }
+        args[i + 1] = storage[i + 1].data;
+    }
+
+    // 与 Qt Script 一样直接调用，不经过事件循环
+    QMetaObject::metacall(object, QMetaObject::InvokeMetaMethod, method.methodIndex(), args);
+
+    if (returnType == QMetaType::Void)
+        return JS_UNDEFINED;
+    return metaTypeToJSValue(ctx, engine, returnType, storage[0].data);
+}
+
+QScriptMetaObjectBinding *QScriptEngine::metaObjectBinding(const QMetaObject *metaObject, QObjectWrapOptions options)
+{
+    // PreferExistingWrapperObject 只影响包装对象的复用，与成员无关
+    options &= ~PreferExistingWrapperObject;
+
+    const QPair<const QMetaObject*, int> key(metaObject, int(options));
+    auto it = m_metaObjectBindings.constFind(key);
+    if (it != m_metaObjectBindings.constEnd())
+        return it.value();
+
+    // 只创建一个空的原型，成员都在第一次访问时解析
+    QScriptMetaObjectBinding *binding = new QScriptMetaObjectBinding;
+    binding->metaObject = metaObject;
+    binding->options    = options;
+    binding->prototype  = JS_NewObject(m_ctx);
+    m_metaObjectBindings.insert(key, binding);
+    return binding;
+}
+
+// 同名的方法（包括父类的）归为一组重载，只在第一次查找方法时建立
+void QScriptEngine::indexMetaObjectMethods(QScriptMetaObjectBinding *binding)
+{
+    if (binding->methodsIndexed)
+        return;
+    binding->methodsIndexed = true;
+
+    // 被选项排除的方法根本不会登记
+    const QMetaObject *metaObject = binding->metaObject;
+    const QObjectWrapOptions options = binding->options;
+    const int first = (options & ExcludeSuperClassMethods) ? metaObject->methodOffset() : 0;
+    for (int i = first; i < metaObject->methodCount(); ++i)
+    {
+        QMetaMethod method = metaObject->method(i);
+        const QByteArray name = method.name();
+        switch (method.methodType()) {
+        case QMetaMethod::Method:
+            break;
+        case QMetaMethod::Slot:
+            if (options & ExcludeSlots)
+                continue;
+            break;
+        case QMetaMethod::Signal:
+            if (!binding->signalIndexes.contains(name))
+                binding->signalIndexes.insert(name, i);
+            continue;
+        default:
+            continue;
+        }
+
+        if ((options & ExcludeDeleteLater) && name == "deleteLater")
+            continue;
+
+        auto slot = binding->methodSlots.find(name);
+        if (slot == binding->methodSlots.end())
+        {
+            slot = binding->methodSlots.insert(name, m_methodOverloads.size());
+            m_methodOverloads.append(QVector<int>());
+            m_methodOwners.append(metaObject);
+        }
+        m_methodOverloads[slot.value()].append(i);
+    }
+}
+
+QScriptMetaObjectMember QScriptEngine::metaObjectMember(QScriptMetaObjectBinding *binding, JSAtom atom)
+{
+    auto it = binding->members.constFind(atom);
+    if (it != binding->members.constEnd())
+        return it.value();
+
+    QScriptMetaObjectMember member;
+
+    // Symbol 不会是QObject的成员
+    JSValue key = JS_AtomToValue(m_ctx, atom);
+    const bool isSymbol = JS_IsSymbol(key);
+    JS_FreeValue(m_ctx, key);
+
+    const char *name = isSymbol ? nullptr : JS_AtomToCString(m_ctx, atom);
+    if (name)
+    {
+        const QMetaObject *metaObject = binding->metaObject;
+        int propertyIndex = metaObject->indexOfProperty(name);
+        if ((binding->options & ExcludeSuperClassProperties) && propertyIndex < metaObject->propertyOffset())
+        {
+            propertyIndex = -1;
+        }
+        if (propertyIndex >= 0)
+        {
+            member.kind       = QScriptMetaObjectMember::Property;
+            member.index      = propertyIndex;
+            member.directType = directPropertyType(metaObject->property(propertyIndex));
+        }
+        else
+        {
+            indexMetaObjectMethods(binding);
+            auto slot = binding->methodSlots.constFind(QByteArray(name));
+            if (slot != binding->methodSlots.constEnd())
+            {
+                const int length = metaObject->method(m_methodOverloads.at(slot.value()).first()).parameterCount();
+                member.kind     = QScriptMetaObjectMember::Method;
+                member.index    = slot.value();
+                JSValue data = JS_NewInt32(m_ctx, slot.value());
+                member.function = JS_NewCFunctionData(m_ctx, qobjectMethodCall, length, 0, 1, &data);
+                if (!JS_IsException(member.function))
+                {
+                    JS_DefinePropertyValueStr(m_ctx, member.function, "name", JS_NewString(m_ctx, name), JS_PROP_CONFIGURABLE);
+                }
+            }
+            else
+            {
+                auto signal = binding->signalIndexes.constFind(QByteArray(name));
+                if (signal != binding->signalIndexes.constEnd())
+                {
+                    member.kind  = QScriptMetaObjectMember::Signal;
+                    member.index = signal.value();
+                }
+            }
+        }
+        JS_FreeCString(m_ctx, name);
+    }
+
+    // 不是成员的名字也缓存下来
+    binding->members.insert(JS_DupAtom(m_ctx, atom), member);
+    return member;
+}
+
+const QVector<JSAtom> &QScriptEngine::metaObjectMemberNames(QScriptMetaObjectBinding *binding)
+{
+    if (binding->namesIndexed)
+        return binding->memberNames;
+    binding->namesIndexed = true;
+
+    const QMetaObject *metaObject = binding->metaObject;
+    QSet<QByteArray> seen;
+    const int firstProperty = (binding->options & ExcludeSuperClassProperties) ? metaObject->propertyOffset() : 0;
+    for (int i = firstProperty; i < metaObject->propertyCount(); ++i)
+    {
+        const QByteArray name = metaObject->property(i).name();
+        if (!seen.contains(name))
+        {
+            seen.insert(name);
+            binding->memberNames.append(JS_NewAtom(m_ctx, name.constData()));
+        }
+    }
+
+    if (binding->options & SkipMethodsInEnumeration)
+        return binding->memberNames;
+
+    indexMetaObjectMethods(binding);
+    for (auto it = binding->methodSlots.constBegin(); it != binding->methodSlots.constEnd(); ++it)
+    {
+        if (!seen.contains(it.key()))
+        {
+            seen.insert(it.key());
+            binding->memberNames.append(JS_NewAtom(m_ctx, it.key().constData()));
+        }
+    }
+    for (auto it = binding->signalIndexes.constBegin(); it != binding->signalIndexes.constEnd(); ++it)
+    {
+        if (!seen.contains(it.key()))
+        {
+            seen.insert(it.key());
+            binding->memberNames.append(JS_NewAtom(m_ctx, it.key().constData()));
+        }
+    }
+    return binding->memberNames;
+}
+
+void QScriptEngine::clearMetaObjectBindings()
+{
+    for (QScriptMetaObjectBinding *binding : std::as_const(m_metaObjectBindings))
+    {
+        for (auto it = binding->members.begin(); it != binding->members.end(); ++it)
+        {
+            JS_FreeValue(m_ctx, it.value().function);
+            JS_FreeAtom(m_ctx, it.key());
+        }
+        for (JSAtom atom : std::as_const(binding->memberNames))
+        {
+            JS_FreeAtom(m_ctx, atom);
+        }
+        JS_FreeValue(m_ctx, binding->prototype);
+        delete binding;
+    }
+    m_metaObjectBindings.clear();
+    m_methodOverloads.clear();
+    m_methodOwners.clear();
+}
+
+void QScriptEngine::clearWrapperCache()
+{
+    for (auto it = m_wrapperCache.constBegin(); it != m_wrapperCache.constEnd(); ++it)
+    {
+        QObjectWrapper *w = it.value();
+        if (w->obj)
+        {
+            disconnect(w->obj, &QObject::destroyed, this, &QScriptEngine::wrappedObjectDestroyed);
+        }
+        w->cacheOwner = nullptr;
+    }
+    m_wrapperCache.clear();
+}
+
+void QScriptEngine::removeCachedWrapper(QObjectWrapper *wrapper)
+{
+    RuntimeLocker locker(m_runtime);
+
+    // 同一个QObject的其它包装对象还在缓存中时，继续监听 destroyed
+    if (m_wrapperCache.remove(wrapper->cacheKey, wrapper) > 0
+        && wrapper->obj && !m_wrapperCache.contains(wrapper->cacheKey))
+    {
+        disconnect(wrapper->obj, &QObject::destroyed, this, &QScriptEngine::wrappedObjectDestroyed);
+    }
+    wrapper->cacheOwner = nullptr;
+}
+
+// QObject 在引擎所在线程中删除时直接调用，在其它线程中删除时通过事件排队调用，
+// 避免在发出信号的线程上等待 RuntimeLocker（那个线程可能正持有引擎在等待的锁）
+// 排队期间同一地址上可能已经创建了新的QObject，所以只移除目标已经失效的项；
+// 失效的项在此之前也不会被 newQObject 复用
+void QScriptEngine::wrappedObjectDestroyed(QObject *object)
+{
+    RuntimeLocker locker(m_runtime);
+
+    auto it = m_wrapperCache.find(object);
+    while (it != m_wrapperCache.end() && it.key() == object)
+    {
+        QObjectWrapper *w = it.value();
+        if (w->obj.isNull())
+        {
+            w->cacheOwner = nullptr;
+            it = m_wrapperCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+// signal.connect(function) 或者 signal.connect(thisObject, function)，magic 为1时是 disconnect
+static JSValue signalConnect(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic)
+{
+    const char *what = magic ? "disconnect" : "connect";
+    QScriptEngine *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
+    QScriptSignalHandle *handle = static_cast<QScriptSignalHandle*>(JS_GetOpaque(this_val, s_signalClassId));
+    if (!engine || !handle)
+        return JS_ThrowTypeError(ctx, "%s: this is not a signal", what);
+    if (!handle->sender)
+        return JS_ThrowTypeError(ctx, "%s: the QObject has been deleted", what);
+
+    JSValueConst thisObject = JS_UNDEFINED;
+    JSValueConst function   = (argc > 0) ? argv[0] : JS_UNDEFINED;
+    if (argc > 1)
+    {
+        thisObject = argv[0];
+        function   = argv[1];
+    }
+    if (!JS_IsFunction(ctx, function))
+        return JS_ThrowTypeError(ctx, "%s: target is not a function", what);
+
+    const bool ok = magic
+                        ? engine->disconnectSignal(handle->sender, handle->signalIndex, thisObject, function)
+                        : engine->connectSignal(handle->sender, handle->signalIndex, thisObject, function);
+    if (!ok)
+        return JS_ThrowTypeError(ctx, "%s: failed to %s", what, what);
+    return JS_UNDEFINED;
+}
+
+static const QEvent::Type s_signalDispatchEvent = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+// 引擎中所有 信号 -> 脚本函数 的连接都连到这一个对象上
+// 没有 Q_OBJECT：重写 qt_metacall，QObject 自己的方法之后的下标就是连接的编号，
+// 信号的参数直接从 void** 中转换成JS值，不经过 QVariant
+class QScriptSignalReceiver : public QObject
+{
+public:
+    explicit QScriptSignalReceiver(QScriptEngine *engine)
+        : QObject(engine), m_engine(engine)
+    {
+    }
+    ~QScriptSignalReceiver() override;
+
+    bool connectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function);
+    bool disconnectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function);
+
+    int qt_metacall(QMetaObject::Call call, int id, void **args) override;
+
+protected:
+    bool event(QEvent *e) override;
+
+private:
+    struct Connection {
+        QPointer<QObject> sender;
+        int signalIndex{-1};
+        JSValue thisObject{JS_UNDEFINED};
+        JSValue function{JS_UNDEFINED};
+        QVector<int> parameterTypes;
+        QMetaObject::Connection handle;
+    };
+    // 其它线程中发射的信号，参数复制一份后排队到引擎所在的线程
+    struct PendingEmission {
+        int id{-1};
+        std::vector<std::unique_ptr<QScriptMetaArgument>> arguments;
+    };
+
+    void invoke(int id, void *const *args);
+    void queue(int id, void **args);
+    void releaseConnection(Connection &connection);
+    bool hasLiveConnection(QObject *sender) const;
+    void senderDestroyed(QObject *sender);
+
+    QScriptEngine *m_engine;
+    // m_connections 的参数类型会在发射信号的线程中读取，m_pending 在两个线程之间传递
+    QMutex m_lock;
+    QHash<int, Connection> m_connections;
+    int m_nextId{0};
+    // 每个有连接的发送者监听一次 destroyed，发送者删除时释放它的连接
+    QHash<QObject*, QMetaObject::Connection> m_senderWatches;
+    std::vector<PendingEmission> m_pending;
+    int m_postedEvents{0};
+};
+
+QScriptSignalReceiver::~QScriptSignalReceiver()
+{
+    for (Connection &connection : m_connections)
+    {
+        QObject::disconnect(connection.handle);
+        releaseConnection(connection);
+    }
+    m_connections.clear();
+}
+
+void QScriptSignalReceiver::releaseConnection(Connection &connection)
+{
+    JS_FreeValue(m_engine->m_ctx, connection.thisObject);
+    JS_FreeValue(m_engine->m_ctx, connection.function);
+    connection.thisObject = JS_UNDEFINED;
+    connection.function   = JS_UNDEFINED;
+}
+
+// 调用者持有 m_lock
+bool QScriptSignalReceiver::hasLiveConnection(QObject *sender) const
+{
+    for (const Connection &connection : m_connections)
+    {
+        if (connection.sender == sender)
+            return true;
+    }
+    return false;
+}
+
+// 发送者被删除后Qt已经断开了连接，这里只需要释放脚本函数
+// 在其它线程删除时排队到这里，期间同一地址上可能已经有了新的发送者，所以只移除发送者已经失效的连接
+void QScriptSignalReceiver::senderDestroyed(QObject *sender)
+{
+    RuntimeLocker locker(m_engine->m_runtime);
+    QMutexLocker lock(&m_lock);
+
+    for (auto it = m_connections.begin(); it != m_connections.end(); )
+    {
+        if (!it->sender)
+        {
+            releaseConnection(*it);
+            it = m_connections.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (!hasLiveConnection(sender))
+    {
+        m_senderWatches.remove(sender);
+    }
+}
+
+bool QScriptSignalReceiver::connectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function)
+{
+    JSContext *ctx = m_engine->m_ctx;
+
+    QMutexLocker lock(&m_lock);
+
+    const int id = m_nextId++;
+    Connection connection;
+    connection.sender      = sender;
+    connection.signalIndex = signalIndex;
+    connection.thisObject  = JS_DupValue(ctx, thisObject);
+    connection.function    = JS_DupValue(ctx, function);
+
+    // 没有注册的参数类型传给脚本 undefined
+    const QMetaMethod signal = sender->metaObject()->method(signalIndex);
+    connection.parameterTypes.reserve(signal.parameterCount());
+    for (int i = 0; i < signal.parameterCount(); ++i)
+    {
+        connection.parameterTypes.append(signal.parameterType(i));
+    }
+
+    // 总是直接连接，在 qt_metacall 中按发射信号的线程决定立即执行还是排队
+    connection.handle = QMetaObject::connect(sender, signalIndex,
+                                             this, QObject::staticMetaObject.methodCount() + id,
+                                             Qt::DirectConnection);
+    if (!connection.handle)
+    {
+        releaseConnection(connection);
+        return false;
+    }
+
+    // 已经删除的发送者的监听Qt会自动断开，同一地址上的新发送者需要重新监听
+    auto watch = m_senderWatches.find(sender);
+    if (watch == m_senderWatches.end() || !*watch)
+    {
+        // AutoConnection：在其它线程删除时排队到接收对象所在的线程
+        m_senderWatches.insert(sender, QObject::connect(sender, &QObject::destroyed, this,
+                                                        [this](QObject *object) { senderDestroyed(object); }));
+    }
+
+    m_connections.insert(id, connection);
+    return true;
+}
+
+bool QScriptSignalReceiver::disconnectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function)
+{
+    QMutexLocker lock(&m_lock);
+
+    // 没有指定 thisObject 时只比较函数
+    const bool matchThis = !JS_IsUndefined(thisObject);
+    for (auto it = m_connections.begin(); it != m_connections.end(); ++it)
+    {
+        if (it->sender != sender || it->signalIndex != signalIndex)
+            continue;
+        if (JS_VALUE_GET_PTR(it->function) != JS_VALUE_GET_PTR(function))
+            continue;
+        if (matchThis && (!JS_IsObject(it->thisObject)
+                          || JS_VALUE_GET_PTR(it->thisObject) != JS_VALUE_GET_PTR(thisObject)))
+            continue;
+
+        QObject::disconnect(it->handle);
+        releaseConnection(*it);
+        m_connections.erase(it);
+
+        // 最后一个连接断开后不再监听这个发送者
+        if (!hasLiveConnection(sender))
+        {
+            QObject::disconnect(m_senderWatches.take(sender));
+        }
+        return true;
+    }
+    return false;
+}
+
+int QScriptSignalReceiver::qt_metacall(QMetaObject::Call call, int id, void **args)
+{
+    id = QObject::qt_metacall(call, id, args);
+    if (id < 0 || call != QMetaObject::InvokeMetaMethod)
+        return id;
+
+    if (QThread::currentThread() != thread())
+    {
+        queue(id, args);
+        return -1;
+    }
 
-    JSValue val = JS_NewObject(m_ctx);
+    RuntimeLocker locker(m_engine->m_runtime);
 
-    QScriptValue qVal = QScriptValue(m_ctx, val, this);
+    // abortEvaluation() 之后不再执行信号连接的函数，直到下一次 evaluate
+    if (std::atomic_load(&m_engine->interrupt_flag))
+        return -1;
 
-    JS_FreeValue(m_ctx, val);
+    {
+        EvalGuard guard(m_engine->m_evalCount, m_engine->m_runtime, m_engine);
+        invoke(id, args + 1);
+    }
 
-    return qVal;
+    // 信号可能是在脚本调用的方法中发射的，只在最外层执行Promise任务
+    if (m_engine->m_runtime->depth == 0)
+    {
+        m_engine->drainPendingJobs();
+    }
+    return -1;
 }
 
-QScriptValue QScriptEngine::newObject(QScriptClass *scriptClass, const QScriptValue &data)
+void QScriptSignalReceiver::queue(int id, void **args)
 {
-    Q_UNUSED(scriptClass);
-    Q_UNUSED(data);
-    return newObject();
+    bool post = false;
+    {
+        QMutexLocker lock(&m_lock);
+        auto it = m_connections.constFind(id);
+        if (it == m_connections.constEnd())
+            return;
+
+        // 参数只在发射期间有效，按类型复制一份
+        PendingEmission emission;
+        emission.id = id;
+        for (int i = 0; i < it->parameterTypes.size(); ++i)
+        {
+            std::unique_ptr<QScriptMetaArgument> argument(new QScriptMetaArgument);
+            argument->construct(it->parameterTypes.at(i), args[i + 1]);
+            emission.arguments.push_back(std::move(argument));
+        }
+        m_pending.push_back(std::move(emission));
+
+        // 合并时只要有一个事件在路上，后来的信号就跟着它一起执行
+        post = !m_engine->isQueuedSignalCoalescingEnabled() || m_postedEvents == 0;
+        if (post)
+            ++m_postedEvents;
+    }
+    if (post)
+    {
+        QCoreApplication::postEvent(this, new QEvent(s_signalDispatchEvent));
+    }
 }
 
-QScriptValue QScriptEngine::newArray(uint length)
+bool QScriptSignalReceiver::event(QEvent *e)
 {
-    if (!m_ctx)
-        return QScriptValue();
-
-    JSValue arr = JS_NewArray(m_ctx);
+    if (e->type() != s_signalDispatchEvent)
+        return QObject::event(e);
 
-    if (length > 0)
-        JS_SetLength(m_ctx, arr, length);
-
-    QScriptValue qVal = QScriptValue(m_ctx, arr, this);
+    // 最后一个事件把剩下的都取走，中途切换合并选项也不会有信号被遗漏
+    std::vector<PendingEmission> batch;
+    {
+        QMutexLocker lock(&m_lock);
+        --m_postedEvents;
+        if (m_postedEvents == 0 || m_engine->isQueuedSignalCoalescingEnabled())
+        {
+            batch.swap(m_pending);
+        }
+        else if (!m_pending.empty())
+        {
+            batch.push_back(std::move(m_pending.front()));
+            m_pending.erase(m_pending.begin());
+        }
+    }
+    if (batch.empty())
+        return true;
 
-    JS_FreeValue(m_ctx, arr);
+    RuntimeLocker locker(m_engine->m_runtime);
+    if (std::atomic_load(&m_engine->interrupt_flag))
+        return true;
 
-    return qVal;
-}
+    // 一批信号是一个脚本轮次：一个 EvalGuard，最后执行一次Promise任务
+    {
+        EvalGuard guard(m_engine->m_evalCount, m_engine->m_runtime, m_engine);
 
+        QVarLengthArray<void *, 8> args;
+        for (const PendingEmission &emission : batch)
+        {
+            args.resize(int(emission.arguments.size()));
+            for (size_t i = 0; i < emission.arguments.size(); ++i)
+            {
+                args[int(i)] = emission.arguments[i]->data;
+            }
+            invoke(emission.id, args.data());
 
-QScriptValue QScriptEngine::newFunction(FunctionSignature signature, int length)
-{
-    if (!m_ctx)
-        return QScriptValue();
+            if (std::atomic_load(&m_engine->interrupt_flag)
+                || m_engine->m_runtime->limits.exceeded != QScriptEngine::NoLimitExceeded)
+            {
+                break;
+            }
+        }
+    }
 
-    // Wrap the FunctionSignature into a FunctionWithArgSignature via adapter.
-    void *arg = reinterpret_cast<void *>(signature);
-    return registerNativeFunction(functionSignatureAdapter, arg, length, JS_CFUNC_constructor_or_func_magic);
+    if (m_engine->m_runtime->depth == 0)
+    {
+        m_engine->drainPendingJobs();
+    }
+    return true;
 }
 
-QScriptValue QScriptEngine::newFunction(FunctionSignature signature,
-                                        const QScriptValue &prototype,
-                                        int length)
+// 调用者持有 RuntimeLocker 和 EvalGuard；args 是各个参数的指针，为空时传 undefined
+void QScriptSignalReceiver::invoke(int id, void *const *args)
 {
-    if (!m_ctx)
-        return QScriptValue();
+    JSContext *ctx = m_engine->m_ctx;
 
-    void *arg = reinterpret_cast<void *>(signature);
-    QScriptValue fn = registerNativeFunction(functionSignatureAdapter, arg, length, JS_CFUNC_constructor_or_func_magic);
+    // 回调中可能断开自己，先持有一份引用
+    JSValue function   = JS_UNDEFINED;
+    JSValue thisObject = JS_UNDEFINED;
+    QVector<int> types;
+    {
+        QMutexLocker lock(&m_lock);
+        auto it = m_connections.constFind(id);
+        if (it == m_connections.constEnd())
+            return;
+        function   = JS_DupValue(ctx, it->function);
+        thisObject = JS_DupValue(ctx, it->thisObject);
+        types      = it->parameterTypes;
+    }
 
-    if (prototype.isValid()) {
-        // set function prototype using QuickJS constructor helper
-        JS_SetConstructor(m_ctx, fn.rawValue(), prototype.rawValue());
+    QVarLengthArray<JSValue, 8> argv(types.size());
+    for (int i = 0; i < types.size(); ++i)
+    {
+        argv[i] = (types.at(i) == QMetaType::UnknownType || !args[i])
+                      ? JS_UNDEFINED
+                      : metaTypeToJSValue(ctx, m_engine, types.at(i), args[i]);
     }
 
-    return fn;
+    JSValue ret = JS_Call(ctx, function, thisObject, argv.size(), argv.data());
+    if (JS_IsException(ret))
+    {
+        JSValue exception = JS_GetException(ctx);
+        if (m_engine->m_runtime->limits.exceeded != QScriptEngine::NoLimitExceeded)
+        {
+            JS_FreeValue(ctx, exception);
+            exception = newLimitExceededError(ctx, m_engine->m_runtime);
+        }
+        if (std::atomic_load(&m_engine->interrupt_flag) == 0)
+        {
+            QScriptValue qVal(ctx, exception, m_engine);
+            qWarning() << "Uncaught exception in signal handler:" << qVal.toString();
+            if (m_engine->agent() != nullptr)
+            {
+                m_engine->agent()->exceptionThrow(-1, qVal, false);
+            }
+        }
+        JS_FreeValue(ctx, exception);
+    }
+    JS_FreeValue(ctx, ret);
+
+    for (JSValue arg : argv)
+    {
+        JS_FreeValue(ctx, arg);
+    }
+    JS_FreeValue(ctx, function);
+    JS_FreeValue(ctx, thisObject);
 }
 
-QScriptValue QScriptEngine::newFunction(FunctionWithArgSignature signature, void *arg)
+JSValue QScriptEngine::newSignalObject(QObject *sender, int signalIndex)
 {
-    if (!m_ctx)
-        return QScriptValue();
+    // 所有信号对象共用一个原型
+    if (JS_IsUndefined(m_signalPrototype))
+    {
+        m_signalPrototype = JS_NewObject(m_ctx);
+        JS_SetPropertyStr(m_ctx, m_signalPrototype, "connect",
+                          JS_NewCFunctionMagic(m_ctx, signalConnect, "connect", 1, JS_CFUNC_generic_magic, 0));
+        JS_SetPropertyStr(m_ctx, m_signalPrototype, "disconnect",
+                          JS_NewCFunctionMagic(m_ctx, signalConnect, "disconnect", 1, JS_CFUNC_generic_magic, 1));
+    }
 
-    return registerNativeFunction(signature, arg, 0, JS_CFUNC_generic_magic);
+    JSValue signal = JS_NewObjectProtoClass(m_ctx, m_signalPrototype, s_signalClassId);
+    if (JS_IsException(signal))
+        return signal;
+
+    QScriptSignalHandle *handle = new QScriptSignalHandle;
+    handle->sender      = sender;
+    handle->signalIndex = signalIndex;
+    JS_SetOpaque(signal, handle);
+    return signal;
 }
 
-QScriptValue QScriptEngine::newVariant(const QVariant &value)
+bool QScriptEngine::connectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function)
 {
-    if (!m_ctx)
-        return QScriptValue();
-
-    // 下面这些都得释放掉
-    JSValue jVal = JS_UNDEFINED;
+    if (!m_ctx || !sender)
+        return false;
 
-    if (value.type() == QVariant::String) {
-        jVal = JS_NewString(m_ctx, value.toString().toUtf8().constData());
-    }
-    else if (value.type() == QVariant::Bool) {
-        jVal = JS_NewBool(m_ctx, value.toBool());
-    }
-    else if (value.canConvert<double>()) {
-        jVal = JS_NewFloat64(m_ctx, value.toDouble());
+    RuntimeLocker locker(m_runtime);
+    if (!m_signalReceiver)
+    {
+        m_signalReceiver = new QScriptSignalReceiver(this);
     }
+    return m_signalReceiver->connectSignal(sender, signalIndex, thisObject, function);
+}
 
-    QScriptValue qVal = QScriptValue(m_ctx, jVal, this);
+bool QScriptEngine::disconnectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function)
+{
+    if (!m_ctx || !sender || !m_signalReceiver)
+        return false;
 
-    if(!JS_IsUndefined(jVal))
-    {
-        JS_FreeValue(m_ctx, jVal);
-    }
+    RuntimeLocker locker(m_runtime);
+    return m_signalReceiver->disconnectSignal(sender, signalIndex, thisObject, function);
+}
 
-    return qVal;
+void QScriptEngine::setQueuedSignalCoalescingEnabled(bool enabled)
+{
+    m_coalesceQueuedSignals.store(enabled, std::memory_order_relaxed);
 }
 
-QScriptValue QScriptEngine::newVariant(const QScriptValue &object, const QVariant &value)
+bool QScriptEngine::isQueuedSignalCoalescingEnabled() const
 {
-    Q_UNUSED(object);
-    return newVariant(value);
+    return m_coalesceQueuedSignals.load(std::memory_order_relaxed);
+}
+
+void QScriptEngine::clearSignalConnections()
+{
+    // 排队中的信号随接收对象一起丢弃
+    delete m_signalReceiver;
+    m_signalReceiver = nullptr;
+
+    JS_FreeValue(m_ctx, m_signalPrototype);
+    m_signalPrototype = JS_UNDEFINED;
 }
 
 QScriptValue QScriptEngine::newQObject(QObject *object,
                                        QScriptEngine::ValueOwnership ownership,
                                        const QScriptEngine::QObjectWrapOptions &options)
 {
-    Q_UNUSED(options);
     if (!m_ctx || !object)
         return QScriptValue();
 
-    JSValue jsObj = JS_NewObjectClass(m_ctx, m_qobjectClassId);
-    if (JS_IsException(jsObj))
-        return QScriptValue();
-
-    QObjectWrapper *w = new QObjectWrapper{object, ownership};
-    JS_SetOpaque(jsObj, w);
-
-    // JS_SetPropertyFunctionList(ctx, jsObj, rect_proto_funcs, countof(rect_proto_funcs));
-
-    QScriptValue qVal = QScriptValue(m_ctx, jsObj, this);
+    RuntimeLocker locker(m_runtime);
 
-    // 创建好对象后，还得将QObject携带的属性、槽函数注册进去（信号比较麻烦，先不实现了）
-    // 枚举对象的所有属性
-    auto metaObj = object->metaObject();
-    // reserve to avoid QList reallocation while taking element addresses
-    w->propList.reserve(metaObj->propertyCount());
-    w->methodList.reserve(metaObj->methodCount());
-    for (int i = 0; i < metaObj->propertyCount(); ++i) {
-        auto prop = metaObj->property(i);
-        w->propList << ObjectProp{object, prop};
-        // 使用setter/getter实现
-        // 只能使用[]，不能使用[=]、[&]，否则签名对不上
-        // qDebug() << prop.name();
-        qVal.setProperty(prop.name(), this->newFunction([](QScriptContext *context, QScriptEngine *engine, void *data)->QScriptValue {
-            ObjectProp *objProp = static_cast<ObjectProp*>(data);
-            if(objProp == nullptr)
-            {
-                return QScriptValue();
-            }
+    // 成员在第一次访问时解析，这里只需要创建包装对象本身
+    QScriptMetaObjectBinding *binding = metaObjectBinding(object->metaObject(), options);
 
-            if(context->argumentCount() == 0)
-            {
-                // getter
-                return QScriptValue(objProp->read());
-            }
-            else
+    // 同一个对象以相同的配置包装过，直接返回原来的包装对象
+    // 缓存不持有引用：目标已删除（地址可能被新对象复用）或者包装对象正在被回收的项都跳过
+    const bool preferExisting = options & PreferExistingWrapperObject;
+    if (preferExisting)
+    {
+        for (auto it = m_wrapperCache.constFind(object); it != m_wrapperCache.constEnd() && it.key() == object; ++it)
+        {
+            QObjectWrapper *cached = it.value();
+            if (cached->obj == object && cached->binding == binding && cached->ownership == ownership
+                && JS_IsLiveObject(m_rt, cached->self))
             {
-                // setter
-                bool ret = objProp->write(context->argument(0).toVariant());
-                return QScriptValue(ret);
+                return QScriptValue(m_ctx, cached->self, this);
             }
-
-            return QScriptValue();
-
-        }, &w->propList.last()), QScriptValue::PropertyGetter | QScriptValue::PropertySetter);
-    }
-
-    // 枚举对象所有槽函数
-    // Q_INVOKABLE
-    for (int i = 0; i < metaObj->methodCount(); ++i) {
-        auto method = metaObj->method(i);
-
-        // qDebug() << "method"
-        //          << method.name()
-        //          << method.typeName()
-        //          << method.methodSignature()
-        //          << method.methodType();
-
-        // 只注册部分
-        switch (method.methodType()) {
-        case QMetaMethod::Method:
-        case QMetaMethod::Slot:
-            break;
-        default:
-            continue;
-            break;
         }
-        w->methodList << ObjectMethod{object, method};
-
-        // qDebug() << "method"
-        //          << method.name();
-        //          << method.typeName()
-        //          << method.methodSignature()
-        //          << method.parameterNames()
-        //          << method.parameterTypes();
-
-        qVal.setProperty(method.name().data(), this->newFunction([](QScriptContext *context, QScriptEngine *engine, void *data)->QScriptValue {
-            ObjectMethod *objMethod = static_cast<ObjectMethod*>(data);
-            if(objMethod == nullptr)
-            {
-                return QScriptValue();
-            }
-
-            QList<QGenericArgument> argList;
-            QString arg0 = context->argument(0).toString();
-            for (int argIdx = 0; argIdx < context->argumentCount(); ++argIdx) {
-                argList << QGenericArgument(objMethod->method.parameterTypes().at(argIdx).data(),
-                                            &arg0);
-            }
-
-            qDebug() << "invoke method:" << argList.length() << context->argument(0).toVariant();
-
-            // 调用函数
-            auto ret = objMethod->invoke(argList);
+    }
 
-            return QScriptValue(ret);
+    JSValue jsObj = JS_NewObjectProtoClass(m_ctx, binding->prototype, m_qobjectClassId);
+    if (JS_IsException(jsObj))
+        return QScriptValue();
 
-        }, &w->methodList.last()));
+    QObjectWrapper *w = new QObjectWrapper;
+    w->obj       = object;
+    w->ownership = ownership;
+    w->binding   = binding;
+    JS_SetOpaque(jsObj, w);
 
+    // 每种配置（绑定和所有权）各登记一个包装对象
+    // AutoConnection：在其它线程删除QObject时排队到引擎所在线程处理
+    if (preferExisting)
+    {
+        w->cacheOwner = this;
+        w->cacheKey   = object;
+        w->self       = jsObj;
+        m_wrapperCache.insert(object, w);
+        connect(object, &QObject::destroyed, this, &QScriptEngine::wrappedObjectDestroyed,
+                Qt::ConnectionType(Qt::AutoConnection | Qt::UniqueConnection));
     }
 
+    QScriptValue qVal = QScriptValue(m_ctx, jsObj, this);
+
     JS_FreeValue(m_ctx, jsObj);
 
     return qVal;
@@ -888,15 +4243,20 @@ QScriptValue QScriptEngine::newQObject(const QScriptValue &scriptObject,
                                        QScriptEngine::ValueOwnership ownership,
                                        const QScriptEngine::QObjectWrapOptions &options)
 {
-    Q_UNUSED(options);
     if (!m_ctx || !qtObject)
         return QScriptValue();
 
-    JSValue wrapper = JS_NewObjectClass(m_ctx, m_qobjectClassId);
+    RuntimeLocker locker(m_runtime);
+
+    QScriptMetaObjectBinding *binding = metaObjectBinding(qtObject->metaObject(), options);
+    JSValue wrapper = JS_NewObjectProtoClass(m_ctx, binding->prototype, m_qobjectClassId);
     if (JS_IsException(wrapper))
         return QScriptValue();
 
-    QObjectWrapper *w = new QObjectWrapper{qtObject, ownership};
+    QObjectWrapper *w = new QObjectWrapper;
+    w->obj       = qtObject;
+    w->ownership = ownership;
+    w->binding   = binding;
     JS_SetOpaque(wrapper, w);
 
     if (scriptObject.isValid() && scriptObject.isObject())
@@ -969,47 +4329,208 @@ void QScriptEngine::clearDefaultPrototypes()
     m_defaultPrototypes.clear();
 }
 
+// 创建挂有原生函数表项的函数对象，失败时返回 JS_EXCEPTION
+static JSValue newNativeFunctionObject(JSContext *ctx,
+                                       QScriptNativeFunctionTable *table,
+                                       JSCFunctionData *trampoline,
+                                       QScriptEngine::FunctionWithArgSignature func,
+                                       void *arg,
+                                       int length,
+                                       const QString &name)
+{
+    const QString functionName = name.isEmpty() ? QStringLiteral("native") : name;
+
+    QScriptNativeFunctionTable::Entry *entry = table->acquire();
+    entry->func    = func;
+    entry->arg     = arg;
+    entry->profile = table->profileFor(functionName);
+
+    // 表项挂在数据对象上，函数对象被回收时数据对象随之回收
+    JSValue data = JS_NewObjectClass(ctx, s_nativeFunctionClassId);
+    if (JS_IsException(data))
+    {
+        table->release(entry);
+        return JS_EXCEPTION;
+    }
+    JS_SetOpaque(data, entry);
+
+    JSValue fn = JS_NewCFunctionData(ctx, trampoline, length, 0, 1, &data);
+    // 函数持有了数据对象的引用；创建失败时数据对象在这里被回收，表项由finalizer归还
+    JS_FreeValue(ctx, data);
+    if (JS_IsException(fn))
+        return JS_EXCEPTION;
+
+    const QByteArray nameUtf8 = functionName.toUtf8();
+    JS_DefinePropertyValueStr(ctx, fn, "name", JS_NewStringLen(ctx, nameUtf8.constData(), nameUtf8.size()), JS_PROP_CONFIGURABLE);
+
+    entry->callee = fn;
+    return fn;
+}
+
 QScriptValue QScriptEngine::registerNativeFunction(FunctionWithArgSignature signature,
                                                    void *arg,
                                                    int length,
-                                                   int cproto)
+                                                   int cproto,
+                                                   const QString &name)
 {
-    std::lock_guard<std::mutex> lk(m_nativeFunctionsMutex);
-
-    // 将要新增的项目的index，恰好是目前的长度
-    int magicCode = m_nativeFunctions.size();
+    JSValue fn = newNativeFunctionObject(m_ctx, m_nativeFunctions, nativeFunctionShim, signature, arg, length, name);
+    if (JS_IsException(fn))
+        return QScriptValue();
 
-    // 使用 JS_NewCFunctionMagic 搭配 JS_CFUNC_generic_magic
-    // 可以实现使用同一个名字，注册多个函数？
-    JSValue fn = JS_NewCFunctionMagic(m_ctx,
-                                      nativeFunctionShim,
-                                      "native",
-                                      length,
-                                      (JSCFunctionEnum)cproto,
-                                      magicCode);
+    // 与之前 JS_NewCFunctionMagic 的行为保持一致
+    if (cproto == JS_CFUNC_constructor_or_func_magic)
+    {
+        JS_SetConstructorBit(m_ctx, fn, true);
+    }
 
     QScriptValue qVal = QScriptValue(m_ctx, fn, this);
 
     JS_FreeValue(m_ctx, fn);
 
-    NativeFunctionEntry e{signature, arg, fn};
-    m_nativeFunctions.push_back(e);
+    return qVal;
+}
+
+QScriptValue QScriptEngine::registerTypedFunction(JSCFunctionData *trampoline, void *function, int length, const QString &name)
+{
+    if (!m_ctx)
+        return QScriptValue();
+
+    // 类型化函数不经过 nativeFunctionShim，表项中只需要保存函数指针
+    JSValue fn = newNativeFunctionObject(m_ctx, m_nativeFunctions, trampoline, nullptr, function, length, name);
+    if (JS_IsException(fn))
+        return QScriptValue();
+
+    QScriptValue qVal = QScriptValue(m_ctx, fn, this);
+
+    JS_FreeValue(m_ctx, fn);
 
     return qVal;
 }
 
-bool QScriptEngine::getNativeEntry(int idx,
-                                   FunctionWithArgSignature &outFunc,
-                                   void **outArg,
-                                   JSValue &callee) const
+void *QScriptEngine::nativeFunctionArg(JSValueConst data)
 {
-    std::lock_guard<std::mutex> lk(m_nativeFunctionsMutex);
-    if (idx < 0 || idx >= (int)m_nativeFunctions.size())
-        return false;
-    outFunc = m_nativeFunctions[idx].func;
-    *outArg = m_nativeFunctions[idx].arg;
-    callee  = m_nativeFunctions[idx].callee;
-    return true;
+    auto *entry = static_cast<QScriptNativeFunctionTable::Entry*>(JS_GetOpaque(data, s_nativeFunctionClassId));
+    return entry ? entry->arg : nullptr;
+}
+
+void QScriptEngine::notifyNativeFunctionEntry()
+{
+    if (m_agent != nullptr)
+    {
+        m_agent->functionEntry(-1);
+    }
+}
+
+void QScriptEngine::notifyNativeFunctionExit(JSValueConst ret)
+{
+    if (m_agent != nullptr)
+    {
+        m_agent->functionExit(-1, JS_IsException(ret) ? QScriptValue() : QScriptValue(m_ctx, ret, this));
+    }
+}
+
+QScriptNativeCallTimer::QScriptNativeCallTimer(QScriptEngine *engine, QScriptNativeFunctionProfile *profile)
+{
+    if (profile && engine->isNativeProfilingEnabled())
+    {
+        m_profile = profile;
+        m_start = profilerNowNs();
+    }
+}
+
+QScriptNativeCallTimer::QScriptNativeCallTimer(QScriptEngine *engine, JSValueConst data)
+{
+    if (engine->isNativeProfilingEnabled())
+    {
+        auto *entry = static_cast<QScriptNativeFunctionTable::Entry*>(JS_GetOpaque(data, s_nativeFunctionClassId));
+        if (entry && entry->profile)
+        {
+            m_profile = entry->profile;
+            m_start = profilerNowNs();
+        }
+    }
+}
+
+QScriptNativeCallTimer::~QScriptNativeCallTimer()
+{
+    if (m_profile)
+    {
+        m_profile->record(profilerNowNs() - m_start);
+    }
+}
+
+void QScriptEngine::setNativeProfilingEnabled(bool enabled)
+{
+    m_nativeProfiling.store(enabled, std::memory_order_relaxed);
+}
+
+QList<QScriptEngine::NativeFunctionStatistics> QScriptEngine::nativeFunctionStatistics() const
+{
+    QList<NativeFunctionStatistics> result;
+    if (!m_nativeFunctions)
+        return result;
+
+    std::lock_guard<std::mutex> lk(m_nativeFunctions->mutex);
+    for (QScriptNativeFunctionProfile *profile : std::as_const(m_nativeFunctions->profiles))
+    {
+        NativeFunctionStatistics stats;
+        stats.name      = profile->name;
+        stats.callCount = profile->calls.load(std::memory_order_relaxed);
+        if (stats.callCount == 0)
+            continue;
+
+        stats.totalNs = profile->totalNs.load(std::memory_order_relaxed);
+        stats.minNs   = profile->minNs.load(std::memory_order_relaxed);
+        stats.maxNs   = profile->maxNs.load(std::memory_order_relaxed);
+        stats.histogram.resize(NativeFunctionStatistics::HistogramSize);
+        for (int i = 0; i < NativeFunctionStatistics::HistogramSize; ++i)
+        {
+            stats.histogram[i] = profile->histogram[i].load(std::memory_order_relaxed);
+        }
+        result.append(stats);
+    }
+
+    std::sort(result.begin(), result.end(), [](const NativeFunctionStatistics &a, const NativeFunctionStatistics &b) {
+        return a.totalNs > b.totalNs;
+    });
+    return result;
+}
+
+void QScriptEngine::resetNativeFunctionStatistics()
+{
+    if (!m_nativeFunctions)
+        return;
+
+    std::lock_guard<std::mutex> lk(m_nativeFunctions->mutex);
+    for (QScriptNativeFunctionProfile *profile : std::as_const(m_nativeFunctions->profiles))
+    {
+        profile->reset();
+    }
+}
+
+QByteArray QScriptEngine::nativeFunctionStatisticsJson() const
+{
+    QJsonArray functions;
+    const QList<NativeFunctionStatistics> statistics = nativeFunctionStatistics();
+    for (const NativeFunctionStatistics &stats : statistics)
+    {
+        QJsonArray histogram;
+        for (qint64 count : stats.histogram)
+        {
+            histogram.append(count);
+        }
+
+        QJsonObject obj;
+        obj.insert(QStringLiteral("name"), stats.name);
+        obj.insert(QStringLiteral("calls"), stats.callCount);
+        obj.insert(QStringLiteral("totalNs"), stats.totalNs);
+        obj.insert(QStringLiteral("minNs"), stats.minNs);
+        obj.insert(QStringLiteral("maxNs"), stats.maxNs);
+        obj.insert(QStringLiteral("meanNs"), stats.totalNs / stats.callCount);
+        obj.insert(QStringLiteral("histogramUs"), histogram);
+        functions.append(obj);
+    }
+    return QJsonDocument(functions).toJson(QJsonDocument::Indented);
 }
 
 QObject *QScriptEngine::qobjectFromJSValue(JSContext *ctx, JSValueConst val) const
@@ -1137,6 +4658,16 @@ void QScriptEngine::registerModule(const QString &moduleName, const QList<Module
     m_moduleRegistry[moduleName] = exports;
 }
 
+void QScriptEngine::setModuleCacheDirectory(const QString &path)
+{
+    m_moduleCacheDirectory = path;
+}
+
+QString QScriptEngine::moduleCacheDirectory() const
+{
+    return m_moduleCacheDirectory;
+}
+
 QScriptSyntaxCheckResult QScriptEngine::checkSyntax(const QString &program)
 {
     auto rt = JS_NewRuntime();
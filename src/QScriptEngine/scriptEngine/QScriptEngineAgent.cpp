@@ -25,26 +25,35 @@ int scriptOPChanged(uint8_t op,
     //          << line
     //          << col;
 
-    int scriptId = agent->scriptId(fileName);
+    // 这里每条指令都会执行，不要构造QString，也不要每次都去查找scriptId
+    // 文件名没变并且引擎没有加载新脚本时，直接使用上一次的结果
+    qint64 scriptId = agent->mLastScriptId;
+    int fileCount = agent->engine() ? agent->engine()->fileNameBuffer().size() : -1;
+    if(agent->mLastFileCount != fileCount || agent->mLastFileName != fileName)
+    {
+        agent->mLastFileName  = fileName;
+        agent->mLastFileCount = fileCount;
+        agent->mLastScriptId  = agent->scriptId(QString::fromUtf8(fileName));
+        scriptId = agent->mLastScriptId;
+    }
 
 
     // 使用函数名变化来检测函数进入/退出
     // 但是在执行自定义c++函数，不会有函数名的变更。因此对于自定义的函数，需要在QScriptEngine中处理
 
     // 进入函数
-    QString currentFuncName = funcName ? QString(funcName) : QString();
-    if(currentFuncName.isEmpty() == false && currentFuncName != "<eval>")
+    if(funcName != nullptr && funcName[0] != '\0' && qstrcmp(funcName, "<eval>") != 0)
     {
-        QList<QString> &funcStack = agent->mFuncStack;
+        QList<QByteArray> &funcStack = agent->mFuncStack;
         if(funcStack.length() == 0)
         {
-            funcStack << currentFuncName;
+            funcStack << QByteArray(funcName);
             agent->functionEntry(scriptId);
             agent->mFuncStackCounter++;
         }
-        else if(funcStack.last() != currentFuncName)
+        else if(funcStack.last() != funcName)
         {
-            funcStack << currentFuncName;
+            funcStack << QByteArray(funcName);
             agent->functionEntry(scriptId);
             agent->mFuncStackCounter++;
         }
@@ -55,7 +64,7 @@ int scriptOPChanged(uint8_t op,
     case QJDefines::OP_return_undef:
     case QJDefines::OP_return_async:
     case QJDefines::OP_return:{
-        QList<QString> &funcStack = agent->mFuncStack;
+        QList<QByteArray> &funcStack = agent->mFuncStack;
         if(funcStack.length() > 0)
         {
             agent->functionExit(scriptId, QScriptValue());
@@ -86,13 +95,20 @@ QScriptEngineAgent::QScriptEngineAgent(QScriptEngine *engine)
     mLastLine = -1;
     mLastCol = -1;
 
-    JS_SetOPChangedHandler(engine->ctx(), scriptOPChanged, this);
-    engine->setAgent(this);
+    // 逐指令回调由 setAgent 负责安装
+    if(engine != nullptr)
+    {
+        engine->setAgent(this);
+    }
 }
 
 QScriptEngineAgent::~QScriptEngineAgent()
 {
-
+    // 卸载逐指令回调
+    if(m_engine != nullptr && m_engine->agent() == this)
+    {
+        m_engine->setAgent(nullptr);
+    }
 }
 
 void QScriptEngineAgent::contextPop()
@@ -175,7 +191,7 @@ qint64 QScriptEngineAgent::scriptId(QString fileName)
         return -1;
     }
 
-    return engine()->fileNameBuffer().indexOf(fileName);
+    return engine()->scriptIdForFileName(fileName);
 }
 
 void QScriptEngineAgent::checkFunctionPair(qint64 scriptId, QScriptValue value)
@@ -0,0 +1,335 @@
+﻿#include <QScriptEnginePool>
+#include <QScriptEngine>
+
+#include <QSet>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+QScriptEnginePool::QScriptEnginePool(int size, const SetupFunction &setup, ResetMode mode)
+    : m_setup(setup), m_mode(mode)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        PooledEngine *entry = new PooledEngine;
+        entry->engine = createEngine();
+        if (m_mode == RestoreGlobalObject)
+        {
+            takeSnapshot(entry);
+        }
+        // 空闲的引擎不属于任何线程，acquire() 时再移到使用者的线程
+        entry->engine->moveToThread(nullptr);
+
+        m_entries << entry;
+        m_idle << entry;
+    }
+}
+
+QScriptEngine *QScriptEnginePool::createEngine()
+{
+    QScriptEngine *engine = new QScriptEngine();
+    if (m_setup)
+    {
+        m_setup(engine);
+    }
+    return engine;
+}
+
+QScriptEnginePool::~QScriptEnginePool()
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (PooledEngine *entry : qAsConst(m_entries))
+    {
+        if (entry->inUse)
+        {
+            qWarning() << "QScriptEnginePool: destroying an engine that is still in use";
+        }
+        else
+        {
+            // 空闲的引擎不属于任何线程，先拉到当前线程再析构
+            entry->engine->moveToThread(QThread::currentThread());
+        }
+        freeSnapshot(entry);
+        delete entry->engine;
+        delete entry;
+    }
+    m_entries.clear();
+    m_idle.clear();
+}
+
+int QScriptEnginePool::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+int QScriptEnginePool::availableCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_idle.size();
+}
+
+QScriptEnginePool::ResetMode QScriptEnginePool::resetMode() const
+{
+    return m_mode;
+}
+
+QScriptEngine *QScriptEnginePool::acquire(int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QDeadlineTimer deadline = (timeoutMs < 0) ? QDeadlineTimer(QDeadlineTimer::Forever)
+                                               : QDeadlineTimer(timeoutMs);
+
+    PooledEngine *entry = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_idle.isEmpty())
+        {
+            if (!m_idleCondition.wait(&m_mutex, deadline) && m_idle.isEmpty())
+            {
+                return nullptr;
+            }
+        }
+
+        entry = m_idle.takeLast();
+        entry->inUse = true;
+
+        qint64 ns = timer.nsecsElapsed();
+        m_stats.acquireCount++;
+        if (entry->useCount > 0)
+        {
+            m_stats.reuseCount++;
+        }
+        m_stats.totalAcquireNs += ns;
+        m_stats.maxAcquireNs = qMax(m_stats.maxAcquireNs, ns);
+
+        entry->useCount++;
+    }
+
+    // 没有线程归属的对象可以被拉到当前线程，之后定时器、排队的信号都在这个线程中处理
+    entry->engine->moveToThread(QThread::currentThread());
+
+    // 引擎可能在另一个线程中被使用过，需要更新栈顶，否则栈溢出检查会出错
+    JS_UpdateStackTop(entry->engine->runtime());
+
+    return entry->engine;
+}
+
+void QScriptEnginePool::release(QScriptEngine *engine)
+{
+    if (engine == nullptr)
+        return;
+
+    PooledEngine *entry = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        entry = findEntry(engine);
+        if (entry == nullptr || !entry->inUse)
+        {
+            qWarning() << "QScriptEnginePool: releasing an engine that does not belong to this pool";
+            return;
+        }
+    }
+
+    // moveToThread 只能把对象从它所在的线程推出去
+    if (engine->thread() != QThread::currentThread())
+    {
+        qWarning() << "QScriptEnginePool: release() must be called from the thread that acquired the engine";
+    }
+
+    // 引擎此时仍然只属于调用者，不需要持锁
+    QElapsedTimer timer;
+    timer.start();
+    QScriptEngine *fresh = nullptr;
+    if (m_mode == RecreateEngine)
+    {
+        delete engine;
+        fresh = createEngine();
+        fresh->moveToThread(nullptr);
+    }
+    else
+    {
+        resetEngine(entry);
+        engine->moveToThread(nullptr);
+    }
+    qint64 ns = timer.nsecsElapsed();
+
+    QMutexLocker locker(&m_mutex);
+    if (fresh)
+    {
+        entry->engine = fresh;
+    }
+    entry->inUse = false;
+    m_idle << entry;
+
+    m_stats.resetCount++;
+    m_stats.totalResetNs += ns;
+    m_stats.maxResetNs = qMax(m_stats.maxResetNs, ns);
+
+    m_idleCondition.wakeOne();
+}
+
+QScriptEnginePool::Statistics QScriptEnginePool::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void QScriptEnginePool::resetStatistics()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats = Statistics();
+}
+
+QScriptEnginePool::PooledEngine *QScriptEnginePool::findEntry(QScriptEngine *engine)
+{
+    for (PooledEngine *entry : qAsConst(m_entries))
+    {
+        if (entry->engine == engine)
+            return entry;
+    }
+    return nullptr;
+}
+
+void QScriptEnginePool::takeSnapshot(PooledEngine *entry)
+{
+    JSContext *ctx = entry->engine->ctx();
+    if (!ctx)
+        return;
+
+    JSValue global = JS_GetGlobalObject(ctx);
+
+    JSPropertyEnum *props = nullptr;
+    uint32_t len = 0;
+    if (JS_GetOwnPropertyNames(ctx, &props, &len, global, JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK) >= 0)
+    {
+        for (uint32_t i = 0; i < len; ++i)
+        {
+            GlobalProperty prop;
+
+            JSPropertyDescriptor desc;
+            int ret = JS_GetOwnProperty(ctx, &desc, global, props[i].atom);
+            if (ret > 0)
+            {
+                prop.flags    = desc.flags & JS_PROP_C_W_E;
+                prop.accessor = (desc.flags & JS_PROP_GETSET) != 0;
+                if (prop.accessor)
+                    JS_FreeValue(ctx, desc.value);
+                else
+                    prop.value = desc.value;
+                JS_FreeValue(ctx, desc.getter);
+                JS_FreeValue(ctx, desc.setter);
+            }
+
+            entry->globals.insert(JS_DupAtom(ctx, props[i].atom), prop);
+        }
+        JS_FreePropertyEnum(ctx, props, len);
+    }
+
+    JS_FreeValue(ctx, global);
+}
+
+void QScriptEnginePool::freeSnapshot(PooledEngine *entry)
+{
+    JSContext *ctx = entry->engine->ctx();
+    if (!ctx)
+        return;
+
+    for (auto it = entry->globals.begin(); it != entry->globals.end(); ++it)
+    {
+        JS_FreeValue(ctx, it.value().value);
+        JS_FreeAtom(ctx, it.key());
+    }
+    entry->globals.clear();
+}
+
+void QScriptEnginePool::resetEngine(PooledEngine *entry)
+{
+    QScriptEngine *engine = entry->engine;
+    JSContext *ctx = engine->ctx();
+    if (!ctx)
+        return;
+
+    engine->setAgent(nullptr);
+    std::atomic_store(&engine->interrupt_flag, 0);
+
+    // 上一个使用者留下的定时器不能在下一个使用者的脚本里触发
+    engine->clearTimers();
+
+    // 丢弃未处理的异常
+    if (JS_HasException(ctx))
+    {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+
+    JSValue global = JS_GetGlobalObject(ctx);
+
+    // 删除脚本新增的全局属性，恢复被改写的全局属性
+    QSet<JSAtom> present;
+    JSPropertyEnum *props = nullptr;
+    uint32_t len = 0;
+    if (JS_GetOwnPropertyNames(ctx, &props, &len, global, JS_GPN_STRING_MASK | JS_GPN_SYMBOL_MASK) >= 0)
+    {
+        for (uint32_t i = 0; i < len; ++i)
+        {
+            JSAtom atom = props[i].atom;
+            auto it = entry->globals.constFind(atom);
+            if (it == entry->globals.constEnd())
+            {
+                JS_DeleteProperty(ctx, global, atom, 0);
+                continue;
+            }
+
+            present.insert(atom);
+
+            const GlobalProperty &prop = it.value();
+            if (prop.accessor)
+                continue;
+
+            bool same = false;
+            JSPropertyDescriptor desc;
+            int ret = JS_GetOwnProperty(ctx, &desc, global, atom);
+            if (ret > 0)
+            {
+                same = !(desc.flags & JS_PROP_GETSET)
+                       && (desc.flags & JS_PROP_C_W_E) == prop.flags
+                       && JS_IsStrictEqual(ctx, desc.value, prop.value);
+                JS_FreeValue(ctx, desc.value);
+                JS_FreeValue(ctx, desc.getter);
+                JS_FreeValue(ctx, desc.setter);
+            }
+
+            if (!same)
+            {
+                JS_DefinePropertyValue(ctx, global, atom, JS_DupValue(ctx, prop.value), prop.flags);
+            }
+        }
+        JS_FreePropertyEnum(ctx, props, len);
+    }
+
+    // 被脚本删除的全局属性
+    for (auto it = entry->globals.constBegin(); it != entry->globals.constEnd(); ++it)
+    {
+        if (!present.contains(it.key()) && !it.value().accessor)
+        {
+            JS_DefinePropertyValue(ctx, global, it.key(), JS_DupValue(ctx, it.value().value), it.value().flags);
+        }
+    }
+
+    JS_FreeValue(ctx, global);
+
+    // 清理过程中可能产生异常（比如不可配置的属性），一并丢弃
+    if (JS_HasException(ctx))
+    {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+}
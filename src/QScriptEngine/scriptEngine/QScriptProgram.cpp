@@ -0,0 +1,87 @@
+﻿#include <QScriptProgram>
+#include <QScriptEngine>
+
+QScriptProgramPrivate::QScriptProgramPrivate(const QString &src, const QString &fn, int ln)
+    : sourceCode(src),
+    fileName(fn),
+    firstLineNumber(ln),
+    sourceUtf8(src.toUtf8()),
+    fileNameUtf8(fn.toUtf8())
+{
+}
+
+QScriptProgramPrivate::~QScriptProgramPrivate()
+{
+    // 字节码属于各自的引擎，需要交还给引擎释放
+    const QList<QScriptEngine*> engines = compiled.keys();
+    for (QScriptEngine *engine : engines)
+    {
+        engine->releaseProgram(this);
+    }
+}
+
+QScriptProgram::QScriptProgram()
+{
+}
+
+QScriptProgram::QScriptProgram(const QString &sourceCode, const QString fileName, int firstLineNumber)
+    : d_ptr(new QScriptProgramPrivate(sourceCode, fileName, firstLineNumber))
+{
+}
+
+QScriptProgram::QScriptProgram(const QScriptProgram &other)
+    : d_ptr(other.d_ptr)
+{
+}
+
+QScriptProgram::~QScriptProgram()
+{
+}
+
+QScriptProgram &QScriptProgram::operator=(const QScriptProgram &other)
+{
+    d_ptr = other.d_ptr;
+    return *this;
+}
+
+bool QScriptProgram::isNull() const
+{
+    return !d_ptr;
+}
+
+QString QScriptProgram::sourceCode() const
+{
+    if (!d_ptr)
+        return QString();
+    return d_ptr->sourceCode;
+}
+
+QString QScriptProgram::fileName() const
+{
+    if (!d_ptr)
+        return QString();
+    return d_ptr->fileName;
+}
+
+int QScriptProgram::firstLineNumber() const
+{
+    if (!d_ptr)
+        return -1;
+    return d_ptr->firstLineNumber;
+}
+
+bool QScriptProgram::operator==(const QScriptProgram &other) const
+{
+    if (d_ptr == other.d_ptr)
+        return true;
+    if (!d_ptr || !other.d_ptr)
+        return false;
+    return d_ptr->sourceCode == other.d_ptr->sourceCode
+           && d_ptr->fileName == other.d_ptr->fileName
+           && d_ptr->firstLineNumber == other.d_ptr->firstLineNumber;
+}
+
+bool QScriptProgram::operator!=(const QScriptProgram &other) const
+{
+    return !operator==(other);
+}
@@ -0,0 +1,97 @@
+﻿#include <QScriptString>
+#include <QScriptEngine>
+
+QScriptString::QScriptString()
+{
+}
+
+QScriptString::QScriptString(JSContext *ctx, JSAtom atom)
+    : m_ctx(ctx), m_atom(ctx ? JS_DupAtom(ctx, atom) : JS_ATOM_NULL)
+{
+}
+
+QScriptString::QScriptString(const QScriptString &other)
+    : m_ctx(other.m_ctx), m_atom(other.m_ctx ? JS_DupAtom(other.m_ctx, other.m_atom) : JS_ATOM_NULL)
+{
+}
+
+QScriptString::~QScriptString()
+{
+    if (m_ctx)
+        JS_FreeAtom(m_ctx, m_atom);
+}
+
+QScriptString &QScriptString::operator=(const QScriptString &other)
+{
+    if (this == &other)
+        return *this;
+
+    if (other.m_ctx)
+        JS_DupAtom(other.m_ctx, other.m_atom);
+    if (m_ctx)
+        JS_FreeAtom(m_ctx, m_atom);
+
+    m_ctx  = other.m_ctx;
+    m_atom = other.m_atom;
+    return *this;
+}
+
+bool QScriptString::isValid() const
+{
+    return m_ctx && m_atom != JS_ATOM_NULL;
+}
+
+bool QScriptString::operator==(const QScriptString &other) const
+{
+    return m_atom == other.m_atom;
+}
+
+bool QScriptString::operator!=(const QScriptString &other) const
+{
+    return m_atom != other.m_atom;
+}
+
+quint32 QScriptString::toArrayIndex(bool *ok) const
+{
+    const QString name = toString();
+
+    bool isIndex = false;
+    quint32 index = name.toUInt(&isIndex);
+
+    // 只接受规范的写法，"01"、"+1" 都不是下标
+    if (isIndex && (index == 0xffffffffu || QString::number(index) != name))
+        isIndex = false;
+
+    if (ok)
+        *ok = isIndex;
+    return isIndex ? index : 0xffffffffu;
+}
+
+QString QScriptString::toString() const
+{
+    if (!isValid())
+        return QString();
+
+    QScriptEngine *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(m_ctx));
+    if (engine)
+        return engine->atomName(m_atom);
+
+    const char *str = JS_AtomToCString(m_ctx, m_atom);
+    QString name = QString::fromUtf8(str);
+    JS_FreeCString(m_ctx, str);
+    return name;
+}
+
+QScriptString::operator QString() const
+{
+    return toString();
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+size_t qHash(const QScriptString &key, size_t seed)
+#else
+uint qHash(const QScriptString &key, uint seed)
+#endif
+{
+    return qHash(quint32(key.atom()), seed);
+}
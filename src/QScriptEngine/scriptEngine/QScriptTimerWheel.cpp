@@ -0,0 +1,162 @@
+﻿#include <QScriptTimerWheel>
+
+QScriptTimerWheel::QScriptTimerWheel(int slotCount, int tickMs)
+    : m_tickMs(qMax(1, tickMs))
+{
+    // 槽数取2的幂，用位运算代替取模
+    int size = 1;
+    while (size < slotCount)
+        size <<= 1;
+
+    m_slots.resize(size);
+    m_mask = size - 1;
+}
+
+QScriptTimerWheel::~QScriptTimerWheel()
+{
+    clear();
+}
+
+void QScriptTimerWheel::start(int id, qint64 delayMs, qint64 nowMs)
+{
+    const qint64 nowTick = nowMs / m_tickMs;
+
+    // 时间轮为空时直接对齐到当前时间，避免下次推进时空转经过的tick
+    if (m_nodes.isEmpty())
+    {
+        m_currentTick = nowTick;
+    }
+
+    Node *node = m_nodes.value(id, nullptr);
+    if (node)
+    {
+        unlink(node);
+    }
+    else
+    {
+        node = new Node{id, 0, 0, nullptr, nullptr};
+        m_nodes.insert(id, node);
+    }
+
+    // 向上取整，至少在下一个tick到期
+    qint64 expireTick = (nowMs + qMax<qint64>(0, delayMs) + m_tickMs - 1) / m_tickMs;
+    expireTick = qMax(expireTick, m_currentTick + 1);
+
+    const qint64 ticks = expireTick - m_currentTick;
+    node->rounds = (ticks - 1) / (qint64)m_slots.size();
+    link(node, int(expireTick & m_mask));
+}
+
+bool QScriptTimerWheel::stop(int id)
+{
+    Node *node = m_nodes.take(id);
+    if (!node)
+        return false;
+
+    unlink(node);
+    delete node;
+    return true;
+}
+
+bool QScriptTimerWheel::contains(int id) const
+{
+    return m_nodes.contains(id);
+}
+
+int QScriptTimerWheel::count() const
+{
+    return m_nodes.size();
+}
+
+void QScriptTimerWheel::clear()
+{
+    qDeleteAll(m_nodes);
+    m_nodes.clear();
+    for (Slot &slot : m_slots)
+    {
+        slot.head = nullptr;
+        slot.tail = nullptr;
+    }
+}
+
+void QScriptTimerWheel::advance(qint64 nowMs, QList<int> &expired)
+{
+    const qint64 nowTick = nowMs / m_tickMs;
+
+    while (m_currentTick < nowTick)
+    {
+        if (m_nodes.isEmpty())
+        {
+            m_currentTick = nowTick;
+            break;
+        }
+
+        ++m_currentTick;
+
+        Slot &slot = m_slots[m_currentTick & m_mask];
+        Node *node = slot.head;
+        while (node)
+        {
+            Node *next = node->next;
+            if (node->rounds > 0)
+            {
+                node->rounds--;
+            }
+            else
+            {
+                expired.append(node->id);
+                unlink(node);
+                m_nodes.remove(node->id);
+                delete node;
+            }
+            node = next;
+        }
+    }
+}
+
+qint64 QScriptTimerWheel::nextTimeout(qint64 nowMs) const
+{
+    if (m_nodes.isEmpty())
+        return -1;
+
+    // 找到下一个非空的槽；槽里的定时器即使还要再转几圈，也在那时醒来一次递减圈数
+    const qint64 size = (qint64)m_slots.size();
+    for (qint64 tick = m_currentTick + 1; tick <= m_currentTick + size; ++tick)
+    {
+        if (m_slots[tick & m_mask].head)
+        {
+            return qMax<qint64>(0, tick * m_tickMs - nowMs);
+        }
+    }
+
+    return -1;
+}
+
+void QScriptTimerWheel::link(Node *node, int slot)
+{
+    // 追加到槽尾，同一个tick到期的定时器按添加顺序触发
+    Slot &s = m_slots[slot];
+    node->slot = slot;
+    node->prev = s.tail;
+    node->next = nullptr;
+    if (s.tail)
+        s.tail->next = node;
+    else
+        s.head = node;
+    s.tail = node;
+}
+
+void QScriptTimerWheel::unlink(Node *node)
+{
+    Slot &s = m_slots[node->slot];
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        s.head = node->next;
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        s.tail = node->prev;
+    node->prev = nullptr;
+    node->next = nullptr;
+}
@@ -5,6 +5,7 @@
 #include <QDebug>
 #include <QVariantMap>
 #include <QVariantList>
+#include <QVarLengthArray>
 
 extern "C" {
 #include "quickjs.h"
@@ -173,6 +174,21 @@ bool QScriptValue::isVariant() const { return m_isVariant; }
 bool QScriptValue::isQMetaObject() const { return false; }
 bool QScriptValue::isQObject() const { return false; }
 
+QScriptClass *QScriptValue::scriptClass() const
+{
+    if (!m_ctx || !m_engine)
+        return nullptr;
+    return m_engine->scriptClassFromJSValue(m_value);
+}
+
+QScriptValue QScriptValue::scriptClassData() const
+{
+    QScriptValue data;
+    if (m_ctx && m_engine)
+        m_engine->scriptClassFromJSValue(m_value, &data);
+    return data;
+}
+
 QScriptValue QScriptValue::property(const QString &name) const
 {
     if (!m_ctx)
@@ -333,6 +349,187 @@ void QScriptValue::setPrototype(const QScriptValue &prototype)
         JS_FreeValue(m_ctx, protoVal);
 }
 
+// 调用参数：普通值直接借用，variant值临时转换成JSValue，调用结束后释放
+struct QScriptCallArguments
+{
+    JSContext *ctx;
+    QVarLengthArray<JSValue, 8> argv;
+    QVarLengthArray<JSValue, 8> owned;
+
+    QScriptCallArguments(JSContext *c, const QScriptValue *args, int argc)
+        : ctx(c), argv(argc)
+    {
+        for (int i = 0; i < argc; ++i)
+        {
+            argv[i] = borrow(args[i]);
+        }
+    }
+
+    // Qt5 的 QList 没有 constData()，逐个用 at() 取
+    QScriptCallArguments(JSContext *c, const QScriptValueList &args)
+        : ctx(c), argv(args.size())
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            argv[i] = borrow(args.at(i));
+        }
+    }
+
+    // 类数组对象，元素都是新的引用
+    QScriptCallArguments(JSContext *c, JSValueConst arrayLike)
+        : ctx(c)
+    {
+        int64_t len = 0;
+        if (!JS_IsObject(arrayLike) || JS_GetLength(ctx, arrayLike, &len) < 0)
+        {
+            if (JS_HasException(ctx))
+                JS_FreeValue(ctx, JS_GetException(ctx));
+            return;
+        }
+        argv.resize(int(len));
+        for (int64_t i = 0; i < len; ++i)
+        {
+            argv[int(i)] = JS_GetPropertyInt64(ctx, arrayLike, i);
+            owned.append(argv[int(i)]);
+        }
+    }
+
+    ~QScriptCallArguments()
+    {
+        for (JSValue v : owned)
+        {
+            JS_FreeValue(ctx, v);
+        }
+    }
+
+    JSValue borrow(const QScriptValue &value)
+    {
+        if (!value.isVariant())
+            return value.rawValue();
+
+        JSValue v = QScriptValue::toJSValue(ctx, value.data());
+        owned.append(v);
+        return v;
+    }
+};
+
+QScriptValue QScriptValue::call(const QScriptValue &thisObject, const QScriptValueList &args)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    QScriptCallArguments callArgs(m_ctx, args);
+    JSValue thisVal = callArgs.borrow(thisObject);
+    return m_engine->callFunction(m_value, thisVal, callArgs.argv.size(), callArgs.argv.data(), false);
+}
+
+QScriptValue QScriptValue::call(const QScriptValue &thisObject, const QScriptValue &arguments)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    QScriptCallArguments callArgs(m_ctx, arguments.rawValue());
+    JSValue thisVal = callArgs.borrow(thisObject);
+    return m_engine->callFunction(m_value, thisVal, callArgs.argv.size(), callArgs.argv.data(), false);
+}
+
+QScriptValue QScriptValue::call(const QScriptValue &thisObject, const QScriptValue *args, int argc)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    QScriptCallArguments callArgs(m_ctx, args, argc);
+    JSValue thisVal = callArgs.borrow(thisObject);
+    return m_engine->callFunction(m_value, thisVal, argc, callArgs.argv.data(), false);
+}
+
+QScriptValue QScriptValue::call(const QScriptValue &thisObject, const JSValueConst *argv, int argc)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    QScriptCallArguments callArgs(m_ctx, nullptr, 0);
+    JSValue thisVal = callArgs.borrow(thisObject);
+    return m_engine->callFunction(m_value, thisVal, argc, const_cast<JSValueConst *>(argv), false);
+}
+
+QScriptValue QScriptValue::callAsConstructor(const QScriptValueList &args)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    QScriptCallArguments callArgs(m_ctx, args);
+    return m_engine->callFunction(m_value, JS_UNDEFINED, callArgs.argv.size(), callArgs.argv.data(), true);
+}
+
+QScriptValue QScriptValue::callAsConstructor(const QScriptValue &arguments)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    QScriptCallArguments callArgs(m_ctx, arguments.rawValue());
+    return m_engine->callFunction(m_value, JS_UNDEFINED, callArgs.argv.size(), callArgs.argv.data(), true);
+}
+
+QScriptValue QScriptValue::callAsConstructor(const QScriptValue *args, int argc)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    QScriptCallArguments callArgs(m_ctx, args, argc);
+    return m_engine->callFunction(m_value, JS_UNDEFINED, argc, callArgs.argv.data(), true);
+}
+
+QScriptValue QScriptValue::callAsConstructor(const JSValueConst *argv, int argc)
+{
+    if (!m_ctx || !m_engine || !isFunction())
+        return QScriptValue();
+
+    return m_engine->callFunction(m_value, JS_UNDEFINED, argc, const_cast<JSValueConst *>(argv), true);
+}
+
+QScriptValueList QScriptValue::callBatch(const QScriptValue &thisObject, const QList<QVariantList> &argumentRows, QList<bool> *failed)
+{
+    // 参数个数取最长的一行，较短的行补 undefined
+    int argc = 0;
+    for (const QVariantList &row : argumentRows)
+    {
+        argc = qMax(argc, row.size());
+    }
+
+    return callBatchImpl(thisObject, argumentRows.size(), argc,
+                         [&argumentRows, argc](JSContext *ctx, int row, JSValue *argv) {
+                             const QVariantList &values = argumentRows.at(row);
+                             for (int i = 0; i < argc; ++i)
+                             {
+                                 argv[i] = (i < values.size()) ? toJSValue(ctx, values.at(i)) : JS_UNDEFINED;
+                             }
+                         },
+                         failed);
+}
+
+QScriptValueList QScriptValue::callBatch(const QScriptValue &thisObject, const QVariantList &column, QList<bool> *failed)
+{
+    return callBatchImpl(thisObject, column.size(), 1,
+                         [&column](JSContext *ctx, int row, JSValue *argv) {
+                             argv[0] = toJSValue(ctx, column.at(row));
+                         },
+                         failed);
+}
+
+QScriptValueList QScriptValue::callBatchImpl(const QScriptValue &thisObject, int rowCount, int argc,
+                                             const BatchArgumentFiller &fillArguments, QList<bool> *failed)
+{
+    QScriptValueList results;
+    if (!m_ctx || !m_engine || !isFunction())
+        return results;
+
+    QScriptCallArguments callArgs(m_ctx, nullptr, 0);
+    JSValue thisVal = callArgs.borrow(thisObject);
+    m_engine->callFunctionBatch(m_value, thisVal, rowCount, argc, fillArguments, results, failed);
+    return results;
+}
+
 bool QScriptValue::strictlyEquals(const QScriptValue &other) const
 {
     if (!m_ctx || !other.m_ctx)
@@ -0,0 +1,64 @@
+﻿#ifndef QSCRIPTENGINE_QSCRIPTCLASS_H
+#define QSCRIPTENGINE_QSCRIPTCLASS_H
+
+#include <QString>
+#include <QVariant>
+#include <QScriptValue>
+#include <QScriptString>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+class QScriptEngine;
+class QScriptClassPropertyIterator;
+
+// 与QtScript的QScriptClass接口一致
+// QScriptEngine::newObject(scriptClass, data) 创建的对象，属性在访问时才通过这些回调向C++查询，
+// 大的C++数据结构不需要先复制成JS对象
+// queryProperty() 没有接管的名字按普通对象处理：对象自己的属性，然后是 prototype()
+// 每个 QScriptClass 在引擎的runtime中对应一个JS类，第一次 newObject 时注册；
+// QScriptClass 必须比它创建的对象活得更久
+class QScriptClass
+{
+public:
+    enum QueryFlag {
+        HandlesReadAccess   = 0x01,
+        HandlesWriteAccess  = 0x02
+    };
+    Q_DECLARE_FLAGS(QueryFlags, QueryFlag)
+
+public:
+    explicit QScriptClass(QScriptEngine *engine);
+    virtual ~QScriptClass();
+
+    QScriptEngine *engine() const;
+
+    // 返回接管的访问方式，id 原样传给后面的 property/setProperty/propertyFlags，可以用来避免重复查找
+    virtual QueryFlags queryProperty(const QScriptValue &object, const QScriptString &name,
+                                     QueryFlags flags, uint *id);
+    virtual QScriptValue property(const QScriptValue &object, const QScriptString &name, uint id);
+    virtual void setProperty(QScriptValue &object, const QScriptString &name, uint id, const QScriptValue &value);
+    virtual QScriptValue::PropertyFlags propertyFlags(const QScriptValue &object, const QScriptString &name, uint id);
+
+    // 返回的迭代器由引擎删除；返回 nullptr 时只枚举对象自己的属性
+    virtual QScriptClassPropertyIterator *newIterator(const QScriptValue &object);
+
+    // 无效时使用 Object.prototype
+    virtual QScriptValue prototype() const;
+
+    virtual QString name() const;
+
+    // virtual bool supportsExtension(Extension extension) const;
+    // virtual QVariant extension(Extension extension, const QVariant &argument = QVariant());
+
+private:
+    Q_DISABLE_COPY(QScriptClass)
+
+    friend class QScriptEngine;
+    QScriptEngine *m_engine{nullptr};
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(QScriptClass::QueryFlags)
+
+#endif // QSCRIPTENGINE_QSCRIPTCLASS_H
@@ -0,0 +1,39 @@
+﻿#ifndef QSCRIPTENGINE_QSCRIPTCLASSPROPERTYITERATOR_H
+#define QSCRIPTENGINE_QSCRIPTCLASSPROPERTYITERATOR_H
+
+#include <QScriptValue>
+#include <QScriptString>
+
+// 与QtScript的QScriptClassPropertyIterator接口一致
+// 由 QScriptClass::newIterator() 创建，用于枚举 QScriptClass 对象的属性（for-in、Object.keys 等）
+// 引擎只会从头到尾用 hasNext()/next() 遍历一次，用完即删除
+class QScriptClassPropertyIterator
+{
+protected:
+    explicit QScriptClassPropertyIterator(const QScriptValue &object);
+
+public:
+    virtual ~QScriptClassPropertyIterator();
+
+    QScriptValue object() const;
+
+    virtual bool hasNext() const = 0;
+    virtual void next() = 0;
+
+    virtual bool hasPrevious() const = 0;
+    virtual void previous() = 0;
+
+    virtual void toFront() = 0;
+    virtual void toBack() = 0;
+
+    virtual QScriptString name() const = 0;
+    virtual uint id() const;
+    virtual QScriptValue::PropertyFlags flags() const;
+
+private:
+    Q_DISABLE_COPY(QScriptClassPropertyIterator)
+
+    QScriptValue m_object;
+};
+
+#endif // QSCRIPTENGINE_QSCRIPTCLASSPROPERTYITERATOR_H
@@ -3,7 +3,7 @@
 
 #include <QString>
 #include <QStringList>
-#include <vector>
+#include <QVarLengthArray>
 
 extern "C" {
 #include "quickjs.h"
@@ -35,6 +35,17 @@ public:
                    JSValueConst *argv,
                    QScriptEngine *engine,
                    JSValueConst callee);
+
+    // 原生函数调用期间使用：this 和参数直接借用调用方的 JSValue，不增加引用计数，也不分配内存
+    // 这样的上下文只在调用返回前有效；argument()/thisObject() 返回的 QScriptValue 自己持有引用，可以保留到调用之后
+    enum BorrowArgumentsTag { BorrowArguments };
+    QScriptContext(BorrowArgumentsTag,
+                   JSContext *ctx,
+                   JSValueConst this_val,
+                   int argc,
+                   JSValueConst *argv,
+                   QScriptEngine *engine,
+                   JSValueConst callee);
     ~QScriptContext();
 
     // 禁止拷贝构造函数以及拷贝赋值运算符
@@ -67,7 +78,11 @@ private:
     JSContext *m_ctx{nullptr};
     JSValue m_this{JS_UNDEFINED};
     JSValue m_activation{JS_UNDEFINED};
-    std::vector<JSValue> m_args;
+    const JSValue *m_argv{nullptr};
+    int m_argc{0};
+    // 非借用模式下持有的参数，参数不多时不会分配堆内存
+    QVarLengthArray<JSValue, 8> m_ownedArgs;
+    bool m_ownsThis{true};
     QScriptEngine *m_engine{nullptr};
     JSValue m_callee;
     bool m_calledAsConstructor{false};
@@ -6,9 +6,13 @@
 #include <QStringList>
 #include <QSet>
 #include <QMutex>
+#include <QFuture>
+#include <QElapsedTimer>
+#include <QVector>
 #include <QDebug>
 
 #include <atomic>
+#include <functional>
 #include <vector>
 #include <mutex>
 
@@ -18,11 +22,28 @@ extern "C" {
 
 #include <QScriptValue>
 #include <QScriptSyntaxCheckResult>
+#include <QScriptProgram>
+#include <QScriptTypedFunction>
+#include <QScriptString>
 #include <QHash>
+#include <QMultiHash>
+#include <QCache>
+#include <QPair>
 
 class QScriptEngineAgent;
 class QScriptContext;
 class QScriptClass;
+class QScriptTimerWheel;
+class QTimer;
+struct QScriptRuntimeData;
+struct QScriptAsyncState;
+struct QScriptAsyncJob;
+struct QScriptNativeFunctionTable;
+struct QScriptNativeFunctionProfile;
+struct QScriptMetaObjectBinding;
+struct QScriptMetaObjectMember;
+struct QObjectWrapper;
+class QScriptSignalReceiver;
 
 class QScriptEngine : public QObject
 {
@@ -52,6 +73,17 @@ public:
     explicit QScriptEngine(QObject *parent = nullptr);
     ~QScriptEngine();
 
+    // 创建一个与本引擎共享 JSRuntime 的兄弟引擎
+    // 兄弟引擎有各自独立的全局对象，但共享原子表、内存分配器和GC，创建开销远小于独立的引擎
+    // 共享runtime的引擎同一时刻只能在一个线程中使用，runtime由最后一个被销毁的引擎释放
+    // Promise任务队列也是runtime级别的，QuickJS 不能只执行某一个context的任务：
+    // 任何一个兄弟引擎执行任务时都会把整个队列（包括其它兄弟排下的任务）一起执行，
+    // 这些任务受执行任务的引擎的执行限制和 abortEvaluation() 约束；
+    // 任务中未捕获的异常在任务所属的context中丢弃（仍然体现在对应Promise的状态上），
+    // jobStatistics().jobsExecuted 也记在任务所属的引擎上
+    QScriptEngine *createSiblingEngine(QObject *parent = nullptr);
+    bool sharesRuntimeWith(const QScriptEngine *other) const;
+
     bool isEvaluating() const;
     void abortEvaluation(const QScriptValue &result = QScriptValue());
 
@@ -60,23 +92,133 @@ public:
 
     void collectGarbage();
 
+    // 堆、栈和GC的配置，作用于引擎的runtime：兄弟引擎共享同一个runtime，也共享这些配置
+    // 超出堆限制时脚本得到可以catch的 "InternalError: out of memory"；
+    // 没有被脚本处理时 evaluate() 返回这个异常，并回收脚本留下的垃圾，引擎之后可以继续使用
+    // heapLimit 为0表示不限制（默认）
+    void setHeapLimit(size_t bytes);
+    size_t heapLimit() const;
+    // 超出时抛出 RangeError，为0时使用 QuickJS 的默认值（1MB）
+    void setMaxStackSize(size_t bytes);
+    size_t maxStackSize() const;
+    // 分配的内存每增长这么多就执行一次GC，为 size_t(-1) 时只在 collectGarbage() 中执行
+    void setGCThreshold(size_t bytes);
+    size_t gcThreshold() const;
+
     QScriptContext *currentContext() const;
 
     QScriptValue evaluate(const QString &program, const QString &fileName = QString(), int lineNumber = 1);
+    // 只在第一次执行时编译，之后直接运行缓存的字节码
+    QScriptValue evaluate(const QScriptProgram &program);
+
+    // 执行限制，小于等于0表示不限制（默认都不限制）
+    // 作用于每一次最外层的执行：evaluate()、QScriptValue::call()、定时器回调和事件循环中执行的Promise任务，
+    // 脚本排下的Promise任务算在脚本自己的限制里；嵌套在原生函数中的 evaluate() 共用外层的限制
+    // 超出限制时脚本被终止（脚本中无法catch），调用者得到 name 为 "TimeoutError" 的异常，
+    // 它的 limit 属性是 "wallTime"、"cpuTime" 或 "instructions"
+    //
+    // 限制由中断处理器检查，QuickJS 大约每执行一万次跳转/调用才回调一次，因此限制是近似的：
+    // instructionLimit 按一万的粒度计数，时间限制可能超出一次回调间隔的执行时间（通常远小于1毫秒）。
+    // 没有设置限制时中断处理器只多读一个标志；设置了时间限制时每次回调多读一次时钟，
+    // 墙钟是单调时钟（vDSO，几十纳秒），CPU时间需要一次系统调用（约1微秒），平摊到一万次跳转上可以忽略
+    struct EvaluationLimits {
+        int wallTimeMs{0};              // 墙钟时间
+        int cpuTimeMs{0};               // 执行线程消耗的CPU时间
+        qint64 instructionLimit{0};     // 近似的指令数
+    };
+    enum LimitKind {
+        NoLimitExceeded,
+        WallTimeLimitExceeded,
+        CpuTimeLimitExceeded,
+        InstructionLimitExceeded
+    };
+    void setEvaluationLimits(const EvaluationLimits &limits);
+    EvaluationLimits evaluationLimits() const;
+    // 只对这一次执行生效的限制，代替 evaluationLimits()
+    QScriptValue evaluate(const QString &program, const QString &fileName, int lineNumber, const EvaluationLimits &limits);
+    // 上一次最外层的执行超出了哪一项限制
+    LimitKind lastExceededLimit() const;
+
+    // 在引擎自己的工作线程中执行脚本，不阻塞调用线程
+    // 脚本的结果是Promise时（例如async函数），等Promise完成后future才结束，等待期间工作线程可以继续执行其它脚本
+    // 同一个runtime同一时刻只在一个线程中执行：异步任务执行期间，其它线程中的 evaluate() 会等待当前任务执行完
+    // 只能在引擎所属的线程中调用
+    QFuture<QScriptValue> evaluateAsync(const QString &program, const QString &fileName = QString(), int lineNumber = 1);
+    QFuture<QScriptValue> evaluateAsync(const QScriptProgram &program);
+
+    // Promise任务（async函数、then回调等）的执行
+    // 最外层的 evaluate() 返回前会执行脚本排下的任务，每批最多执行 jobBatchSize() 个，
+    // 或者耗时超过 jobTimeBudget() 毫秒就停止，剩下的任务投递到当前线程的事件循环中分批继续执行，
+    // 大量的Promise任务也不会卡住事件循环。小于等于0表示不限制
+    struct JobStatistics {
+        qint64 jobsExecuted{0};     // 执行的属于本引擎的任务数（可能是兄弟引擎执行的）
+        qint64 batchCount{0};       // 执行的批数
+        qint64 deferredCount{0};    // 超出限制、推迟到事件循环中继续执行的次数
+        qint64 totalNs{0};          // 执行任务的总耗时
+        qint64 maxBatchNs{0};
+    };
+
+    void setJobBatchSize(int size);
+    int jobBatchSize() const;
+    void setJobTimeBudget(int msecs);
+    int jobTimeBudget() const;
+
+    // 立即执行一批积压的任务，返回执行的任务数
+    int processPendingJobs();
+
+    JobStatistics jobStatistics() const;
+    void resetJobStatistics();
 
     QScriptValue globalObject() const;
     void setGlobalObject(const QScriptValue &object);
 
     QScriptValue newObject();
+    // 属性访问通过 scriptClass 的回调在C++中完成，见 QScriptClass
     QScriptValue newObject(QScriptClass *scriptClass, const QScriptValue &data = QScriptValue());
+    // 属性名的句柄，重复使用同一个名字时不需要再转换字符串
+    QScriptString toStringHandle(const QString &str);
     QScriptValue newArray(uint length = 0);
 
     typedef QScriptValue (*FunctionSignature)(QScriptContext *, QScriptEngine *);
     QScriptValue newFunction(FunctionSignature signature, int length = 0);
     QScriptValue newFunction(FunctionSignature signature, const QScriptValue &prototype, int length = 0);
+    // name 同时作为JS函数的 name 属性和调用统计的名字，没有指定时为 "native"
+    QScriptValue newFunction(FunctionSignature signature, int length, const QString &name);
 
     typedef QScriptValue (*FunctionWithArgSignature)(QScriptContext *, QScriptEngine *, void *);
     QScriptValue newFunction(FunctionWithArgSignature signature, void *arg);
+    QScriptValue newFunction(FunctionWithArgSignature signature, void *arg, const QString &name);
+
+    // 类型化的原生函数，例如 double myFunc(double, int, QString)
+    // 参数和返回值的转换在编译期生成，不经过 QScriptContext 和 QVariant；
+    // 参数个数不足或者类型不匹配时抛出 TypeError，支持的类型见 QScriptTypeConverter
+    template<typename R, typename... Args>
+    QScriptValue newFunction(R (*function)(Args...), const QString &name = QString())
+    {
+        return registerTypedFunction(&QScriptTypedFunction<R, Args...>::call,
+                                     reinterpret_cast<void *>(function),
+                                     int(sizeof...(Args)), name);
+    }
+
+    // 原生函数的调用统计，默认关闭
+    // 打开后每次调用多读两次单调时钟、更新几个原子计数器，关闭时只多读一个标志
+    // 统计按函数名合并：同名的函数（包括没有指定名字的 "native"）计入同一项
+    struct NativeFunctionStatistics {
+        enum { HistogramSize = 16 };
+        QString name;
+        qint64 callCount{0};
+        qint64 totalNs{0};
+        qint64 minNs{0};
+        qint64 maxNs{0};
+        // 耗时分布：第0个桶小于1微秒，第i个桶为 [2^(i-1), 2^i) 微秒，最后一个桶包含所有更长的调用
+        QVector<qint64> histogram;
+    };
+    void setNativeProfilingEnabled(bool enabled);
+    bool isNativeProfilingEnabled() const { return m_nativeProfiling.load(std::memory_order_relaxed); }
+    QList<NativeFunctionStatistics> nativeFunctionStatistics() const;
+    void resetNativeFunctionStatistics();
+    // 以JSON数组输出 nativeFunctionStatistics()，按总耗时从大到小排列
+    QByteArray nativeFunctionStatisticsJson() const;
 
     QScriptValue newVariant(const QVariant &value);
     QScriptValue newVariant(const QScriptValue &object, const QVariant &value);
@@ -84,6 +226,12 @@ public:
     QScriptValue newQObject(QObject *object, QScriptEngine::ValueOwnership ownership = QtOwnership, const QScriptEngine::QObjectWrapOptions &options = QObjectWrapOptions());
     QScriptValue newQObject(const QScriptValue &scriptObject, QObject *qtObject, QScriptEngine::ValueOwnership ownership = QtOwnership, const QScriptEngine::QObjectWrapOptions &options = QObjectWrapOptions());
 
+    // 脚本中用 obj.someSignal.connect(fn) / connect(thisObject, fn) 连接信号，disconnect 断开
+    // 其它线程中发射的信号排队到引擎所在的线程执行，默认每个信号一个脚本轮次（与 Qt::QueuedConnection 相同）；
+    // 打开合并后，一次事件循环中积压的信号在同一个脚本轮次中执行完，最后只执行一次Promise任务
+    void setQueuedSignalCoalescingEnabled(bool enabled);
+    bool isQueuedSignalCoalescingEnabled() const;
+
     QScriptValue defaultPrototype(int metaTypeId) const;
     void setDefaultPrototype(int metaTypeId, const QScriptValue &prototype);
 
@@ -139,6 +287,11 @@ public:
     // 静态模块初始化回调
     static int moduleInitCallback(JSContext *ctx, JSModuleDef *m);
 
+    // 文件模块的字节码缓存目录，为空时不缓存（默认）
+    // 多个引擎可以共用同一个目录，源码改动后缓存自动失效
+    void setModuleCacheDirectory(const QString &path);
+    QString moduleCacheDirectory() const;
+
     static QScriptSyntaxCheckResult checkSyntax(const QString &program);
 
     // template <typename T>
@@ -161,41 +314,232 @@ public:
 
     // 中断标志，用于打断执行
     std::atomic_int interrupt_flag = 0;
+    // evaluateAsync 的工作线程正在退出，中断处理器据此打断脚本；与 interrupt_flag 不同，evaluate() 不会复位它
+    std::atomic_bool async_stopping{false};
 
-    QStringList fileNameBuffer(){
+    const QStringList &fileNameBuffer() const {
         return mFileNameBuffer;
     }
+    // 文件名第一次出现时对应的scriptId，不存在时返回-1
+    qint64 scriptIdForFileName(const QString &fileName) const {
+        return m_scriptIdByFileName.value(fileName, -1);
+    }
 
 public:
-    bool getNativeEntry(int idx, FunctionWithArgSignature &outFunc, void **outArg, JSValue &callee) const;
     QObject *qobjectFromJSValue(JSContext *ctx, JSValueConst val) const;
     JSClassID qObjectClassId() const { return m_qobjectClassId; }
+    // 同一个 QMetaObject 以相同选项包装的对象共用的绑定信息，第一次用到时创建
+    QScriptMetaObjectBinding *metaObjectBinding(const QMetaObject *metaObject, QObjectWrapOptions options);
+    // 按名字解析包装对象的成员，结果按atom缓存
+    QScriptMetaObjectMember metaObjectMember(QScriptMetaObjectBinding *binding, JSAtom atom);
+    // 可枚举的成员名
+    const QVector<JSAtom> &metaObjectMemberNames(QScriptMetaObjectBinding *binding);
+    // 同名的一组重载方法，下标保存在方法函数的magic中
+    const QVector<int> &methodOverloads(int slot) const { return m_methodOverloads.at(slot); }
+    // 这组重载方法所属的 QMetaObject，this 必须是它或它的子类的对象
+    const QMetaObject *methodOwner(int slot) const { return m_methodOwners.at(slot); }
+    // 包装对象被回收时从缓存中移除
+    void removeCachedWrapper(QObjectWrapper *wrapper);
+    // QScriptClass 创建的对象所属的类，data 为 newObject() 的第二个参数；其它值返回 nullptr
+    QScriptClass *scriptClassFromJSValue(JSValueConst val, QScriptValue *data = nullptr) const;
+    // atom 对应的字符串，结果被缓存（QScriptString::toString 使用）
+    QString atomName(JSAtom atom);
+    // obj.someSignal 对应的信号对象，signalIndex 是信号的方法下标
+    JSValue newSignalObject(QObject *sender, int signalIndex);
+    bool connectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function);
+    bool disconnectSignal(QObject *sender, int signalIndex, JSValueConst thisObject, JSValueConst function);
+    // QScriptValue::call/callAsConstructor 的实现
+    QScriptValue callFunction(JSValueConst func, JSValueConst thisObject, int argc, JSValueConst *argv, bool construct);
+    // QScriptValue::callBatch 的实现，返回实际调用的次数
+    int callFunctionBatch(JSValueConst func, JSValueConst thisObject, int rowCount, int argc,
+                          const std::function<void(JSContext *, int, JSValue *)> &fillArguments,
+                          QScriptValueList &results, QList<bool> *failed);
+    // 原生函数数据对象上保存的参数（newFunction 的 arg 或者类型化函数的函数指针）
+    static void *nativeFunctionArg(JSValueConst data);
+    // 原生函数进入、退出时通知agent，ret 为 JS_EXCEPTION 时返回值为无效值
+    void notifyNativeFunctionEntry();
+    void notifyNativeFunctionExit(JSValueConst ret);
+    // 把积压的Promise任务投递到当前线程的事件循环中执行
+    void scheduleJobDrain();
+    // 取消所有 setTimeout/setInterval 定时器
+    void clearTimers();
 
 private:
-    QScriptValue registerNativeFunction(FunctionWithArgSignature signature, void *arg, int length = 0, int cproto = JS_CFUNC_generic_magic);
+    struct SharedRuntimeTag {};
+    QScriptEngine(SharedRuntimeTag, QScriptEngine *sibling, QObject *parent);
+    void initContext();
+    void releaseRuntime();
+
+    friend class QScriptProgramPrivate;
+    friend struct EvalGuard;
+    friend class QScriptSignalReceiver;
+    QScriptValue evaluateSource(const QString &program, const QString &fileName, int lineNumber, const EvaluationLimits *limits);
+    bool compileProgram(QScriptProgramPrivate *program, JSValue *fun);
+    void releaseProgram(QScriptProgramPrivate *program);
+    // isCall 为true时是 QScriptValue::call 的结果，只通知agent函数退出，不清空agent的调用栈计数
+    QScriptValue finishEvaluate(JSValue val, qint64 scriptId, bool isCall = false);
+    qint64 registerScriptFileName(const QString &fileName);
+
+    QFuture<QScriptValue> enqueueAsync(QScriptAsyncJob &job);
+    void runAsyncJobs();
+    void settleAsyncJobs();
+    void scheduleAsyncSettle();
+    void stopAsyncWorker();
+    int drainPendingJobs();
+
+    // setTimeout/setInterval，magic为1时是setInterval
+    static JSValue js_setTimer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic);
+    static JSValue js_clearTimer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+    void armTimerDriver();
+    void fireTimers();
+    // abortEvaluation() 时其它线程正在执行脚本、没能立即取消的定时器，由持有runtime锁的一方补上
+    void clearAbortedTimers();
+
+    QScriptValue registerNativeFunction(FunctionWithArgSignature signature, void *arg, int length = 0, int cproto = JS_CFUNC_generic_magic,
+                                        const QString &name = QString());
+    QScriptValue registerTypedFunction(JSCFunctionData *trampoline, void *function, int length, const QString &name);
 
 private:
     JSRuntime *m_rt{nullptr};
     JSContext *m_ctx{nullptr};
+    QScriptRuntimeData *m_runtime{nullptr};
+    QScriptAsyncState *m_async{nullptr};
+
+    int m_jobBatchSize{1024};
+    int m_jobTimeBudgetMs{5};
+    std::atomic<bool> m_jobDrainScheduled{false};
+    JobStatistics m_jobStats;
+    mutable QMutex m_jobStatsMutex;
+
+    EvaluationLimits m_limits;
+    LimitKind m_lastExceededLimit{NoLimitExceeded};
+
+    // setTimeout/setInterval 定时器，由引擎所属线程的事件循环驱动
+    struct TimerEntry {
+        JSValue func{JS_UNDEFINED};
+        QVector<JSValue> args;
+        qint64 interval{0};
+        bool repeat{false};
+    };
+    QHash<int, TimerEntry> m_timers;
+    QScriptTimerWheel *m_timerWheel{nullptr};
+    QTimer *m_timerDriver{nullptr};
+    QElapsedTimer m_timerClock;
+    int m_nextTimerId{1};
+    std::atomic<bool> m_timersAborted{false};
     QScriptEngineAgent *m_agent{nullptr};
     JSClassID m_qobjectClassId{0};
     std::atomic<int> m_evalCount{0};
-    struct NativeFunctionEntry {
-        FunctionWithArgSignature func;
-        void *arg;
-        JSValue callee;
-    };
-    std::vector<NativeFunctionEntry> m_nativeFunctions;
-    mutable std::mutex m_nativeFunctionsMutex;
+    // 原生函数表，表项随JS函数对象一起回收
+    QScriptNativeFunctionTable *m_nativeFunctions{nullptr};
+    std::atomic<bool> m_nativeProfiling{false};
 
     // 为engienAgent提供scriptID;
     QStringList mFileNameBuffer;
+    QHash<QString, qint64> m_scriptIdByFileName;
     QScriptContext *mCurCtx{nullptr};     // 还未实现
     QScriptValue *mGlobalObject{nullptr};
     QHash<int, QScriptValue> m_defaultPrototypes;
+
+    // QObject 包装对象的绑定信息，按 QMetaObject 和包装选项缓存
+    QHash<QPair<const QMetaObject*, int>, QScriptMetaObjectBinding*> m_metaObjectBindings;
+    QVector<QVector<int>> m_methodOverloads;
+    QVector<const QMetaObject*> m_methodOwners;
+    void indexMetaObjectMethods(QScriptMetaObjectBinding *binding);
+    void clearMetaObjectBindings();
+
+    // 以 PreferExistingWrapperObject 创建的包装对象，不持有引用（弱引用），每种绑定和所有权各一个
+    // 包装对象被回收或者QObject被删除时移除
+    QMultiHash<QObject*, QObjectWrapper*> m_wrapperCache;
+    void wrappedObjectDestroyed(QObject *object);
+    void clearWrapperCache();
+
+    // 信号连接，第一次 connect 时创建接收对象
+    QScriptSignalReceiver *m_signalReceiver{nullptr};
+    JSValue m_signalPrototype{JS_UNDEFINED};
+    std::atomic<bool> m_coalesceQueuedSignals{false};
+    void clearSignalConnections();
+
+    // QScriptClass 注册的JS类，类ID按runtime记录（见 QScriptRuntimeData），这里只记录已在本引擎的context中设置过默认原型的类
+    QSet<JSClassID> m_scriptClassProtos;
+    JSClassID scriptClassId(QScriptClass *scriptClass);
+
+    // 属性名缓存：toStringHandle() 的字符串 -> atom，以及 atom -> 字符串
+    // 按最近使用淘汰，缓存项持有atom的一个引用，被淘汰或者清空时释放
+    struct CachedAtom {
+        JSContext *ctx{nullptr};
+        JSAtom atom{JS_ATOM_NULL};
+        QString name;
+        ~CachedAtom() { JS_FreeAtom(ctx, atom); }
+    };
+    enum { StringHandleCacheSize = 4096 };
+    QCache<QString, CachedAtom> m_stringHandles{StringHandleCacheSize};
+    QCache<JSAtom, CachedAtom> m_atomNames{StringHandleCacheSize};
+    void clearStringHandles();
+
+    // 在本引擎中编译过的 QScriptProgram，引擎析构时需要释放其字节码
+    QSet<QScriptProgramPrivate*> m_programs;
+
+    QString m_moduleCacheDirectory;
 };
 
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(QScriptEngine::QObjectWrapOptions)
 
+// 原生函数调用计时，只在打开了 setNativeProfilingEnabled() 时计时，析构时记录
+// 仅供内部使用
+class QScriptNativeCallTimer
+{
+public:
+    QScriptNativeCallTimer(QScriptEngine *engine, QScriptNativeFunctionProfile *profile);
+    // data 为原生函数的数据对象
+    QScriptNativeCallTimer(QScriptEngine *engine, JSValueConst data);
+    ~QScriptNativeCallTimer();
+
+private:
+    Q_DISABLE_COPY(QScriptNativeCallTimer)
+    QScriptNativeFunctionProfile *m_profile{nullptr};
+    qint64 m_start{0};
+};
+
+template<typename R, typename... Args>
+JSValue QScriptTypedFunction<R, Args...>::call(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic, JSValueConst *func_data)
+{
+    Q_UNUSED(this_val);
+    Q_UNUSED(magic);
+
+    QScriptEngine *engine = static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx));
+    if (!engine)
+        return JS_UNDEFINED;
+
+    // 与 newFunction(FunctionSignature) 注册的函数一样响应中断
+    if (std::atomic_load(&engine->interrupt_flag))
+        return JS_ThrowTypeError(ctx, "%s", "stop");
+
+    Function function = reinterpret_cast<Function>(QScriptEngine::nativeFunctionArg(func_data[0]));
+    if (!function)
+        return JS_UNDEFINED;
+
+    // 与 nativeFunctionShim 一样通知agent，没有agent时只多比较一次指针
+    const bool notify = (engine->agent() != nullptr);
+    if (notify)
+        engine->notifyNativeFunctionEntry();
+
+    JSValue ret;
+    constexpr int arity = int(sizeof...(Args));
+    if (argc < arity)
+    {
+        ret = JS_ThrowTypeError(ctx, "expected %d arguments but got %d", arity, argc);
+    }
+    else
+    {
+        QScriptNativeCallTimer timer(engine, func_data[0]);
+        ret = invoke(ctx, function, argv, std::index_sequence_for<Args...>());
+    }
+
+    if (notify)
+        engine->notifyNativeFunctionExit(ret);
+    return ret;
+}
+
 #endif // QSCRIPTENGINE_QSCRIPTENGINE_H
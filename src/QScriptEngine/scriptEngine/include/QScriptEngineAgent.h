@@ -33,19 +33,34 @@ public:
     bool isPosChanged(qint64 line, qint64 col);
     qint64 scriptId(QString fileName);
 
-    QList<QString> mFuncStack;
+    QList<QByteArray> mFuncStack;
     // 纯函数或者一些其他的脚本会导致无OP_return
     // 只能手动判断一下了
     qint64 mFuncStackCounter = 0;
     void checkFunctionPair(qint64 scriptId, QScriptValue value);
 
+    // 逐指令回调中缓存上一次的文件名及其scriptId，避免每条指令都查找一次
+    QByteArray mLastFileName;
+    qint64 mLastScriptId = -1;
+    int mLastFileCount = -1;
+
 private:
+    friend class QScriptEngine;
     QScriptEngine *m_engine{nullptr};
 
     qint64 mLastLine;
     qint64 mLastCol;
 };
 
+// 逐指令回调，只在 QScriptEngine::setAgent 设置了agent时才会被安装
+int scriptOPChanged(uint8_t op,
+                    const char *fileName,
+                    const char *funcName,
+                    int line,
+                    int col,
+                    void *userData
+                    );
+
 class QJDefines: public QObject
 {
     Q_OBJECT
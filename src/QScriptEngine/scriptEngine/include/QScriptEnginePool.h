@@ -0,0 +1,103 @@
+﻿#ifndef QSCRIPTENGINE_QSCRIPTENGINEPOOL_H
+#define QSCRIPTENGINE_QSCRIPTENGINEPOOL_H
+
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <functional>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+class QScriptEngine;
+
+// 预先创建好的引擎池，适用于“一个请求一个引擎”的场景
+// 引擎在创建时执行一次 setup 回调（注册console、本地函数、模块等），
+// 默认（RestoreGlobalObject）归还时只把全局对象恢复到 setup 之后的状态，而不是销毁重建
+//
+// RestoreGlobalObject 不是完整的隔离，只恢复全局对象自己的属性，下面这些会留给下一个使用者：
+//   - 对内置对象的修改，例如 Array.prototype.foo = ...、改写 JSON.parse、Object.freeze(Math)
+//   - 顶层的 let/const/class 声明（不在全局对象上，QuickJS 没有提供清除它们的接口）
+//   - 已经加载的模块及其状态（模块缓存是引擎级别的）
+//   - 全局对象上 getter/setter 属性背后的状态
+// 需要完全隔离时使用 RecreateEngine：归还时销毁引擎，重新创建并再执行一次 setup，代价是归还变慢
+//
+// 线程：空闲的引擎不属于任何线程，acquire() 把引擎移到调用线程，定时器和排队的信号都由这个线程的事件循环驱动；
+// release() 必须在调用 acquire() 的那个线程中调用。同一时刻一个引擎只能被一个线程使用
+class QScriptEnginePool
+{
+public:
+    typedef std::function<void(QScriptEngine *)> SetupFunction;
+
+    enum ResetMode {
+        RestoreGlobalObject,    // 恢复全局对象自己的属性，开销小，限制见上
+        RecreateEngine          // 销毁重建并重新执行 setup，setup 在调用 release() 的线程中执行
+    };
+
+    struct Statistics {
+        qint64 acquireCount{0};     // acquire() 成功的次数
+        qint64 reuseCount{0};       // 取到的是已经被使用过的引擎的次数
+        qint64 totalAcquireNs{0};   // acquire() 的总耗时（包含等待空闲引擎的时间）
+        qint64 maxAcquireNs{0};
+        qint64 resetCount{0};       // release() 时重置引擎的次数
+        qint64 totalResetNs{0};
+        qint64 maxResetNs{0};
+    };
+
+    explicit QScriptEnginePool(int size, const SetupFunction &setup = SetupFunction(),
+                               ResetMode mode = RestoreGlobalObject);
+    ~QScriptEnginePool();
+
+    // 禁止拷贝构造函数以及拷贝赋值运算符
+    QScriptEnginePool(const QScriptEnginePool&) = delete;
+    QScriptEnginePool& operator=(const QScriptEnginePool&) = delete;
+
+    int size() const;
+    int availableCount() const;
+    ResetMode resetMode() const;
+
+    // 取出一个引擎，没有空闲引擎时最多等待 timeoutMs 毫秒（-1 表示一直等待），超时返回nullptr
+    QScriptEngine *acquire(int timeoutMs = -1);
+    // 归还引擎，引擎会被重置到 setup 之后的状态
+    void release(QScriptEngine *engine);
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+private:
+    struct GlobalProperty {
+        JSValue value{JS_UNDEFINED};
+        int flags{0};
+        bool accessor{false};   // getter/setter 属性只检查是否存在，不恢复其值
+    };
+
+    struct PooledEngine {
+        QScriptEngine *engine{nullptr};
+        qint64 useCount{0};
+        bool inUse{false};
+        // setup 之后全局对象上的属性快照，用于归还时恢复
+        QHash<JSAtom, GlobalProperty> globals;
+    };
+
+    PooledEngine *findEntry(QScriptEngine *engine);
+    QScriptEngine *createEngine();
+    void takeSnapshot(PooledEngine *entry);
+    void freeSnapshot(PooledEngine *entry);
+    void resetEngine(PooledEngine *entry);
+
+private:
+    QList<PooledEngine*> m_entries;
+    QList<PooledEngine*> m_idle;
+    SetupFunction m_setup;
+    ResetMode m_mode{RestoreGlobalObject};
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_idleCondition;
+
+    Statistics m_stats;
+};
+
+#endif // QSCRIPTENGINE_QSCRIPTENGINEPOOL_H
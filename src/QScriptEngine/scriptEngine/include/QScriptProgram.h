@@ -0,0 +1,76 @@
+﻿#ifndef QSCRIPTENGINE_QSCRIPTPROGRAM_H
+#define QSCRIPTENGINE_QSCRIPTPROGRAM_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSharedData>
+#include <QExplicitlySharedDataPointer>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+class QScriptEngine;
+class QScriptProgramPrivate;
+
+// 与QtScript的QScriptProgram接口一致
+// 源码只会被编译一次（JS_EVAL_FLAG_COMPILE_ONLY），之后重复执行时直接运行缓存的字节码
+// 同一个程序在其它引擎（包括共享runtime的兄弟引擎）中执行时，通过 JS_ReadObject 从序列化的字节码实例化，不需要重新解析源码
+class QScriptProgram
+{
+public:
+    QScriptProgram();
+    QScriptProgram(const QString &sourceCode,
+                   const QString fileName = QString(),
+                   int firstLineNumber = 1);
+    QScriptProgram(const QScriptProgram &other);
+    ~QScriptProgram();
+
+    QScriptProgram &operator=(const QScriptProgram &other);
+
+    bool isNull() const;
+
+    QString sourceCode() const;
+    QString fileName() const;
+    int firstLineNumber() const;
+
+    bool operator==(const QScriptProgram &other) const;
+    bool operator!=(const QScriptProgram &other) const;
+
+private:
+    QExplicitlySharedDataPointer<QScriptProgramPrivate> d_ptr;
+
+    friend class QScriptEngine;
+};
+
+/* 以下内容仅供内部使用，请勿在外部使用 */
+class QScriptProgramPrivate : public QSharedData
+{
+public:
+    QScriptProgramPrivate(const QString &src, const QString &fn, int ln);
+    ~QScriptProgramPrivate();
+
+    QString    sourceCode;
+    QString    fileName;
+    int        firstLineNumber{1};
+
+    QByteArray sourceUtf8;
+    QByteArray fileNameUtf8;
+
+    struct CompiledProgram {
+        JSValue bytecode{JS_UNDEFINED};
+        qint64  scriptId{-1};
+    };
+
+    // 函数字节码绑定了创建它的context，因此每个引擎各持有一份
+    QHash<QScriptEngine*, CompiledProgram> compiled;
+    // 序列化后的字节码，与引擎无关
+    QByteArray serializedBytecode;
+
+    // 同一个程序可能同时被不同线程中的引擎执行
+    QMutex mutex;
+};
+
+#endif // QSCRIPTENGINE_QSCRIPTPROGRAM_H
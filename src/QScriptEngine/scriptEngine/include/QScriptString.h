@@ -0,0 +1,50 @@
+﻿#ifndef QSCRIPTENGINE_QSCRIPTSTRING_H
+#define QSCRIPTENGINE_QSCRIPTSTRING_H
+
+#include <QtGlobal>
+#include <QString>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+// 与QtScript的QScriptString接口一致：属性名的句柄，内部就是一个 JSAtom
+// 比较和哈希只比较atom，不需要比较字符串；toString() 的结果由引擎缓存
+// 与 QScriptValue 一样，不能在引擎析构之后使用
+class QScriptString
+{
+public:
+    QScriptString();
+    QScriptString(const QScriptString &other);
+    ~QScriptString();
+
+    QScriptString &operator=(const QScriptString &other);
+
+    bool isValid() const;
+
+    bool operator==(const QScriptString &other) const;
+    bool operator!=(const QScriptString &other) const;
+
+    // 名字是数组下标（"0"~"4294967294"）时返回下标，否则 ok 为false
+    quint32 toArrayIndex(bool *ok = nullptr) const;
+
+    QString toString() const;
+    operator QString() const;
+
+    /* 以下函数仅供内部使用*/
+    // 持有 atom 的一份引用
+    QScriptString(JSContext *ctx, JSAtom atom);
+    JSAtom atom() const { return m_atom; }
+
+private:
+    JSContext *m_ctx{nullptr};
+    JSAtom m_atom{JS_ATOM_NULL};
+};
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+size_t qHash(const QScriptString &key, size_t seed = 0);
+#else
+uint qHash(const QScriptString &key, uint seed = 0);
+#endif
+
+#endif // QSCRIPTENGINE_QSCRIPTSTRING_H
@@ -0,0 +1,76 @@
+﻿#ifndef QSCRIPTENGINE_QSCRIPTTIMERWHEEL_H
+#define QSCRIPTENGINE_QSCRIPTTIMERWHEEL_H
+
+#include <QHash>
+#include <QList>
+
+#include <climits>
+#include <vector>
+
+// 哈希时间轮，供 setTimeout/setInterval 使用（仅供内部使用）
+// 定时器按到期的tick散列到各个槽中，添加、删除都是O(1)，推进时只访问经过的槽，
+// 即使有成千上万个定时器，每个tick的开销也只和该槽中的定时器个数有关
+// 所有时间都是单调时钟的毫秒数，由调用者传入；本类不是线程安全的
+class QScriptTimerWheel
+{
+public:
+    explicit QScriptTimerWheel(int slotCount = 512, int tickMs = 1);
+    ~QScriptTimerWheel();
+
+    // 禁止拷贝构造函数以及拷贝赋值运算符
+    QScriptTimerWheel(const QScriptTimerWheel&) = delete;
+    QScriptTimerWheel& operator=(const QScriptTimerWheel&) = delete;
+
+    // 添加定时器，delayMs 毫秒后到期；id已经存在时重新计时
+    void start(int id, qint64 delayMs, qint64 nowMs);
+    bool stop(int id);
+    bool contains(int id) const;
+    int count() const;
+    void clear();
+
+    // 推进到 nowMs，到期的定时器按到期顺序追加到 expired 中并从时间轮中移除
+    void advance(qint64 nowMs, QList<int> &expired);
+
+    // 距离下一个需要处理的槽还有多少毫秒，没有定时器时返回-1
+    qint64 nextTimeout(qint64 nowMs) const;
+
+    // 从 next 开始分配一个 isUsed(id) 为false的id，范围是 1..INT_MAX，回绕后从1重新开始，
+    // 还在使用的id被跳过；next 推进到分配出去的id之后
+    template<typename IsUsed>
+    static int allocateId(int &next, IsUsed isUsed)
+    {
+        int id = (next > 0) ? next : 1;
+        while (isUsed(id))
+        {
+            id = (id == INT_MAX) ? 1 : id + 1;
+        }
+        next = (id == INT_MAX) ? 1 : id + 1;
+        return id;
+    }
+
+private:
+    struct Node {
+        int id;
+        qint64 rounds;      // 还要转几圈才到期
+        int slot;
+        Node *prev;
+        Node *next;
+    };
+
+    void link(Node *node, int slot);
+    void unlink(Node *node);
+
+private:
+    struct Slot {
+        Node *head{nullptr};
+        Node *tail{nullptr};
+    };
+
+    std::vector<Slot> m_slots;
+    int m_mask;
+    int m_tickMs;
+    qint64 m_currentTick{0};    // 已经处理过的最后一个tick
+    QHash<int, Node*> m_nodes;
+};
+
+#endif // QSCRIPTENGINE_QSCRIPTTIMERWHEEL_H
@@ -0,0 +1,265 @@
+﻿#ifndef QSCRIPTENGINE_QSCRIPTTYPEDFUNCTION_H
+#define QSCRIPTENGINE_QSCRIPTTYPEDFUNCTION_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVariant>
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+#include <QScriptValue>
+
+class QScriptEngine;
+
+// QScriptEngine::newFunction(R (*)(Args...)) 使用的类型转换（仅供内部使用）
+// 参数和返回值直接在 JSValue 与 C++ 类型之间转换，不经过 QVariant
+// fromJS 类型不匹配时返回false，由调用者抛出 TypeError；数值、布尔、字符串不做隐式转换，
+// 整数类型的小数部分被截掉，超出范围（以及NaN）视为不匹配，不会回绕
+// 需要支持其它类型时，特化 QScriptTypeConverter 即可
+template<typename T>
+struct QScriptTypeConverter;
+
+template<>
+struct QScriptTypeConverter<bool>
+{
+    static const char *typeName() { return "boolean"; }
+    static bool fromJS(JSContext *, JSValueConst val, bool &out)
+    {
+        if (!JS_IsBool(val))
+            return false;
+        out = JS_VALUE_GET_BOOL(val);
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, bool value) { return JS_NewBool(ctx, value); }
+};
+
+template<>
+struct QScriptTypeConverter<int>
+{
+    static const char *typeName() { return "number"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, int &out)
+    {
+        if (!JS_IsNumber(val))
+            return false;
+        double v = 0;
+        if (JS_ToFloat64(ctx, &v, val) < 0)
+            return false;
+        if (!(v >= double(std::numeric_limits<int>::min()) && v <= double(std::numeric_limits<int>::max())))
+            return false;
+        out = int(v);
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, int value) { return JS_NewInt32(ctx, value); }
+};
+
+template<>
+struct QScriptTypeConverter<uint>
+{
+    static const char *typeName() { return "number"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, uint &out)
+    {
+        if (!JS_IsNumber(val))
+            return false;
+        double v = 0;
+        if (JS_ToFloat64(ctx, &v, val) < 0)
+            return false;
+        // 负数不会变成 4294967295 之类的值
+        if (!(v >= 0 && v <= double(std::numeric_limits<uint>::max())))
+            return false;
+        out = uint(v);
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, uint value) { return JS_NewUint32(ctx, value); }
+};
+
+template<>
+struct QScriptTypeConverter<qint64>
+{
+    static const char *typeName() { return "number"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, qint64 &out)
+    {
+        if (!JS_IsNumber(val))
+            return false;
+        double v = 0;
+        if (JS_ToFloat64(ctx, &v, val) < 0)
+            return false;
+        // qint64 的最大值不能精确表示为double（会变成 2^63），上界用 2^63 且不包含
+        const double bound = -double(std::numeric_limits<qint64>::min());
+        if (!(v >= -bound && v < bound))
+            return false;
+        out = qint64(v);
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, qint64 value) { return JS_NewInt64(ctx, value); }
+};
+
+template<>
+struct QScriptTypeConverter<double>
+{
+    static const char *typeName() { return "number"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, double &out)
+    {
+        if (!JS_IsNumber(val))
+            return false;
+        return JS_ToFloat64(ctx, &out, val) == 0;
+    }
+    static JSValue toJS(JSContext *ctx, double value) { return JS_NewFloat64(ctx, value); }
+};
+
+template<>
+struct QScriptTypeConverter<float>
+{
+    static const char *typeName() { return "number"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, float &out)
+    {
+        double v = 0;
+        if (!QScriptTypeConverter<double>::fromJS(ctx, val, v))
+            return false;
+        out = float(v);
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, float value) { return JS_NewFloat64(ctx, value); }
+};
+
+template<>
+struct QScriptTypeConverter<QByteArray>
+{
+    static const char *typeName() { return "string"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, QByteArray &out)
+    {
+        if (!JS_IsString(val))
+            return false;
+        size_t len = 0;
+        const char *str = JS_ToCStringLen(ctx, &len, val);
+        if (!str)
+            return false;
+        out = QByteArray(str, int(len));
+        JS_FreeCString(ctx, str);
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, const QByteArray &value)
+    {
+        return JS_NewStringLen(ctx, value.constData(), value.size());
+    }
+};
+
+template<>
+struct QScriptTypeConverter<QString>
+{
+    static const char *typeName() { return "string"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, QString &out)
+    {
+        if (!JS_IsString(val))
+            return false;
+        size_t len = 0;
+        const char *str = JS_ToCStringLen(ctx, &len, val);
+        if (!str)
+            return false;
+        out = QString::fromUtf8(str, int(len));
+        JS_FreeCString(ctx, str);
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, const QString &value)
+    {
+        return QScriptTypeConverter<QByteArray>::toJS(ctx, value.toUtf8());
+    }
+};
+
+// 任意类型的参数，原样交给回调
+template<>
+struct QScriptTypeConverter<QScriptValue>
+{
+    static const char *typeName() { return "value"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, QScriptValue &out)
+    {
+        out = QScriptValue(ctx, val, static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx)));
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, const QScriptValue &value)
+    {
+        if (value.isVariant())
+            return QScriptValue::toJSValue(ctx, value.data());
+        return JS_DupValue(ctx, value.rawValue());
+    }
+};
+
+template<>
+struct QScriptTypeConverter<QVariant>
+{
+    static const char *typeName() { return "value"; }
+    static bool fromJS(JSContext *ctx, JSValueConst val, QVariant &out)
+    {
+        out = QScriptValue(ctx, val, static_cast<QScriptEngine*>(JS_GetContextOpaque(ctx))).toVariant();
+        return true;
+    }
+    static JSValue toJS(JSContext *ctx, const QVariant &value)
+    {
+        return QScriptValue::toJSValue(ctx, value);
+    }
+};
+
+// 原生函数的入口，由 QScriptEngine::newFunction(R (*)(Args...)) 注册
+template<typename R, typename... Args>
+struct QScriptTypedFunction
+{
+    typedef R (*Function)(Args...);
+
+    static JSValue call(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic, JSValueConst *func_data);
+
+private:
+    template<std::size_t... I>
+    static JSValue invoke(JSContext *ctx, Function function, JSValueConst *argv, std::index_sequence<I...>)
+    {
+        Q_UNUSED(argv); // 没有参数的函数用不到
+        std::tuple<std::decay_t<Args>...> args;
+
+        // 按顺序转换，遇到第一个不匹配的参数就停止
+        int failed = -1;
+        bool ok = ((QScriptTypeConverter<std::decay_t<Args>>::fromJS(ctx, argv[I], std::get<I>(args))
+                    || (failed = int(I), false)) && ...);
+        if (!ok)
+        {
+            // 转换过程中可能已经抛出了异常（例如内存不足）
+            if (!JS_HasException(ctx))
+            {
+                const char *names[] = { QScriptTypeConverter<std::decay_t<Args>>::typeName()..., nullptr };
+                JS_ThrowTypeError(ctx, "argument %d is not a %s", failed + 1, names[failed]);
+            }
+            return JS_EXCEPTION;
+        }
+
+        if constexpr (std::is_void_v<R>)
+        {
+            function(std::get<I>(args)...);
+            return JS_UNDEFINED;
+        }
+        else
+        {
+            return QScriptTypeConverter<std::decay_t<R>>::toJS(ctx, function(std::get<I>(args)...));
+        }
+    }
+};
+
+template<typename... Columns>
+QScriptValueList QScriptValue::callBatch(const QScriptValue &thisObject, QList<bool> *failed, const std::vector<Columns> &... columns)
+{
+    static_assert(sizeof...(Columns) > 0, "callBatch needs at least one argument column");
+
+    const size_t rowCount = std::min({ columns.size()... });
+    return callBatchImpl(thisObject, int(rowCount), int(sizeof...(Columns)),
+                         [&](JSContext *ctx, int row, JSValue *argv) {
+                             int i = 0;
+                             ((argv[i++] = QScriptTypeConverter<Columns>::toJS(ctx, columns[row])), ...);
+                         },
+                         failed);
+}
+
+#endif // QSCRIPTENGINE_QSCRIPTTYPEDFUNCTION_H
@@ -7,11 +7,18 @@
 #include <QDateTime>
 #include <QObject>
 
+#include <functional>
+#include <vector>
+
 extern "C" {
 #include "quickjs.h"
 }
 
 class QScriptEngine;
+class QScriptValue;
+class QScriptClass;
+
+typedef QList<QScriptValue> QScriptValueList;
 
 class QScriptValue
 {
@@ -81,6 +88,11 @@ public:
     bool isQMetaObject() const;
     bool isQObject() const;
 
+    // QScriptEngine::newObject(scriptClass, data) 创建的对象所属的类，其它值返回 nullptr
+    QScriptClass *scriptClass() const;
+    // 创建时传入的 data（QtScript 中的 data()，这里 data() 已经用于 QVariant）
+    QScriptValue scriptClassData() const;
+
     QScriptValue property(const QString &name) const;
     QScriptValue property(quint32 arrayIndex) const;
     QScriptValue prototype() const;
@@ -98,6 +110,30 @@ public:
 
     void setPrototype(const QScriptValue &prototype);
 
+    // 调用函数，与 evaluate() 一样通知agent、响应中断并执行Promise任务
+    // 出错时返回异常，engine()->hasUncaughtException() 为true
+    QScriptValue call(const QScriptValue &thisObject = QScriptValue(),
+                      const QScriptValueList &args = QScriptValueList());
+    // arguments 为数组或者类数组对象
+    QScriptValue call(const QScriptValue &thisObject, const QScriptValue &arguments);
+    QScriptValue callAsConstructor(const QScriptValueList &args = QScriptValueList());
+    QScriptValue callAsConstructor(const QScriptValue &arguments);
+
+    // 快速路径：直接使用调用者的参数数组，不构造临时的 QScriptValueList
+    QScriptValue call(const QScriptValue &thisObject, const QScriptValue *args, int argc);
+    QScriptValue callAsConstructor(const QScriptValue *args, int argc);
+
+    // 批量调用：用多组参数依次调用同一个函数
+    // 整批只加一次锁，参数批量转换并复用同一个参数缓冲区
+    // 返回每次调用的结果；调用抛出异常时结果为异常值，failed（如果提供）中对应的位置为true
+    // 被 abortEvaluation() 打断时剩下的参数不再调用，返回的结果会比参数少
+    QScriptValueList callBatch(const QScriptValue &thisObject, const QList<QVariantList> &argumentRows, QList<bool> *failed = nullptr);
+    // column 中的每个元素作为唯一的参数调用一次
+    QScriptValueList callBatch(const QScriptValue &thisObject, const QVariantList &column, QList<bool> *failed = nullptr);
+    // 类型化的参数列，每一列对应一个参数，行数取最短的一列，类型转换见 QScriptTypeConverter
+    template<typename... Columns>
+    QScriptValueList callBatch(const QScriptValue &thisObject, QList<bool> *failed, const std::vector<Columns> &... columns);
+
     bool strictlyEquals(const QScriptValue &other) const;
 
     bool toBool() const;
@@ -114,6 +150,15 @@ public:
      /* 以下函数仅供内部使用*/
     JSValue rawValue() const { return m_value; }
     static JSValue toJSValue(JSContext *ctx, QVariant var);
+    // 参数直接是 JSValue 时使用，不做任何转换和引用计数
+    QScriptValue call(const QScriptValue &thisObject, const JSValueConst *argv, int argc);
+    QScriptValue callAsConstructor(const JSValueConst *argv, int argc);
+
+private:
+    // fillArguments 把第row行的参数写入argv，写入的是新的引用，调用后由引擎释放
+    typedef std::function<void(JSContext *ctx, int row, JSValue *argv)> BatchArgumentFiller;
+    QScriptValueList callBatchImpl(const QScriptValue &thisObject, int rowCount, int argc,
+                                   const BatchArgumentFiller &fillArguments, QList<bool> *failed);
 
 private:
     JSContext *m_ctx{nullptr};
@@ -131,4 +176,7 @@ Q_DECLARE_OPERATORS_FOR_FLAGS(QScriptValue::PropertyFlags)
 // 模块注册的时候会用到
 Q_DECLARE_METATYPE(QScriptValue)
 
+// callBatch 模板的定义以及它用到的 QScriptTypeConverter
+#include <QScriptTypedFunction>
+
 #endif // QSCRIPTENGINE_QSCRIPTVALUE_H
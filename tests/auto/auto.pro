@@ -0,0 +1,20 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    call \
+    callbatch \
+    enginepool \
+    evaluateasync \
+    jobqueue \
+    limits \
+    nativefunctions \
+    nativeprofiling \
+    qobjectmethods \
+    qobjectproperties \
+    resources \
+    scriptclass \
+    siblings \
+    signals \
+    timers \
+    typedfunctions \
+    wrappercache
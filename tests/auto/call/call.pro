@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_call
+SOURCES += tst_call.cpp
@@ -0,0 +1,196 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptEngineAgent>
+#include <QScriptValue>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+// QScriptValue::call/callAsConstructor
+class tst_Call : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void argumentList();
+    void arrayLikeArguments();
+    void variantThis();
+    void variantArgumentsFreed();
+    void constructor();
+    void notAConstructor_data();
+    void notAConstructor();
+    void agentNotified();
+};
+
+// 只记录宿主发起的调用（scriptId 为-1）
+class CallAgent : public QScriptEngineAgent
+{
+public:
+    explicit CallAgent(QScriptEngine *engine) : QScriptEngineAgent(engine) {}
+
+    void functionEntry(qint64 scriptId) override
+    {
+        if (scriptId == -1)
+            ++entries;
+    }
+    void functionExit(qint64 scriptId, const QScriptValue &returnValue) override
+    {
+        if (scriptId == -1)
+            exits << returnValue.toString();
+    }
+
+    int entries{0};
+    QStringList exits;
+};
+
+static QString uncaughtName(QScriptEngine &engine)
+{
+    if (!engine.hasUncaughtException())
+        return QString();
+    return engine.uncaughtException().property(QStringLiteral("name")).toString();
+}
+
+void tst_Call::argumentList()
+{
+    QScriptEngine engine;
+    QScriptValue join = engine.evaluate(QStringLiteral("(function () { return Array.prototype.join.call(arguments, '|'); })"));
+
+    QScriptValue object = engine.evaluate(QStringLiteral("({ toString: function () { return 'obj'; } })"));
+    QScriptValueList args;
+    args << QScriptValue(1) << QScriptValue(QStringLiteral("two")) << object << QScriptValue(true);
+    QCOMPARE(join.call(QScriptValue(), args).toString(), QStringLiteral("1|two|obj|true"));
+
+    const QScriptValue array[] = { QScriptValue(3), QScriptValue(4) };
+    QCOMPARE(join.call(QScriptValue(), array, 2).toString(), QStringLiteral("3|4"));
+
+    QCOMPARE(join.call().toString(), QString());
+}
+
+// arguments 为类数组对象时展开为参数，其它值没有参数
+void tst_Call::arrayLikeArguments()
+{
+    QScriptEngine engine;
+    QScriptValue join = engine.evaluate(QStringLiteral("(function () { return arguments.length + ':' + Array.prototype.join.call(arguments, '|'); })"));
+
+    QCOMPARE(join.call(QScriptValue(), engine.evaluate(QStringLiteral("['a', 'b', 'c']"))).toString(),
+             QStringLiteral("3:a|b|c"));
+    QCOMPARE(join.call(QScriptValue(), engine.evaluate(QStringLiteral("({ length: 2, 0: 'x', 1: 'y' })"))).toString(),
+             QStringLiteral("2:x|y"));
+    QCOMPARE(join.call(QScriptValue(), engine.evaluate(QStringLiteral("42"))).toString(),
+             QStringLiteral("0:"));
+
+    QScriptValue make = engine.evaluate(QStringLiteral("(function (a, b) { this.sum = a + b; })"));
+    QScriptValue made = make.callAsConstructor(engine.evaluate(QStringLiteral("[40, 2]")));
+    QCOMPARE(made.property(QStringLiteral("sum")).toInt32(), 42);
+}
+
+// 普通值（variant）的 this 转换为JS值
+void tst_Call::variantThis()
+{
+    QScriptEngine engine;
+    QScriptValue describe = engine.evaluate(QStringLiteral("(function () { 'use strict'; return typeof this + ':' + this; })"));
+
+    QCOMPARE(describe.call(QScriptValue(42)).toString(), QStringLiteral("number:42"));
+    QCOMPARE(describe.call(QScriptValue(QStringLiteral("s"))).toString(), QStringLiteral("string:s"));
+    QCOMPARE(describe.call(QScriptValue(true)).toString(), QStringLiteral("boolean:true"));
+}
+
+// 参数和 this 为 variant 时临时转换出来的JS值在调用后释放
+void tst_Call::variantArgumentsFreed()
+{
+    QScriptEngine engine;
+    QScriptValue length = engine.evaluate(QStringLiteral("(function (s) { return s.length + this.length; })"));
+
+    auto callMany = [&]() {
+        for (int i = 0; i < 10000; ++i)
+        {
+            const QString text = QStringLiteral("argument string number %1").arg(i);
+            length.call(QScriptValue(text), QScriptValueList() << QScriptValue(text));
+        }
+        engine.collectGarbage();
+    };
+
+    // 第一轮让内部的缓存、形状等达到稳定
+    callMany();
+    JSMemoryUsage before;
+    JS_ComputeMemoryUsage(engine.runtime(), &before);
+
+    callMany();
+    JSMemoryUsage after;
+    JS_ComputeMemoryUsage(engine.runtime(), &after);
+
+    QVERIFY2(after.str_count - before.str_count < 100,
+             qPrintable(QStringLiteral("%1 strings leaked").arg(after.str_count - before.str_count)));
+    QVERIFY(after.malloc_size - before.malloc_size < 64 * 1024);
+}
+
+void tst_Call::constructor()
+{
+    QScriptEngine engine;
+    QScriptValue point = engine.evaluate(QStringLiteral("(class { constructor(x, y) { this.x = x; this.y = y; } })"));
+
+    QScriptValue p = point.callAsConstructor(QScriptValueList() << QScriptValue(1) << QScriptValue(2));
+    QVERIFY(!engine.hasUncaughtException());
+    QCOMPARE(p.property(QStringLiteral("x")).toInt32(), 1);
+    QCOMPARE(p.property(QStringLiteral("y")).toInt32(), 2);
+    QVERIFY(engine.evaluate(QStringLiteral("(function (C, p) { return p instanceof C; })"))
+                .call(QScriptValue(), QScriptValueList() << point << p).toBool());
+
+    // class 不能不带 new 调用
+    point.call();
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+void tst_Call::notAConstructor_data()
+{
+    QTest::addColumn<QString>("function");
+
+    QTest::newRow("arrow")   << QStringLiteral("(() => 1)");
+    QTest::newRow("method")  << QStringLiteral("({ m() { return 1; } }).m");
+    QTest::newRow("builtin") << QStringLiteral("Math.max");
+    QTest::newRow("async")   << QStringLiteral("(async function () {})");
+}
+
+// 和脚本里 new 一样抛 TypeError，而不是把函数当作普通函数调用
+void tst_Call::notAConstructor()
+{
+    QFETCH(QString, function);
+
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(function);
+    QVERIFY(f.isFunction());
+
+    f.callAsConstructor();
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+
+    const QScriptValue args[] = { QScriptValue(1) };
+    f.callAsConstructor(args, 1);
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+// 宿主发起的每次调用都通知agent进入和退出，包括抛出异常的调用
+void tst_Call::agentNotified()
+{
+    QScriptEngine engine;
+    // 脚本函数内部的进入、退出由逐指令回调按脚本的scriptId通知，不会和 -1 混在一起
+    QScriptValue twice = engine.evaluate(QStringLiteral("(function twice(x) { return x * 2; })"), QStringLiteral("call.js"));
+    QScriptValue arrow = engine.evaluate(QStringLiteral("(() => 1)"), QStringLiteral("call.js"));
+
+    CallAgent agent(&engine);
+    engine.setAgent(&agent);
+
+    twice.call(QScriptValue(), QScriptValueList() << QScriptValue(21));
+    twice.callAsConstructor(QScriptValueList() << QScriptValue(1));
+    arrow.callAsConstructor();
+    engine.setAgent(nullptr);
+
+    QCOMPARE(agent.entries, 3);
+    QCOMPARE(agent.exits.size(), 3);
+    QCOMPARE(agent.exits.first(), QStringLiteral("42"));
+}
+
+QTEST_GUILESS_MAIN(tst_Call)
+
+#include "tst_call.moc"
@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_callbatch
+SOURCES += tst_callbatch.cpp
@@ -0,0 +1,215 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptEngineAgent>
+#include <QScriptContext>
+#include <QScriptValue>
+
+// QScriptValue::callBatch
+class tst_CallBatch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void results();
+    void failedFlags();
+    void shortRowsPadded();
+    void column();
+    void typedColumnsShortest();
+    void notAFunction();
+    void abortTruncates();
+    void jobsDrainedAfterBatch();
+    void agentNotifiedOncePerBatch();
+};
+
+// 只记录宿主发起的调用（scriptId 为-1）
+class BatchAgent : public QScriptEngineAgent
+{
+public:
+    explicit BatchAgent(QScriptEngine *engine) : QScriptEngineAgent(engine) {}
+
+    void functionEntry(qint64 scriptId) override
+    {
+        if (scriptId == -1)
+            ++entries;
+    }
+    void functionExit(qint64 scriptId, const QScriptValue &returnValue) override
+    {
+        Q_UNUSED(returnValue);
+        if (scriptId == -1)
+            ++exits;
+    }
+
+    int entries{0};
+    int exits{0};
+};
+
+static QStringList toStrings(const QScriptValueList &values)
+{
+    QStringList strings;
+    for (const QScriptValue &value : values)
+        strings << value.toString();
+    return strings;
+}
+
+void tst_CallBatch::results()
+{
+    QScriptEngine engine;
+    QScriptValue add = engine.evaluate(QStringLiteral("(function (a, b) { return this.base + a + b; })"));
+    QScriptValue self = engine.evaluate(QStringLiteral("({ base: 100 })"));
+
+    QList<QVariantList> rows;
+    rows << (QVariantList() << 1 << 2) << (QVariantList() << 3 << 4) << (QVariantList() << 5 << 6);
+
+    QList<bool> failed;
+    QScriptValueList results = add.callBatch(self, rows, &failed);
+    QCOMPARE(toStrings(results), QStringList() << "103" << "107" << "111");
+    QCOMPARE(failed, QList<bool>() << false << false << false);
+    QVERIFY(!engine.hasUncaughtException());
+}
+
+// 抛出异常的行结果为异常值，其余行照常调用
+void tst_CallBatch::failedFlags()
+{
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(QStringLiteral(
+        "(function (x) { if (x % 2) throw new RangeError('odd ' + x); return x; })"));
+
+    QList<bool> failed;
+    QScriptValueList results = f.callBatch(QScriptValue(), QVariantList() << 0 << 1 << 2 << 3, &failed);
+    QCOMPARE(results.size(), 4);
+    QCOMPARE(failed, QList<bool>() << false << true << false << true);
+    QCOMPARE(results.at(0).toInt32(), 0);
+    QVERIFY(results.at(1).isError());
+    QCOMPARE(results.at(1).property(QStringLiteral("message")).toString(), QStringLiteral("odd 1"));
+    QCOMPARE(results.at(2).toInt32(), 2);
+    QVERIFY(results.at(3).isError());
+
+    // failed 中追加而不是覆盖
+    f.callBatch(QScriptValue(), QVariantList() << 5, &failed);
+    QCOMPARE(failed.size(), 5);
+    QCOMPARE(failed.last(), true);
+}
+
+// 参数个数取最长的一行，较短的行用 undefined 补齐
+void tst_CallBatch::shortRowsPadded()
+{
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(QStringLiteral(
+        "(function (a, b, c) { return arguments.length + ':' + [a, b, c].map(function (v) { return typeof v; }).join(','); })"));
+
+    QList<QVariantList> rows;
+    rows << (QVariantList() << 1 << QStringLiteral("s") << true)
+         << (QVariantList() << 2)
+         << QVariantList();
+
+    QScriptValueList results = f.callBatch(QScriptValue(), rows);
+    QCOMPARE(toStrings(results), QStringList()
+                                     << "3:number,string,boolean"
+                                     << "3:number,undefined,undefined"
+                                     << "3:undefined,undefined,undefined");
+}
+
+void tst_CallBatch::column()
+{
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(QStringLiteral("(function () { return arguments.length + ':' + arguments[0]; })"));
+
+    QScriptValueList results = f.callBatch(QScriptValue(), QVariantList() << 7 << QStringLiteral("x") << 2.5);
+    QCOMPARE(toStrings(results), QStringList() << "1:7" << "1:x" << "1:2.5");
+
+    QVERIFY(f.callBatch(QScriptValue(), QVariantList()).isEmpty());
+}
+
+// 行数取最短的一列
+void tst_CallBatch::typedColumnsShortest()
+{
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(QStringLiteral(
+        "(function (n, s, d) { return typeof n + ':' + n + s + d; })"));
+
+    QList<bool> failed;
+    QScriptValueList results = f.callBatch(QScriptValue(), &failed,
+                                           std::vector<int>{1, 2, 3, 4},
+                                           std::vector<QString>{QStringLiteral("a"), QStringLiteral("b")},
+                                           std::vector<double>{0.5, 1.5, 2.5});
+    QCOMPARE(toStrings(results), QStringList() << "number:1a0.5" << "number:2b1.5");
+    QCOMPARE(failed, QList<bool>() << false << false);
+
+    QVERIFY(f.callBatch(QScriptValue(), nullptr, std::vector<int>{1, 2}, std::vector<int>()).isEmpty());
+}
+
+void tst_CallBatch::notAFunction()
+{
+    QScriptEngine engine;
+    QScriptValue object = engine.evaluate(QStringLiteral("({})"));
+
+    QList<bool> failed;
+    QVERIFY(object.callBatch(QScriptValue(), QVariantList() << 1 << 2, &failed).isEmpty());
+    QVERIFY(failed.isEmpty());
+}
+
+static QScriptValue abortNative(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(context);
+    engine->abortEvaluation();
+    return QScriptValue();
+}
+
+// 回调中途 abortEvaluation() 后剩下的行不再调用，返回的结果比参数少
+void tst_CallBatch::abortTruncates()
+{
+    QScriptEngine engine;
+    engine.globalObject().setProperty(QStringLiteral("abort"), engine.newFunction(abortNative));
+    QScriptValue f = engine.evaluate(QStringLiteral(
+        "var calls = 0; (function (x) { ++calls; if (x === 5) abort(); return x * 2; })"));
+
+    QVariantList column;
+    for (int i = 0; i < 10; ++i)
+        column << i;
+
+    QList<bool> failed;
+    QScriptValueList results = f.callBatch(QScriptValue(), column, &failed);
+    // 第5行本身可能恰好被轮询到的中断打断，也可能正常返回
+    QVERIFY2(results.size() == 5 || results.size() == 6, qPrintable(QString::number(results.size())));
+    QCOMPARE(failed.size(), results.size());
+    QCOMPARE(results.at(4).toInt32(), 8);
+    QCOMPARE(engine.evaluate(QStringLiteral("calls")).toInt32(), 6);
+
+    // 下一批重新开始
+    results = f.callBatch(QScriptValue(), QVariantList() << 1 << 2);
+    QCOMPARE(toStrings(results), QStringList() << "2" << "4");
+}
+
+// Promise 任务在整批结束后执行一次
+void tst_CallBatch::jobsDrainedAfterBatch()
+{
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(QStringLiteral(
+        "var order = [];"
+        "(function (x) { Promise.resolve(x).then(function (v) { order.push('job' + v); }); order.push('call' + x); })"));
+
+    f.callBatch(QScriptValue(), QVariantList() << 1 << 2 << 3);
+    QCOMPARE(engine.evaluate(QStringLiteral("order.join()")).toString(),
+             QStringLiteral("call1,call2,call3,job1,job2,job3"));
+}
+
+// 整批调用对agent来说是一次函数调用
+void tst_CallBatch::agentNotifiedOncePerBatch()
+{
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(QStringLiteral("(function (x) { if (x) throw x; })"), QStringLiteral("callbatch.js"));
+
+    BatchAgent agent(&engine);
+    engine.setAgent(&agent);
+    f.callBatch(QScriptValue(), QVariantList() << 0 << 1 << 0 << 1);
+    f.callBatch(QScriptValue(), nullptr, std::vector<int>{0, 0});
+    engine.setAgent(nullptr);
+
+    QCOMPARE(agent.entries, 2);
+    QCOMPARE(agent.exits, 2);
+}
+
+QTEST_GUILESS_MAIN(tst_CallBatch)
+
+#include "tst_callbatch.moc"
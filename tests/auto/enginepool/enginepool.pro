@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_enginepool
+SOURCES += tst_enginepool.cpp
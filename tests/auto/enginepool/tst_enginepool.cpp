@@ -0,0 +1,221 @@
+﻿#include <QtTest>
+#include <QThread>
+
+#include <atomic>
+
+#include <QScriptEngine>
+#include <QScriptEnginePool>
+#include <QScriptValue>
+#include <QScriptContext>
+
+class tst_EnginePool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void acquireRelease();
+    void restoreGlobalObject();
+    void restoreDoesNotCoverBuiltins();
+    void recreateEngine();
+    void timersDoNotSurviveRelease();
+    void acquireTimeout();
+    void releaseForeignEngine();
+    void concurrentAcquire();
+};
+
+static std::atomic<int> s_hits{0};
+
+static QScriptValue hit(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(context);
+    Q_UNUSED(engine);
+    ++s_hits;
+    return QScriptValue();
+}
+
+static void setup(QScriptEngine *engine)
+{
+    engine->globalObject().setProperty(QStringLiteral("hostValue"), QScriptValue(42));
+    engine->globalObject().setProperty(QStringLiteral("hit"), engine->newFunction(hit, 0, QStringLiteral("hit")));
+}
+
+void tst_EnginePool::acquireRelease()
+{
+    QScriptEnginePool pool(2, setup);
+    QCOMPARE(pool.size(), 2);
+    QCOMPARE(pool.availableCount(), 2);
+
+    QScriptEngine *a = pool.acquire();
+    QScriptEngine *b = pool.acquire();
+    QVERIFY(a && b && a != b);
+    QCOMPARE(pool.availableCount(), 0);
+    QCOMPARE(a->thread(), QThread::currentThread());
+    QCOMPARE(a->evaluate(QStringLiteral("hostValue")).toInt32(), 42);
+
+    pool.release(a);
+    pool.release(b);
+    QCOMPARE(pool.availableCount(), 2);
+
+    const QScriptEnginePool::Statistics stats = pool.statistics();
+    QCOMPARE(stats.acquireCount, qint64(2));
+    QCOMPARE(stats.reuseCount, qint64(0));
+    QCOMPARE(stats.resetCount, qint64(2));
+}
+
+// 归还时全局对象恢复到 setup 之后的状态：新增的删掉，改写和删除的恢复
+void tst_EnginePool::restoreGlobalObject()
+{
+    QScriptEnginePool pool(1, setup);
+
+    QScriptEngine *engine = pool.acquire();
+    engine->evaluate(QStringLiteral("var leaked = 1; hostValue = 0; delete JSON; globalThis.extra = {};"));
+    QVERIFY(!engine->hasUncaughtException());
+    pool.release(engine);
+
+    QScriptEngine *again = pool.acquire();
+    QCOMPARE(again, engine);
+    QCOMPARE(again->evaluate(QStringLiteral("typeof leaked + ',' + typeof extra")).toString(),
+             QStringLiteral("undefined,undefined"));
+    QCOMPARE(again->evaluate(QStringLiteral("hostValue")).toInt32(), 42);
+    QCOMPARE(again->evaluate(QStringLiteral("JSON.stringify([1])")).toString(), QStringLiteral("[1]"));
+    pool.release(again);
+
+    QCOMPARE(pool.statistics().reuseCount, qint64(1));
+}
+
+// 已知的限制：对内置对象的修改留给下一个使用者（见 QScriptEnginePool.h），需要隔离时用 RecreateEngine
+void tst_EnginePool::restoreDoesNotCoverBuiltins()
+{
+    QScriptEnginePool pool(1, setup);
+
+    QScriptEngine *engine = pool.acquire();
+    engine->evaluate(QStringLiteral("Array.prototype.leakedMethod = function () { return 1; };"));
+    pool.release(engine);
+
+    engine = pool.acquire();
+    QCOMPARE(engine->evaluate(QStringLiteral("typeof [].leakedMethod")).toString(), QStringLiteral("function"));
+    pool.release(engine);
+}
+
+void tst_EnginePool::recreateEngine()
+{
+    QScriptEnginePool pool(1, setup, QScriptEnginePool::RecreateEngine);
+    QCOMPARE(pool.resetMode(), QScriptEnginePool::RecreateEngine);
+
+    QScriptEngine *engine = pool.acquire();
+    engine->evaluate(QStringLiteral("Array.prototype.leakedMethod = function () { return 1; }; hostValue = 0;"));
+    pool.release(engine);
+    QCOMPARE(pool.availableCount(), 1);
+
+    engine = pool.acquire();
+    QCOMPARE(engine->evaluate(QStringLiteral("typeof [].leakedMethod")).toString(), QStringLiteral("undefined"));
+    // setup 重新执行过
+    QCOMPARE(engine->evaluate(QStringLiteral("hostValue")).toInt32(), 42);
+    pool.release(engine);
+}
+
+// 上一个使用者的定时器不会在下一个使用者那里触发
+void tst_EnginePool::timersDoNotSurviveRelease()
+{
+    QScriptEnginePool pool(1, setup);
+    s_hits = 0;
+
+    QScriptEngine *engine = pool.acquire();
+    engine->evaluate(QStringLiteral("setTimeout(hit, 10); setInterval(hit, 10);"));
+    pool.release(engine);
+
+    engine = pool.acquire();
+    QTest::qWait(100);
+    QCOMPARE(s_hits.load(), 0);
+    pool.release(engine);
+}
+
+void tst_EnginePool::acquireTimeout()
+{
+    QScriptEnginePool pool(1, setup);
+    QScriptEngine *engine = pool.acquire();
+
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(pool.acquire(50) == nullptr);
+    QVERIFY(timer.elapsed() >= 40);
+
+    // 另一个线程归还后，等待中的 acquire() 取到引擎
+    QScriptEngine *acquired = nullptr;
+    QThread *waiter = QThread::create([&pool, &acquired]() {
+        acquired = pool.acquire(5000);
+        if (acquired)
+            pool.release(acquired);
+    });
+    waiter->start();
+    QTest::qWait(50);
+    pool.release(engine);
+    QVERIFY(waiter->wait(5000));
+    delete waiter;
+
+    QCOMPARE(acquired, engine);
+    QCOMPARE(pool.availableCount(), 1);
+}
+
+void tst_EnginePool::releaseForeignEngine()
+{
+    QScriptEnginePool pool(1, setup);
+    QScriptEngine foreign;
+
+    QTest::ignoreMessage(QtWarningMsg, "QScriptEnginePool: releasing an engine that does not belong to this pool");
+    pool.release(&foreign);
+    QCOMPARE(pool.availableCount(), 1);
+}
+
+// 多个线程争用少量引擎，每个线程取到的引擎都是干净的，并在自己的线程中运行
+void tst_EnginePool::concurrentAcquire()
+{
+    QScriptEnginePool pool(2, setup);
+    enum { ThreadCount = 8, Iterations = 50 };
+
+    std::atomic<int> failures{0};
+    QList<QThread*> threads;
+    for (int t = 0; t < ThreadCount; ++t)
+    {
+        threads << QThread::create([&pool, &failures, t]() {
+            for (int i = 0; i < Iterations; ++i)
+            {
+                QScriptEngine *engine = pool.acquire(10000);
+                if (!engine)
+                {
+                    ++failures;
+                    continue;
+                }
+                if (engine->thread() != QThread::currentThread())
+                {
+                    ++failures;
+                }
+
+                QScriptValue result = engine->evaluate(QStringLiteral(
+                    "var fresh = typeof mine === 'undefined'; var mine = %1; fresh ? mine + hostValue : -1").arg(t));
+                if (result.toInt32() != t + 42)
+                {
+                    ++failures;
+                }
+                pool.release(engine);
+            }
+        });
+    }
+    for (QThread *thread : qAsConst(threads))
+    {
+        thread->start();
+    }
+    for (QThread *thread : qAsConst(threads))
+    {
+        QVERIFY(thread->wait(60000));
+    }
+    qDeleteAll(threads);
+
+    QCOMPARE(failures.load(), 0);
+    QCOMPARE(pool.availableCount(), 2);
+    QCOMPARE(pool.statistics().acquireCount, qint64(ThreadCount * Iterations));
+}
+
+QTEST_GUILESS_MAIN(tst_EnginePool)
+
+#include "tst_enginepool.moc"
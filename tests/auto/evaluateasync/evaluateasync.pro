@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_evaluateasync
+SOURCES += tst_evaluateasync.cpp
@@ -0,0 +1,121 @@
+﻿#include <QtTest>
+#include <QThread>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+class tst_EvaluateAsync : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void result();
+    void promiseResult();
+    void promiseResolvedByHostEvaluate();
+    void promiseResolvedByHostCall();
+    void destroyWhileRunning();
+    void destroyWithQueuedJobs();
+    void wrongThread();
+};
+
+void tst_EvaluateAsync::result()
+{
+    QScriptEngine engine;
+    QFuture<QScriptValue> future = engine.evaluateAsync(QStringLiteral("1 + 2"));
+    QCOMPARE(future.result().toInt32(), 3);
+}
+
+// 结果为Promise时，等Promise完成后才结束
+void tst_EvaluateAsync::promiseResult()
+{
+    QScriptEngine engine;
+    QFuture<QScriptValue> future = engine.evaluateAsync(QStringLiteral("(async function () { return 42; })()"));
+    QCOMPARE(future.result().toInt32(), 42);
+}
+
+// 异步脚本返回的Promise由引擎线程中的 evaluate() 直接resolve（没有任何Promise任务执行）
+void tst_EvaluateAsync::promiseResolvedByHostEvaluate()
+{
+    QScriptEngine engine;
+    QFuture<QScriptValue> future = engine.evaluateAsync(QStringLiteral(
+        "new Promise(function (resolve) { resolveLater = resolve; })"));
+
+    // evaluate() 会等工作线程执行完当前任务
+    QTRY_VERIFY(engine.evaluate(QStringLiteral("typeof resolveLater === 'function'")).toBool());
+    QVERIFY(!future.isFinished());
+
+    engine.evaluate(QStringLiteral("resolveLater(7)"));
+    QTRY_VERIFY(future.isFinished());
+    QCOMPARE(future.result().toInt32(), 7);
+}
+
+// async函数await的Promise由宿主调用脚本函数resolve，后续的任务在引擎线程中执行
+void tst_EvaluateAsync::promiseResolvedByHostCall()
+{
+    QScriptEngine engine;
+    QFuture<QScriptValue> future = engine.evaluateAsync(QStringLiteral(
+        "(async function () { return await new Promise(function (r) { resolveLater = r; }) + 1; })()"));
+
+    QTRY_VERIFY(engine.evaluate(QStringLiteral("typeof resolveLater === 'function'")).toBool());
+
+    QScriptValue resolve = engine.globalObject().property(QStringLiteral("resolveLater"));
+    resolve.call(QScriptValue(), QScriptValueList() << QScriptValue(41));
+    QTRY_VERIFY(future.isFinished());
+    QCOMPARE(future.result().toInt32(), 42);
+}
+
+// 工作线程正在执行死循环时析构引擎，脚本被打断，析构不会卡在等待工作线程上
+void tst_EvaluateAsync::destroyWhileRunning()
+{
+    QScriptEngine *engine = new QScriptEngine;
+    QFuture<QScriptValue> future = engine->evaluateAsync(QStringLiteral("for (;;) {}"));
+    QTest::qWait(50);
+
+    QElapsedTimer timer;
+    timer.start();
+    delete engine;
+    QVERIFY2(timer.elapsed() < 5000, "destroying the engine waited for the endless script");
+    QVERIFY(future.isFinished());
+}
+
+// 工作线程刚取出、还没开始执行的任务也要能被打断；排队中的任务被取消
+void tst_EvaluateAsync::destroyWithQueuedJobs()
+{
+    for (int round = 0; round < 20; ++round)
+    {
+        QScriptEngine *engine = new QScriptEngine;
+        QList<QFuture<QScriptValue>> futures;
+        for (int i = 0; i < 10; ++i)
+        {
+            futures.append(engine->evaluateAsync(QStringLiteral("for (;;) {}")));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        delete engine;
+        QVERIFY2(timer.elapsed() < 5000, "destroying the engine waited for a dequeued job");
+        for (const QFuture<QScriptValue> &future : futures)
+        {
+            QVERIFY(future.isFinished());
+        }
+    }
+}
+
+// 只能在引擎所属的线程中提交任务
+void tst_EvaluateAsync::wrongThread()
+{
+    QScriptEngine engine;
+    QFuture<QScriptValue> future;
+    QThread *thread = QThread::create([&engine, &future]() {
+        future = engine.evaluateAsync(QStringLiteral("1"));
+    });
+    thread->start();
+    QVERIFY(thread->wait(5000));
+    delete thread;
+
+    QVERIFY(future.isCanceled());
+}
+
+QTEST_GUILESS_MAIN(tst_EvaluateAsync)
+
+#include "tst_evaluateasync.moc"
@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_jobqueue
+SOURCES += tst_jobqueue.cpp
@@ -0,0 +1,69 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+class tst_JobQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void drainedBeforeEvaluateReturns();
+    void batchDeferredToEventLoop();
+    void unlimitedBatch();
+};
+
+static int globalInt(QScriptEngine &engine, const char *name)
+{
+    // 不用 evaluate() 读取：它返回前也会执行一批任务
+    return engine.globalObject().property(QString::fromLatin1(name)).toInt32();
+}
+
+void tst_JobQueue::drainedBeforeEvaluateReturns()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var done = 0;"
+        "(async function () { await null; await null; done = 1; })();"));
+    QCOMPARE(globalInt(engine, "done"), 1);
+}
+
+// 超出批次大小的任务投递到事件循环中继续执行
+void tst_JobQueue::batchDeferredToEventLoop()
+{
+    QScriptEngine engine;
+    engine.setJobBatchSize(10);
+    engine.setJobTimeBudget(0);
+
+    engine.evaluate(QStringLiteral(
+        "var done = 0;"
+        "for (var i = 0; i < 100; ++i) Promise.resolve().then(function () { ++done; });"));
+    QCOMPARE(globalInt(engine, "done"), 10);
+
+    QScriptEngine::JobStatistics stats = engine.jobStatistics();
+    QCOMPARE(stats.jobsExecuted, qint64(10));
+    QCOMPARE(stats.deferredCount, qint64(1));
+
+    QTRY_COMPARE(globalInt(engine, "done"), 100);
+    stats = engine.jobStatistics();
+    QCOMPARE(stats.jobsExecuted, qint64(100));
+    QCOMPARE(stats.batchCount, qint64(10));
+}
+
+void tst_JobQueue::unlimitedBatch()
+{
+    QScriptEngine engine;
+    engine.setJobBatchSize(0);
+    engine.setJobTimeBudget(0);
+
+    engine.evaluate(QStringLiteral(
+        "var done = 0;"
+        "for (var i = 0; i < 5000; ++i) Promise.resolve().then(function () { ++done; });"));
+    QCOMPARE(globalInt(engine, "done"), 5000);
+    QCOMPARE(engine.jobStatistics().deferredCount, qint64(0));
+    QCOMPARE(engine.processPendingJobs(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_JobQueue)
+
+#include "tst_jobqueue.moc"
@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_limits
+SOURCES += tst_limits.cpp
@@ -0,0 +1,149 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+class tst_Limits : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void exceeded_data();
+    void exceeded();
+    void perEvaluationLimits();
+    void notExceeded();
+    void uncatchable();
+    void promiseJobsCountTowardsScript();
+    void call();
+};
+
+Q_DECLARE_METATYPE(QScriptEngine::LimitKind)
+
+static const QString s_endless = QStringLiteral("for (;;) {}");
+
+// 执行失败时 evaluate() 的返回值不是错误对象，错误从 uncaughtException() 取（取出后异常被清掉）
+static QString exceededLimit(QScriptEngine &engine)
+{
+    if (!engine.hasUncaughtException())
+        return QString();
+
+    QScriptValue error = engine.uncaughtException();
+    if (error.property(QStringLiteral("name")).toString() != QLatin1String("TimeoutError"))
+        return QString();
+    return error.property(QStringLiteral("limit")).toString();
+}
+
+void tst_Limits::exceeded_data()
+{
+    QTest::addColumn<int>("wallTimeMs");
+    QTest::addColumn<int>("cpuTimeMs");
+    QTest::addColumn<qint64>("instructionLimit");
+    QTest::addColumn<QScriptEngine::LimitKind>("kind");
+    QTest::addColumn<QString>("limit");
+
+    QTest::newRow("wallTime")     << 50 << 0  << qint64(0)      << QScriptEngine::WallTimeLimitExceeded    << QStringLiteral("wallTime");
+    QTest::newRow("cpuTime")      << 0  << 50 << qint64(0)      << QScriptEngine::CpuTimeLimitExceeded     << QStringLiteral("cpuTime");
+    QTest::newRow("instructions") << 0  << 0  << qint64(100000) << QScriptEngine::InstructionLimitExceeded << QStringLiteral("instructions");
+}
+
+void tst_Limits::exceeded()
+{
+    QFETCH(int, wallTimeMs);
+    QFETCH(int, cpuTimeMs);
+    QFETCH(qint64, instructionLimit);
+    QFETCH(QScriptEngine::LimitKind, kind);
+    QFETCH(QString, limit);
+
+    QScriptEngine engine;
+    QScriptEngine::EvaluationLimits limits;
+    limits.wallTimeMs = wallTimeMs;
+    limits.cpuTimeMs = cpuTimeMs;
+    limits.instructionLimit = instructionLimit;
+    engine.setEvaluationLimits(limits);
+
+    QElapsedTimer timer;
+    timer.start();
+    engine.evaluate(s_endless);
+    QVERIFY(timer.elapsed() < 5000);
+
+    QCOMPARE(exceededLimit(engine), limit);
+    QCOMPARE(engine.lastExceededLimit(), kind);
+
+    // 超出限制之后引擎还可以继续使用
+    engine.setEvaluationLimits(QScriptEngine::EvaluationLimits());
+    QCOMPARE(engine.evaluate(QStringLiteral("6 * 7")).toInt32(), 42);
+    QCOMPARE(engine.lastExceededLimit(), QScriptEngine::NoLimitExceeded);
+}
+
+// 只对这一次执行生效，不影响 evaluationLimits()
+void tst_Limits::perEvaluationLimits()
+{
+    QScriptEngine engine;
+    QScriptEngine::EvaluationLimits limits;
+    limits.instructionLimit = 100000;
+
+    engine.evaluate(s_endless, QString(), 1, limits);
+    QCOMPARE(exceededLimit(engine), QStringLiteral("instructions"));
+    QCOMPARE(engine.evaluationLimits().instructionLimit, qint64(0));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("var n = 0; for (var i = 0; i < 1000000; ++i) ++n; n")).toInt32(), 1000000);
+}
+
+void tst_Limits::notExceeded()
+{
+    QScriptEngine engine;
+    QScriptEngine::EvaluationLimits limits;
+    limits.wallTimeMs = 10000;
+    limits.cpuTimeMs = 10000;
+    limits.instructionLimit = 100000000;
+    engine.setEvaluationLimits(limits);
+
+    QCOMPARE(engine.evaluate(QStringLiteral("var n = 0; for (var i = 0; i < 1000; ++i) ++n; n")).toInt32(), 1000);
+    QCOMPARE(exceededLimit(engine), QString());
+    QCOMPARE(engine.lastExceededLimit(), QScriptEngine::NoLimitExceeded);
+}
+
+// 脚本中的 catch 和 finally 拦不住超出限制
+void tst_Limits::uncatchable()
+{
+    QScriptEngine engine;
+    QScriptEngine::EvaluationLimits limits;
+    limits.instructionLimit = 100000;
+    engine.setEvaluationLimits(limits);
+
+    engine.evaluate(QStringLiteral("for (;;) { try { for (;;) {} } catch (e) {} finally { continue; } }"));
+    QCOMPARE(exceededLimit(engine), QStringLiteral("instructions"));
+    QCOMPARE(engine.lastExceededLimit(), QScriptEngine::InstructionLimitExceeded);
+}
+
+// 脚本排下的Promise任务算在脚本自己的限制里
+void tst_Limits::promiseJobsCountTowardsScript()
+{
+    QScriptEngine engine;
+    QScriptEngine::EvaluationLimits limits;
+    limits.instructionLimit = 100000;
+    engine.setEvaluationLimits(limits);
+
+    engine.evaluate(QStringLiteral("Promise.resolve().then(function () { for (;;) {} }); 1"));
+    QCOMPARE(exceededLimit(engine), QStringLiteral("instructions"));
+    QCOMPARE(engine.lastExceededLimit(), QScriptEngine::InstructionLimitExceeded);
+}
+
+// QScriptValue::call() 也是一次最外层的执行
+void tst_Limits::call()
+{
+    QScriptEngine engine;
+    QScriptValue endless = engine.evaluate(QStringLiteral("(function () { for (;;) {} })"));
+
+    QScriptEngine::EvaluationLimits limits;
+    limits.wallTimeMs = 50;
+    engine.setEvaluationLimits(limits);
+
+    endless.call();
+    QCOMPARE(exceededLimit(engine), QStringLiteral("wallTime"));
+    QCOMPARE(engine.lastExceededLimit(), QScriptEngine::WallTimeLimitExceeded);
+}
+
+QTEST_GUILESS_MAIN(tst_Limits)
+
+#include "tst_limits.moc"
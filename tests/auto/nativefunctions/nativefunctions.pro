@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_nativefunctions
+SOURCES += tst_nativefunctions.cpp
@@ -0,0 +1,101 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptContext>
+
+// 原生函数表项在函数被回收后复用，复用的表项不能残留上一个函数的参数
+class tst_NativeFunctions : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void reclaimSoak();
+    void survivorsKeepTheirEntries();
+    void reclaimWithProfiling();
+};
+
+static QScriptValue returnArg(QScriptContext *context, QScriptEngine *engine, void *arg)
+{
+    Q_UNUSED(context);
+    Q_UNUSED(engine);
+    return QScriptValue(int(reinterpret_cast<quintptr>(arg)));
+}
+
+// 反复创建、调用、丢弃函数，每轮GC之后表项被复用；调用结果必须是各自的参数
+void tst_NativeFunctions::reclaimSoak()
+{
+    QScriptEngine engine;
+
+    for (int round = 0; round < 50; ++round)
+    {
+        for (int i = 1; i <= 2000; ++i)
+        {
+            const int id = round * 2000 + i;
+            QScriptValue function = engine.newFunction(returnArg, reinterpret_cast<void *>(quintptr(id)));
+            QScriptValue result = function.call();
+            QCOMPARE(result.toInt32(), id);
+        }
+        engine.collectGarbage();
+    }
+}
+
+// 回收一部分函数后新建的函数复用它们的表项，没有被回收的函数不受影响
+void tst_NativeFunctions::survivorsKeepTheirEntries()
+{
+    QScriptEngine engine;
+    QScriptValue survivors = engine.newArray();
+
+    for (int i = 1; i <= 3000; ++i)
+    {
+        QScriptValue function = engine.newFunction(returnArg, reinterpret_cast<void *>(quintptr(i)));
+        if (i % 3 == 0)
+        {
+            survivors.setProperty(quint32(i / 3 - 1), function);
+        }
+    }
+    engine.collectGarbage();
+
+    for (int i = 1; i <= 2000; ++i)
+    {
+        QScriptValue function = engine.newFunction(returnArg, reinterpret_cast<void *>(quintptr(100000 + i)));
+        QCOMPARE(function.call().toInt32(), 100000 + i);
+    }
+
+    engine.globalObject().setProperty(QStringLiteral("survivors"), survivors);
+    QScriptValue ok = engine.evaluate(QStringLiteral(
+        "var ok = true;"
+        "for (var i = 0; i < survivors.length; ++i) ok = ok && survivors[i]() === (i + 1) * 3;"
+        "ok"));
+    QVERIFY(ok.toBool());
+}
+
+// 统计按名字合并，回收函数不会丢掉已经记录的统计
+void tst_NativeFunctions::reclaimWithProfiling()
+{
+    QScriptEngine engine;
+    engine.setNativeProfilingEnabled(true);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        QScriptValue function = engine.newFunction(returnArg, reinterpret_cast<void *>(quintptr(i)),
+                                                   QStringLiteral("returnArg"));
+        function.call();
+    }
+    engine.collectGarbage();
+
+    qint64 calls = 0;
+    const QList<QScriptEngine::NativeFunctionStatistics> stats = engine.nativeFunctionStatistics();
+    for (const QScriptEngine::NativeFunctionStatistics &entry : stats)
+    {
+        if (entry.name == QLatin1String("returnArg"))
+        {
+            calls = entry.callCount;
+        }
+    }
+    QCOMPARE(calls, qint64(1000));
+}
+
+QTEST_GUILESS_MAIN(tst_NativeFunctions)
+
+#include "tst_nativefunctions.moc"
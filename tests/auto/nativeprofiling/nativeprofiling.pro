@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_nativeprofiling
+SOURCES += tst_nativeprofiling.cpp
@@ -0,0 +1,138 @@
+﻿#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptContext>
+
+class tst_NativeProfiling : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void disabledByDefault();
+    void counts();
+    void mergedByName();
+    void reset();
+    void json();
+};
+
+static QScriptValue nop(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(context);
+    Q_UNUSED(engine);
+    return QScriptValue();
+}
+
+static double add(double a, double b)
+{
+    return a + b;
+}
+
+static QScriptEngine::NativeFunctionStatistics statisticsFor(const QScriptEngine &engine, const QString &name)
+{
+    const QList<QScriptEngine::NativeFunctionStatistics> statistics = engine.nativeFunctionStatistics();
+    for (const QScriptEngine::NativeFunctionStatistics &stats : statistics)
+    {
+        if (stats.name == name)
+            return stats;
+    }
+    return QScriptEngine::NativeFunctionStatistics();
+}
+
+void tst_NativeProfiling::disabledByDefault()
+{
+    QScriptEngine engine;
+    QVERIFY(!engine.isNativeProfilingEnabled());
+
+    engine.globalObject().setProperty(QStringLiteral("nop"), engine.newFunction(nop, 0, QStringLiteral("nop")));
+    engine.evaluate(QStringLiteral("for (var i = 0; i < 100; ++i) nop();"));
+    QVERIFY(engine.nativeFunctionStatistics().isEmpty());
+}
+
+// 普通的原生函数和类型化的原生函数都计入统计，直方图的总数等于调用次数
+void tst_NativeProfiling::counts()
+{
+    QScriptEngine engine;
+    engine.setNativeProfilingEnabled(true);
+    engine.globalObject().setProperty(QStringLiteral("nop"), engine.newFunction(nop, 0, QStringLiteral("nop")));
+    engine.globalObject().setProperty(QStringLiteral("add"), engine.newFunction(add, QStringLiteral("add")));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("var s = 0; for (var i = 0; i < 1000; ++i) { nop(); s = add(s, 1); } s")).toInt32(), 1000);
+
+    const QStringList names = { QStringLiteral("nop"), QStringLiteral("add") };
+    for (const QString &name : names)
+    {
+        const QScriptEngine::NativeFunctionStatistics stats = statisticsFor(engine, name);
+        QCOMPARE(stats.callCount, qint64(1000));
+        QVERIFY(stats.minNs <= stats.maxNs);
+        QVERIFY(stats.totalNs >= stats.maxNs);
+        QCOMPARE(stats.histogram.size(), int(QScriptEngine::NativeFunctionStatistics::HistogramSize));
+
+        qint64 histogramTotal = 0;
+        for (qint64 count : stats.histogram)
+        {
+            histogramTotal += count;
+        }
+        QCOMPARE(histogramTotal, stats.callCount);
+    }
+
+    // 关闭后不再计数
+    engine.setNativeProfilingEnabled(false);
+    engine.evaluate(QStringLiteral("nop()"));
+    QCOMPARE(statisticsFor(engine, QStringLiteral("nop")).callCount, qint64(1000));
+}
+
+void tst_NativeProfiling::mergedByName()
+{
+    QScriptEngine engine;
+    engine.setNativeProfilingEnabled(true);
+    engine.globalObject().setProperty(QStringLiteral("a"), engine.newFunction(nop, 0, QStringLiteral("shared")));
+    engine.globalObject().setProperty(QStringLiteral("b"), engine.newFunction(nop, 0, QStringLiteral("shared")));
+
+    engine.evaluate(QStringLiteral("a(); a(); b();"));
+    QCOMPARE(statisticsFor(engine, QStringLiteral("shared")).callCount, qint64(3));
+}
+
+void tst_NativeProfiling::reset()
+{
+    QScriptEngine engine;
+    engine.setNativeProfilingEnabled(true);
+    engine.globalObject().setProperty(QStringLiteral("nop"), engine.newFunction(nop, 0, QStringLiteral("nop")));
+
+    engine.evaluate(QStringLiteral("nop(); nop();"));
+    QCOMPARE(statisticsFor(engine, QStringLiteral("nop")).callCount, qint64(2));
+
+    engine.resetNativeFunctionStatistics();
+    QVERIFY(engine.nativeFunctionStatistics().isEmpty());
+
+    engine.evaluate(QStringLiteral("nop();"));
+    QCOMPARE(statisticsFor(engine, QStringLiteral("nop")).callCount, qint64(1));
+}
+
+void tst_NativeProfiling::json()
+{
+    QScriptEngine engine;
+    engine.setNativeProfilingEnabled(true);
+    engine.globalObject().setProperty(QStringLiteral("add"), engine.newFunction(add, QStringLiteral("add")));
+    engine.evaluate(QStringLiteral("for (var i = 0; i < 10; ++i) add(i, i);"));
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(engine.nativeFunctionStatisticsJson(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QVERIFY(document.isArray());
+
+    const QJsonArray functions = document.array();
+    QCOMPARE(functions.size(), 1);
+    const QJsonObject entry = functions.at(0).toObject();
+    QCOMPARE(entry.value(QStringLiteral("name")).toString(), QStringLiteral("add"));
+    QCOMPARE(entry.value(QStringLiteral("calls")).toInt(), 10);
+    QCOMPARE(entry.value(QStringLiteral("histogramUs")).toArray().size(),
+             int(QScriptEngine::NativeFunctionStatistics::HistogramSize));
+}
+
+QTEST_GUILESS_MAIN(tst_NativeProfiling)
+
+#include "tst_nativeprofiling.moc"
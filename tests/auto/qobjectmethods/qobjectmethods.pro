@@ -0,0 +1,7 @@
+include(../../tests.pri)
+
+# moreThanInt16Methods 用 QMetaObjectBuilder 生成方法很多的元对象
+QT += core-private
+
+TARGET = tst_qobjectmethods
+SOURCES += tst_qobjectmethods.cpp
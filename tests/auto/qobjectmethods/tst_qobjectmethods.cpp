@@ -0,0 +1,197 @@
+﻿#include <QtTest>
+#include <private/qmetaobjectbuilder_p.h>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+#include <cstdlib>
+#include <memory>
+
+class Counter : public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE int add(int value) { m_total += value; return m_total; }
+    Q_INVOKABLE int sum12(int a1, int a2, int a3, int a4, int a5, int a6,
+                          int a7, int a8, int a9, int a10, int a11, int a12)
+    {
+        return a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 + a9 + a10 + a11 + a12;
+    }
+    Q_INVOKABLE int scaled(int value, int factor = 2) { return value * factor; }
+    Q_INVOKABLE QString pick(int a) { return QStringLiteral("pick1:%1").arg(a); }
+    Q_INVOKABLE QString pick(int a, int b, int c) { return QStringLiteral("pick3:%1").arg(a + b + c); }
+
+private:
+    int m_total{0};
+};
+
+class DerivedCounter : public Counter
+{
+    Q_OBJECT
+};
+
+class Unrelated : public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE QString name() const { return QStringLiteral("unrelated"); }
+};
+
+// 元对象在运行时生成，方法调用通过 qt_metacall 记录下被调用的方法
+class ManyMethods : public QObject
+{
+public:
+    explicit ManyMethods(const QMetaObject *metaObject) : m_metaObject(metaObject) {}
+
+    const QMetaObject *metaObject() const override { return m_metaObject; }
+
+    int qt_metacall(QMetaObject::Call call, int id, void **args) override
+    {
+        id = QObject::qt_metacall(call, id, args);
+        if (id < 0)
+            return id;
+        if (call == QMetaObject::InvokeMetaMethod)
+        {
+            called = id;
+            return -1;
+        }
+        return id;
+    }
+
+    int called{-1};
+
+private:
+    const QMetaObject *m_metaObject;
+};
+
+class tst_QObjectMethods : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void foreignThis();
+    void derivedThis();
+    void moreThanTenArguments();
+    void moreThanInt16Methods();
+    void tooFewArguments();
+    void overloadByArgumentCount();
+};
+
+// 方法用在另一个类的对象上时抛出 TypeError，而不是按下标调用到那个类的别的方法
+void tst_QObjectMethods::foreignThis()
+{
+    QScriptEngine engine;
+    Counter counter;
+    Unrelated unrelated;
+    engine.globalObject().setProperty(QStringLiteral("counter"), engine.newQObject(&counter));
+    engine.globalObject().setProperty(QStringLiteral("unrelated"), engine.newQObject(&unrelated));
+
+    engine.evaluate(QStringLiteral("counter.add.call(unrelated, 1)"));
+    QVERIFY(engine.hasUncaughtException());
+    QCOMPARE(engine.uncaughtException().property(QStringLiteral("name")).toString(), QStringLiteral("TypeError"));
+
+    engine.evaluate(QStringLiteral("unrelated.name.call(counter)"));
+    QVERIFY(engine.hasUncaughtException());
+    QCOMPARE(engine.uncaughtException().property(QStringLiteral("name")).toString(), QStringLiteral("TypeError"));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.add(2)")).toInt32(), 2);
+}
+
+// 子类的对象可以调用父类的方法
+void tst_QObjectMethods::derivedThis()
+{
+    QScriptEngine engine;
+    Counter counter;
+    DerivedCounter derived;
+    engine.globalObject().setProperty(QStringLiteral("counter"), engine.newQObject(&counter));
+    engine.globalObject().setProperty(QStringLiteral("derived"), engine.newQObject(&derived));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.add.call(derived, 5)")).toInt32(), 5);
+    QVERIFY(!engine.hasUncaughtException());
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.add(1)")).toInt32(), 1);
+}
+
+// 超过栈上预留个数的参数在堆上分配
+void tst_QObjectMethods::moreThanTenArguments()
+{
+    QScriptEngine engine;
+    Counter counter;
+    engine.globalObject().setProperty(QStringLiteral("counter"), engine.newQObject(&counter));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.sum12(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12)")).toInt32(), 78);
+    QVERIFY(!engine.hasUncaughtException());
+}
+
+// 方法组的下标超过 int16 后仍然调用到正确的方法
+void tst_QObjectMethods::moreThanInt16Methods()
+{
+    const int count = 40000;
+    QMetaObjectBuilder builder;
+    builder.setClassName("ManyMethods");
+    builder.setSuperClass(&QObject::staticMetaObject);
+    for (int i = 0; i < count; ++i)
+        builder.addMethod("m" + QByteArray::number(i) + "()");
+    std::unique_ptr<QMetaObject, void (*)(void *)> metaObject(builder.toMetaObject(), std::free);
+
+    QScriptEngine engine;
+    ManyMethods object(metaObject.get());
+    engine.globalObject().setProperty(QStringLiteral("object"), engine.newQObject(&object));
+
+    for (int i : {0, 32766, 32767, 32768, 39999})
+    {
+        object.called = -1;
+        engine.evaluate(QStringLiteral("object.m%1()").arg(i));
+        if (engine.hasUncaughtException())
+            QFAIL(qPrintable(engine.uncaughtException().toString()));
+        QCOMPARE(object.called, i);
+    }
+    QCOMPARE(engine.evaluate(QStringLiteral("object.m39999.name")).toString(), QStringLiteral("m39999"));
+    QCOMPARE(engine.evaluate(QStringLiteral("object.m39999.length")).toInt32(), 0);
+}
+
+static QString uncaughtName(QScriptEngine &engine)
+{
+    if (!engine.hasUncaughtException())
+        return QString();
+    return engine.uncaughtException().property(QStringLiteral("name")).toString();
+}
+
+// 参数不够时抛出 TypeError，不用默认构造的值调用
+void tst_QObjectMethods::tooFewArguments()
+{
+    QScriptEngine engine;
+    Counter counter;
+    engine.globalObject().setProperty(QStringLiteral("counter"), engine.newQObject(&counter));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.add(5)")).toInt32(), 5);
+    engine.evaluate(QStringLiteral("counter.add()"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+    engine.evaluate(QStringLiteral("counter.sum12(1, 2, 3)"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.add(0)")).toInt32(), 5);
+
+    // 带默认值的参数可以省略
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.scaled(3)")).toInt32(), 6);
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.scaled(3, 3)")).toInt32(), 9);
+    engine.evaluate(QStringLiteral("counter.scaled()"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+// 没有参数个数相同的重载时，取参数最多但不超过实参个数的重载
+void tst_QObjectMethods::overloadByArgumentCount()
+{
+    QScriptEngine engine;
+    Counter counter;
+    engine.globalObject().setProperty(QStringLiteral("counter"), engine.newQObject(&counter));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.pick(1)")).toString(), QStringLiteral("pick1:1"));
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.pick(1, 2)")).toString(), QStringLiteral("pick1:1"));
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.pick(1, 2, 3)")).toString(), QStringLiteral("pick3:6"));
+    QCOMPARE(engine.evaluate(QStringLiteral("counter.pick(1, 2, 3, 4)")).toString(), QStringLiteral("pick3:6"));
+    engine.evaluate(QStringLiteral("counter.pick()"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+QTEST_GUILESS_MAIN(tst_QObjectMethods)
+
+#include "tst_qobjectmethods.moc"
@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_qobjectproperties
+SOURCES += tst_qobjectproperties.cpp
@@ -0,0 +1,187 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+class Props : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int intValue MEMBER m_int)
+    Q_PROPERTY(double doubleValue MEMBER m_double)
+    Q_PROPERTY(bool boolValue MEMBER m_bool)
+    Q_PROPERTY(QString stringValue MEMBER m_string)
+    Q_PROPERTY(qlonglong longValue MEMBER m_long)
+    Q_PROPERTY(int clamped READ clamped WRITE setClamped)
+    Q_PROPERTY(int readOnly READ readOnly CONSTANT)
+    Q_PROPERTY(Color color MEMBER m_color)
+    Q_PROPERTY(Options options MEMBER m_options)
+
+public:
+    enum Color { Red, Green, Blue };
+    Q_ENUM(Color)
+
+    enum Option { A = 1, B = 2, C = 4 };
+    Q_DECLARE_FLAGS(Options, Option)
+    Q_FLAG(Options)
+
+    int clamped() const { return m_clamped; }
+    void setClamped(int value) { m_clamped = qBound(0, value, 100); }
+    int readOnly() const { return 11; }
+
+    int m_int{7};
+    double m_double{2.5};
+    bool m_bool{true};
+    QString m_string{QStringLiteral("text")};
+    qlonglong m_long{Q_INT64_C(1099511627776)};
+    int m_clamped{0};
+    Color m_color{Blue};
+    Options m_options{A | C};
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(Props::Options)
+
+// int、double、bool、QString、qlonglong 属性直接读写，枚举和标志经过 QVariant
+class tst_QObjectProperties : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void read_data();
+    void read();
+    void write_data();
+    void write();
+    void writeReachesObject();
+    void readOnly();
+    void deletedObject();
+};
+
+static QString uncaughtName(QScriptEngine &engine)
+{
+    if (!engine.hasUncaughtException())
+        return QString();
+    return engine.uncaughtException().property(QStringLiteral("name")).toString();
+}
+
+void tst_QObjectProperties::read_data()
+{
+    QTest::addColumn<QString>("property");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("int")       << QStringLiteral("intValue")    << QStringLiteral("number:7");
+    QTest::newRow("double")    << QStringLiteral("doubleValue") << QStringLiteral("number:2.5");
+    QTest::newRow("bool")      << QStringLiteral("boolValue")   << QStringLiteral("boolean:true");
+    QTest::newRow("QString")   << QStringLiteral("stringValue") << QStringLiteral("string:text");
+    QTest::newRow("qlonglong") << QStringLiteral("longValue")   << QStringLiteral("number:1099511627776");
+    QTest::newRow("getter")    << QStringLiteral("readOnly")    << QStringLiteral("number:11");
+    QTest::newRow("enum")      << QStringLiteral("color")       << QStringLiteral("number:2");
+    QTest::newRow("flags")     << QStringLiteral("options")     << QStringLiteral("number:5");
+}
+
+void tst_QObjectProperties::read()
+{
+    QFETCH(QString, property);
+    QFETCH(QString, expected);
+
+    QScriptEngine engine;
+    Props props;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(&props));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("typeof o.%1 + ':' + o.%1").arg(property)).toString(), expected);
+    QVERIFY(!engine.hasUncaughtException());
+}
+
+void tst_QObjectProperties::write_data()
+{
+    QTest::addColumn<QString>("property");
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("int")                 << QStringLiteral("intValue")    << QStringLiteral("42")            << QStringLiteral("42");
+    QTest::newRow("int from string")     << QStringLiteral("intValue")    << QStringLiteral("'17'")          << QStringLiteral("17");
+    QTest::newRow("int from double")     << QStringLiteral("intValue")    << QStringLiteral("3.9")           << QStringLiteral("3");
+    QTest::newRow("double")              << QStringLiteral("doubleValue") << QStringLiteral("0.25")          << QStringLiteral("0.25");
+    QTest::newRow("bool from number")    << QStringLiteral("boolValue")   << QStringLiteral("0")             << QStringLiteral("false");
+    QTest::newRow("bool from string")    << QStringLiteral("boolValue")   << QStringLiteral("'x'")           << QStringLiteral("true");
+    QTest::newRow("QString from number") << QStringLiteral("stringValue") << QStringLiteral("12")            << QStringLiteral("12");
+    QTest::newRow("qlonglong 2^40")      << QStringLiteral("longValue")   << QStringLiteral("2 ** 40 + 1")   << QStringLiteral("1099511627777");
+    QTest::newRow("qlonglong negative")  << QStringLiteral("longValue")   << QStringLiteral("-5")            << QStringLiteral("-5");
+    QTest::newRow("setter")              << QStringLiteral("clamped")     << QStringLiteral("500")           << QStringLiteral("100");
+    QTest::newRow("enum from number")    << QStringLiteral("color")       << QStringLiteral("1")             << QStringLiteral("1");
+    QTest::newRow("enum from name")      << QStringLiteral("color")       << QStringLiteral("'Red'")         << QStringLiteral("0");
+    QTest::newRow("flags from number")   << QStringLiteral("options")     << QStringLiteral("3")             << QStringLiteral("3");
+    QTest::newRow("flags from names")    << QStringLiteral("options")     << QStringLiteral("'B|C'")         << QStringLiteral("6");
+}
+
+void tst_QObjectProperties::write()
+{
+    QFETCH(QString, property);
+    QFETCH(QString, value);
+    QFETCH(QString, expected);
+
+    QScriptEngine engine;
+    Props props;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(&props));
+
+    engine.evaluate(QStringLiteral("'use strict'; o.%1 = %2;").arg(property, value));
+    QCOMPARE(uncaughtName(engine), QString());
+    QCOMPARE(engine.evaluate(QStringLiteral("String(o.%1)").arg(property)).toString(), expected);
+}
+
+// 写入的值到达 QObject 本身，而不是包装对象上的同名属性
+void tst_QObjectProperties::writeReachesObject()
+{
+    QScriptEngine engine;
+    Props props;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(&props));
+
+    engine.evaluate(QStringLiteral(
+        "o.intValue = -3; o.doubleValue = 1e300; o.boolValue = false; o.stringValue = '\\u4e2d\\u6587';"
+        "o.longValue = -(2 ** 50); o.color = 'Green'; o.options = 2;"));
+    QCOMPARE(uncaughtName(engine), QString());
+
+    QCOMPARE(props.m_int, -3);
+    QCOMPARE(props.m_double, 1e300);
+    QCOMPARE(props.m_bool, false);
+    QCOMPARE(props.m_string, QString::fromUtf8("\xe4\xb8\xad\xe6\x96\x87"));
+    QCOMPARE(props.m_long, -(Q_INT64_C(1) << 50));
+    QCOMPARE(int(props.m_color), int(Props::Green));
+    QCOMPARE(int(props.m_options), int(Props::B));
+
+    // C++ 里改了之后脚本读到新值
+    props.m_int = 99;
+    props.m_color = Props::Red;
+    QCOMPARE(engine.evaluate(QStringLiteral("o.intValue + ':' + o.color")).toString(), QStringLiteral("99:0"));
+}
+
+// 只读属性：非严格模式下忽略，严格模式下抛出 TypeError
+void tst_QObjectProperties::readOnly()
+{
+    QScriptEngine engine;
+    Props props;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(&props));
+
+    engine.evaluate(QStringLiteral("o.readOnly = 5;"));
+    QCOMPARE(uncaughtName(engine), QString());
+    QCOMPARE(engine.evaluate(QStringLiteral("o.readOnly")).toInt32(), 11);
+
+    engine.evaluate(QStringLiteral("'use strict'; o.readOnly = 5;"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+void tst_QObjectProperties::deletedObject()
+{
+    QScriptEngine engine;
+    Props *props = new Props;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(props));
+    QCOMPARE(engine.evaluate(QStringLiteral("o.intValue")).toInt32(), 7);
+    delete props;
+
+    engine.evaluate(QStringLiteral("o.intValue"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+    engine.evaluate(QStringLiteral("o.intValue = 1"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+QTEST_GUILESS_MAIN(tst_QObjectProperties)
+
+#include "tst_qobjectproperties.moc"
@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_resources
+SOURCES += tst_resources.cpp
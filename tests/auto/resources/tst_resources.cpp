@@ -0,0 +1,133 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// 堆限制、栈大小和GC阈值的压力测试
+class tst_Resources : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void heapLimitUncaught();
+    void heapLimitCaught();
+    void heapLimitRepeated();
+    void stackOverflow();
+    void gcThreshold();
+    void sharedWithSiblings();
+};
+
+static const size_t s_heapLimit = 32 * 1024 * 1024;
+
+// 分配的数组只被函数的局部变量引用，函数退出后都是垃圾
+static const QString s_allocateForever = QStringLiteral(
+    "(function () { var a = []; for (;;) a.push(new Array(1024).fill(1)); })()");
+
+static QString uncaughtMessage(QScriptEngine &engine)
+{
+    if (!engine.hasUncaughtException())
+        return QString();
+    return engine.uncaughtException().property(QStringLiteral("message")).toString();
+}
+
+// 没有被脚本处理时 evaluate() 以 "out of memory" 失败，垃圾回收之后引擎可以继续使用
+void tst_Resources::heapLimitUncaught()
+{
+    QScriptEngine engine;
+    engine.setHeapLimit(s_heapLimit);
+    QCOMPARE(engine.heapLimit(), s_heapLimit);
+
+    engine.evaluate(s_allocateForever);
+    QCOMPARE(uncaughtMessage(engine), QStringLiteral("out of memory"));
+
+    QCOMPARE(engine.evaluate(QStringLiteral("[1, 2, 3].map(function (x) { return x * 2; }).join()")).toString(),
+             QStringLiteral("2,4,6"));
+}
+
+// 脚本可以 catch 内存不足
+void tst_Resources::heapLimitCaught()
+{
+    QScriptEngine engine;
+    engine.setHeapLimit(s_heapLimit);
+
+    QScriptValue message = engine.evaluate(QStringLiteral("var m; try { ") + s_allocateForever
+                                           + QStringLiteral(" } catch (e) { m = e.message; } m"));
+    QVERIFY(!engine.hasUncaughtException());
+    QCOMPARE(message.toString(), QStringLiteral("out of memory"));
+}
+
+// 反复耗尽堆不会泄漏：每一轮都能分配到接近限制的内存
+void tst_Resources::heapLimitRepeated()
+{
+    QScriptEngine engine;
+    engine.setHeapLimit(s_heapLimit);
+
+    for (int round = 0; round < 20; ++round)
+    {
+        engine.evaluate(QStringLiteral(
+            "var count = 0;"
+            "try { (function () { var a = []; for (;;) { a.push(new Array(1024).fill(1)); ++count; } })(); } catch (e) {}"));
+        const int count = engine.globalObject().property(QStringLiteral("count")).toInt32();
+        QVERIFY2(count > 1000, qPrintable(QStringLiteral("round %1 only allocated %2 arrays").arg(round).arg(count)));
+    }
+}
+
+void tst_Resources::stackOverflow()
+{
+    QScriptEngine engine;
+    engine.setMaxStackSize(256 * 1024);
+    QCOMPARE(engine.maxStackSize(), size_t(256 * 1024));
+
+    engine.evaluate(QStringLiteral("(function f(n) { return f(n + 1) + 1; })(0)"));
+    QVERIFY(engine.hasUncaughtException());
+    QCOMPARE(engine.uncaughtException().property(QStringLiteral("name")).toString(), QStringLiteral("RangeError"));
+
+    // 栈溢出之后可以继续递归
+    QCOMPARE(engine.evaluate(QStringLiteral("(function f(n) { return n ? f(n - 1) + 1 : 0; })(100)")).toInt32(), 100);
+
+    // 0表示使用默认值
+    engine.setMaxStackSize(0);
+    QVERIFY(engine.maxStackSize() > 0);
+}
+
+// 不同的GC阈值下大量分配垃圾，结果都一样
+void tst_Resources::gcThreshold()
+{
+    const size_t thresholds[] = { 64 * 1024, 1024 * 1024, size_t(-1) };
+    for (size_t threshold : thresholds)
+    {
+        QScriptEngine engine;
+        engine.setGCThreshold(threshold);
+        QCOMPARE(engine.gcThreshold(), threshold);
+
+        for (int round = 0; round < 10; ++round)
+        {
+            QScriptValue sum = engine.evaluate(QStringLiteral(
+                "var s = 0;"
+                "for (var i = 0; i < 10000; ++i) { var o = { a: [i], b: { c: i } }; o.self = o; s += o.b.c; }"
+                "s"));
+            QCOMPARE(sum.toNumber(), 49995000.0);
+            engine.collectGarbage();
+        }
+    }
+}
+
+// 配置作用于runtime，兄弟引擎共享
+void tst_Resources::sharedWithSiblings()
+{
+    QScriptEngine engine;
+    QScopedPointer<QScriptEngine> sibling(engine.createSiblingEngine());
+
+    engine.setHeapLimit(s_heapLimit);
+    engine.setGCThreshold(1024 * 1024);
+    QCOMPARE(sibling->heapLimit(), s_heapLimit);
+    QCOMPARE(sibling->gcThreshold(), size_t(1024 * 1024));
+
+    sibling->evaluate(s_allocateForever);
+    QCOMPARE(uncaughtMessage(*sibling), QStringLiteral("out of memory"));
+    QCOMPARE(engine.evaluate(QStringLiteral("1 + 1")).toInt32(), 2);
+}
+
+QTEST_GUILESS_MAIN(tst_Resources)
+
+#include "tst_resources.moc"
@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_scriptclass
+SOURCES += tst_scriptclass.cpp
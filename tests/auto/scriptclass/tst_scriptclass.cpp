@@ -0,0 +1,303 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptClass>
+#include <QScriptClassPropertyIterator>
+#include <QScriptString>
+
+#include <memory>
+
+// 由一组C++的键值对支持的类：键的下标作为 id，
+// "ro_" 开头的键只读，"hidden_" 开头的不参与枚举，"fixed_" 开头的不能删除
+class TableClass : public QScriptClass
+{
+public:
+    explicit TableClass(QScriptEngine *engine) : QScriptClass(engine) {}
+
+    QueryFlags queryProperty(const QScriptValue &object, const QScriptString &name,
+                             QueryFlags flags, uint *id) override
+    {
+        Q_UNUSED(object);
+        queries << QStringLiteral("%1:%2").arg(name.toString()).arg(int(flags));
+        const int index = keys.indexOf(name.toString());
+        if (index < 0)
+            return QueryFlags();
+        *id = uint(index);
+        return name.toString().startsWith(QLatin1String("ro_")) ? HandlesReadAccess : flags;
+    }
+
+    QScriptValue property(const QScriptValue &object, const QScriptString &name, uint id) override
+    {
+        Q_UNUSED(object);
+        ++reads;
+        if (keys.at(int(id)) != name.toString())
+            return QScriptValue(QStringLiteral("wrong id"));
+        return QScriptValue(values.at(int(id)));
+    }
+
+    void setProperty(QScriptValue &object, const QScriptString &name, uint id, const QScriptValue &value) override
+    {
+        Q_UNUSED(object);
+        Q_UNUSED(name);
+        values[int(id)] = value.toInt32();
+    }
+
+    QScriptValue::PropertyFlags propertyFlags(const QScriptValue &object, const QScriptString &name, uint id) override
+    {
+        Q_UNUSED(object);
+        Q_UNUSED(id);
+        ++flagQueries;
+        return flagsFor(name.toString());
+    }
+
+    QScriptClassPropertyIterator *newIterator(const QScriptValue &object) override;
+
+    QScriptValue prototype() const override { return proto; }
+
+    QString name() const override { return QStringLiteral("Table"); }
+
+    static QScriptValue::PropertyFlags flagsFor(const QString &key)
+    {
+        QScriptValue::PropertyFlags flags;
+        if (key.startsWith(QLatin1String("ro_")))
+            flags |= QScriptValue::ReadOnly;
+        if (key.startsWith(QLatin1String("hidden_")))
+            flags |= QScriptValue::SkipInEnumeration;
+        if (key.startsWith(QLatin1String("fixed_")))
+            flags |= QScriptValue::Undeletable;
+        return flags;
+    }
+
+    QStringList keys;
+    QVector<int> values;
+    QScriptValue proto;
+    bool iterate{true};
+    QStringList queries;
+    int reads{0};
+    int flagQueries{0};
+};
+
+class TableIterator : public QScriptClassPropertyIterator
+{
+public:
+    TableIterator(const QScriptValue &object, TableClass *table)
+        : QScriptClassPropertyIterator(object), m_table(table)
+    {
+    }
+
+    bool hasNext() const override { return m_index + 1 < m_table->keys.size(); }
+    void next() override { ++m_index; }
+    bool hasPrevious() const override { return m_index > 0; }
+    void previous() override { --m_index; }
+    void toFront() override { m_index = -1; }
+    void toBack() override { m_index = m_table->keys.size(); }
+
+    QScriptString name() const override
+    {
+        return object().engine()->toStringHandle(m_table->keys.at(m_index));
+    }
+    uint id() const override { return uint(m_index); }
+    QScriptValue::PropertyFlags flags() const override { return TableClass::flagsFor(m_table->keys.at(m_index)); }
+
+private:
+    TableClass *m_table;
+    int m_index{-1};
+};
+
+QScriptClassPropertyIterator *TableClass::newIterator(const QScriptValue &object)
+{
+    return iterate ? new TableIterator(object, this) : nullptr;
+}
+
+class tst_ScriptClass : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void queryProperty();
+    void property();
+    void setProperty();
+    void readOnly();
+    void propertyFlags();
+    void unhandledNames();
+    void prototype();
+    void iterator();
+    void noIterator();
+    void scriptClassAndData();
+
+private:
+    QScriptEngine *m_engine{nullptr};
+    TableClass *m_table{nullptr};
+};
+
+void tst_ScriptClass::init()
+{
+    m_engine = new QScriptEngine;
+    m_table = new TableClass(m_engine);
+    m_table->keys << QStringLiteral("a") << QStringLiteral("b") << QStringLiteral("ro_c")
+                  << QStringLiteral("hidden_d") << QStringLiteral("fixed_e");
+    m_table->values << 1 << 2 << 3 << 4 << 5;
+    m_engine->globalObject().setProperty(QStringLiteral("t"), m_engine->newObject(m_table, QScriptValue(42)));
+}
+
+// QScriptClass 必须比它创建的对象活得更久
+void tst_ScriptClass::cleanup()
+{
+    delete m_engine;
+    m_engine = nullptr;
+    delete m_table;
+    m_table = nullptr;
+}
+
+// 读和写分别带 HandlesReadAccess、HandlesWriteAccess 查询，键名原样传入
+void tst_ScriptClass::queryProperty()
+{
+    m_engine->evaluate(QStringLiteral("t.a; t.b = 7; t.zz;"));
+    QCOMPARE(m_engine->hasUncaughtException(), false);
+
+    QVERIFY(m_table->queries.contains(QStringLiteral("a:%1").arg(int(QScriptClass::HandlesReadAccess))));
+    QVERIFY(m_table->queries.contains(QStringLiteral("b:%1").arg(int(QScriptClass::HandlesWriteAccess))));
+    QVERIFY(m_table->queries.contains(QStringLiteral("zz:%1").arg(int(QScriptClass::HandlesReadAccess))));
+}
+
+// property() 收到的是 queryProperty() 给出的 id；普通读取不查询 propertyFlags()
+void tst_ScriptClass::property()
+{
+    QCOMPARE(m_engine->evaluate(QStringLiteral("[t.a, t.b, t.ro_c, t.hidden_d, t.fixed_e].join()")).toString(),
+             QStringLiteral("1,2,3,4,5"));
+    QCOMPARE(m_table->reads, 5);
+    QCOMPARE(m_table->flagQueries, 0);
+
+    // C++ 里的值变了，脚本读到的也变了，没有复制
+    m_table->values[0] = 100;
+    QCOMPARE(m_engine->evaluate(QStringLiteral("t.a")).toInt32(), 100);
+    QCOMPARE(m_engine->globalObject().property(QStringLiteral("t")).property(QStringLiteral("b")).toInt32(), 2);
+    QCOMPARE(m_engine->evaluate(QStringLiteral("'a' in t && !('zz' in t)")).toBool(), true);
+}
+
+void tst_ScriptClass::setProperty()
+{
+    m_engine->evaluate(QStringLiteral("t.a = 10; t.b += 5;"));
+    QCOMPARE(m_engine->hasUncaughtException(), false);
+    QCOMPARE(m_table->values.at(0), 10);
+    QCOMPARE(m_table->values.at(1), 7);
+
+    // 没有定义成对象自己的属性
+    QCOMPARE(m_engine->evaluate(QStringLiteral("t.a")).toInt32(), 10);
+    m_table->values[0] = 11;
+    QCOMPARE(m_engine->evaluate(QStringLiteral("t.a")).toInt32(), 11);
+}
+
+// 只接管读的名字，写入按普通属性处理，不会调用 setProperty()
+void tst_ScriptClass::readOnly()
+{
+    m_engine->evaluate(QStringLiteral("t.ro_c = 9;"));
+    QCOMPARE(m_table->values.at(2), 3);
+    QVERIFY(m_table->queries.contains(QStringLiteral("ro_c:%1").arg(int(QScriptClass::HandlesWriteAccess))));
+}
+
+// 属性描述符的标志来自 propertyFlags()
+void tst_ScriptClass::propertyFlags()
+{
+    QCOMPARE(m_engine->evaluate(QStringLiteral(
+                 "var d = Object.getOwnPropertyDescriptor(t, 'a');"
+                 "[d.value, d.writable, d.enumerable, d.configurable].join()")).toString(),
+             QStringLiteral("1,true,true,true"));
+    QVERIFY(m_table->flagQueries > 0);
+
+    QCOMPARE(m_engine->evaluate(QStringLiteral("Object.getOwnPropertyDescriptor(t, 'ro_c').writable")).toBool(), false);
+    QCOMPARE(m_engine->evaluate(QStringLiteral("Object.getOwnPropertyDescriptor(t, 'hidden_d').enumerable")).toBool(), false);
+    QCOMPARE(m_engine->evaluate(QStringLiteral("Object.getOwnPropertyDescriptor(t, 'fixed_e').configurable")).toBool(), false);
+    QVERIFY(m_engine->evaluate(QStringLiteral("Object.getOwnPropertyDescriptor(t, 'zz') === undefined")).toBool());
+    QVERIFY(m_engine->evaluate(QStringLiteral("t.propertyIsEnumerable('a') && !t.propertyIsEnumerable('hidden_d')")).toBool());
+}
+
+// 没有接管的名字写在对象自己身上，之后直接找到，不再经过 property()
+void tst_ScriptClass::unhandledNames()
+{
+    m_engine->evaluate(QStringLiteral("t.extra = 'own';"));
+    QCOMPARE(m_engine->hasUncaughtException(), false);
+    const int reads = m_table->reads;
+    QCOMPARE(m_engine->evaluate(QStringLiteral("t.extra")).toString(), QStringLiteral("own"));
+    QCOMPARE(m_engine->evaluate(QStringLiteral("t.hasOwnProperty('extra')")).toBool(), true);
+    QCOMPARE(m_table->reads, reads);
+    QVERIFY(m_engine->evaluate(QStringLiteral("t.missing === undefined")).toBool());
+}
+
+// prototype() 上的成员在没有接管的名字上找到，接管的名字优先
+void tst_ScriptClass::prototype()
+{
+    QScriptEngine *engine = new QScriptEngine;
+    TableClass table(engine);
+    TableClass plain(engine);
+    // 引擎先于 QScriptClass 析构，析构前释放 prototype() 持有的值
+    auto release = [&table](QScriptEngine *e) { table.proto = QScriptValue(); delete e; };
+    std::unique_ptr<QScriptEngine, decltype(release)> engineOwner(engine, release);
+
+    table.keys << QStringLiteral("size") << QStringLiteral("a");
+    table.values << 2 << 1;
+    table.proto = engine->evaluate(QStringLiteral("({ describe: function () { return 'table of ' + this.size; }, size: -1, a: -1 })"));
+    engine->globalObject().setProperty(QStringLiteral("t"), engine->newObject(&table));
+
+    QCOMPARE(engine->evaluate(QStringLiteral("t.describe()")).toString(), QStringLiteral("table of 2"));
+    QCOMPARE(engine->evaluate(QStringLiteral("t.a")).toInt32(), 1);
+    QCOMPARE(engine->evaluate(QStringLiteral("Object.getPrototypeOf(Object.getPrototypeOf(t)) === Object.prototype")).toBool(), true);
+    QCOMPARE(engine->evaluate(QStringLiteral("t.toString === Object.prototype.toString")).toBool(), true);
+
+    // prototype() 无效时使用 Object.prototype
+    engine->globalObject().setProperty(QStringLiteral("p"), engine->newObject(&plain));
+    QCOMPARE(engine->evaluate(QStringLiteral("Object.getPrototypeOf(p) === Object.prototype")).toBool(), true);
+    QCOMPARE(engine->evaluate(QStringLiteral("typeof p.hasOwnProperty")).toString(), QStringLiteral("function"));
+}
+
+// 枚举由 newIterator() 决定，标志来自迭代器的 flags()
+void tst_ScriptClass::iterator()
+{
+    QCOMPARE(m_engine->evaluate(QStringLiteral("Object.keys(t).join()")).toString(),
+             QStringLiteral("a,b,ro_c,fixed_e"));
+    QCOMPARE(m_engine->evaluate(QStringLiteral("Object.getOwnPropertyNames(t).join()")).toString(),
+             QStringLiteral("a,b,ro_c,hidden_d,fixed_e"));
+    QCOMPARE(m_engine->evaluate(QStringLiteral("var r = []; for (var k in t) r.push(k + '=' + t[k]); r.join()")).toString(),
+             QStringLiteral("a=1,b=2,ro_c=3,fixed_e=5"));
+    QCOMPARE(m_engine->evaluate(QStringLiteral("JSON.stringify(t)")).toString(),
+             QStringLiteral("{\"a\":1,\"b\":2,\"ro_c\":3,\"fixed_e\":5}"));
+}
+
+// newIterator() 返回 nullptr 时只枚举对象自己的属性
+void tst_ScriptClass::noIterator()
+{
+    m_table->iterate = false;
+    m_engine->evaluate(QStringLiteral("t.own = 1;"));
+    QCOMPARE(m_engine->evaluate(QStringLiteral("Object.keys(t).join()")).toString(), QStringLiteral("own"));
+}
+
+void tst_ScriptClass::scriptClassAndData()
+{
+    QScriptValue t = m_engine->globalObject().property(QStringLiteral("t"));
+    QCOMPARE(t.scriptClass(), static_cast<QScriptClass *>(m_table));
+    QCOMPARE(t.scriptClassData().toInt32(), 42);
+    QVERIFY(t.isObject());
+
+    QScriptValue data = m_engine->newObject();
+    data.setProperty(QStringLiteral("name"), QScriptValue(QStringLiteral("payload")));
+    QScriptValue withObject = m_engine->newObject(m_table, data);
+    QVERIFY(withObject.scriptClassData().strictlyEquals(data));
+
+    // data 由对象持有，回收后仍然有效
+    data = QScriptValue();
+    m_engine->collectGarbage();
+    QCOMPARE(withObject.scriptClassData().property(QStringLiteral("name")).toString(), QStringLiteral("payload"));
+
+    QVERIFY(m_engine->newObject(m_table).scriptClassData().isUndefined());
+    QCOMPARE(m_engine->newObject().scriptClass(), static_cast<QScriptClass *>(nullptr));
+    QVERIFY(!m_engine->newObject().scriptClassData().isValid());
+    QCOMPARE(QScriptValue(1).scriptClass(), static_cast<QScriptClass *>(nullptr));
+}
+
+QTEST_GUILESS_MAIN(tst_ScriptClass)
+
+#include "tst_scriptclass.moc"
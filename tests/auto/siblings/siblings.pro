@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_siblings
+SOURCES += tst_siblings.cpp
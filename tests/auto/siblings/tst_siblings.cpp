@@ -0,0 +1,82 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+class tst_Siblings : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void isolatedGlobals();
+    void siblingJobsDrainedByOther();
+    void siblingJobExceptionStaysInOwner();
+    void runtimeOutlivesCreator();
+};
+
+void tst_Siblings::isolatedGlobals()
+{
+    QScriptEngine engine;
+    QScopedPointer<QScriptEngine> sibling(engine.createSiblingEngine());
+
+    QVERIFY(engine.sharesRuntimeWith(sibling.data()));
+    engine.evaluate(QStringLiteral("var x = 1"));
+    QVERIFY(sibling->evaluate(QStringLiteral("typeof x")).toString() == QLatin1String("undefined"));
+}
+
+// 任务队列是runtime级别的：兄弟引擎推迟的任务由另一个引擎执行，
+// 但 jobsExecuted 记在任务所属的引擎上
+void tst_Siblings::siblingJobsDrainedByOther()
+{
+    QScriptEngine engine;
+    QScopedPointer<QScriptEngine> sibling(engine.createSiblingEngine());
+
+    // 每批只执行一个任务，剩下的留在队列里
+    sibling->setJobBatchSize(1);
+    sibling->evaluate(QStringLiteral(
+        "var done = 0;"
+        "for (var i = 0; i < 5; ++i) Promise.resolve().then(function () { ++done; });"));
+    // 不用 evaluate() 读取：它返回前也会执行一批任务
+    QCOMPARE(sibling->globalObject().property(QStringLiteral("done")).toInt32(), 1);
+    QCOMPARE(sibling->jobStatistics().jobsExecuted, qint64(1));
+
+    engine.resetJobStatistics();
+    QCOMPARE(engine.processPendingJobs(), 4);
+
+    QCOMPARE(sibling->globalObject().property(QStringLiteral("done")).toInt32(), 5);
+    QCOMPARE(sibling->jobStatistics().jobsExecuted, qint64(5));
+    QCOMPARE(engine.jobStatistics().jobsExecuted, qint64(0));
+}
+
+// 兄弟引擎的任务中未捕获的异常不会变成执行任务的引擎的异常
+void tst_Siblings::siblingJobExceptionStaysInOwner()
+{
+    QScriptEngine engine;
+    QScopedPointer<QScriptEngine> sibling(engine.createSiblingEngine());
+
+    sibling->setJobBatchSize(1);
+    sibling->evaluate(QStringLiteral(
+        "var state = '';"
+        "Promise.resolve().then(function () {});"
+        "var p = Promise.resolve().then(function () { throw new Error('boom'); });"
+        "p.catch(function (e) { state = e.message; });"));
+
+    engine.processPendingJobs();
+    QVERIFY(!engine.hasUncaughtException());
+    QCOMPARE(sibling->globalObject().property(QStringLiteral("state")).toString(), QStringLiteral("boom"));
+}
+
+// runtime由最后一个被销毁的引擎释放
+void tst_Siblings::runtimeOutlivesCreator()
+{
+    QScriptEngine *engine = new QScriptEngine;
+    QScopedPointer<QScriptEngine> sibling(engine->createSiblingEngine());
+    delete engine;
+
+    QCOMPARE(sibling->evaluate(QStringLiteral("[1, 2, 3].length")).toInt32(), 3);
+    sibling->collectGarbage();
+}
+
+QTEST_GUILESS_MAIN(tst_Siblings)
+
+#include "tst_siblings.moc"
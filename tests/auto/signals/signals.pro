@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_signals
+SOURCES += tst_signals.cpp
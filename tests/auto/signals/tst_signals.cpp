@@ -0,0 +1,291 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+class Sender : public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE void fire(int value) { emit fired(value, QStringLiteral("s%1").arg(value)); }
+
+signals:
+    void fired(int value, const QString &text);
+};
+
+// 信号连接到脚本函数：connect/disconnect、其它线程发射的信号排队执行、合并、发送者删除后释放
+class tst_Signals : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void connectAndEmit();
+    void disconnectIdentity();
+    void disconnectThisObject();
+    void connectTwice();
+    void disconnectInsideHandler();
+    void queuedFromOtherThread();
+    void coalescing_data();
+    void coalescing();
+    void senderDestroyedReleasesHandler();
+    void senderDestroyedInOtherThread();
+    void deletedSender();
+};
+
+static QString uncaughtName(QScriptEngine &engine)
+{
+    if (!engine.hasUncaughtException())
+        return QString();
+    return engine.uncaughtException().property(QStringLiteral("name")).toString();
+}
+
+static void install(QScriptEngine &engine, Sender *sender)
+{
+    engine.globalObject().setProperty(QStringLiteral("sender"), engine.newQObject(sender));
+    engine.evaluate(QStringLiteral("var log = [];"));
+}
+
+static QString log(QScriptEngine &engine)
+{
+    return engine.evaluate(QStringLiteral("log.join()")).toString();
+}
+
+void tst_Signals::connectAndEmit()
+{
+    QScriptEngine engine;
+    Sender sender;
+    install(engine, &sender);
+
+    engine.evaluate(QStringLiteral("sender.fired.connect(function (v, t) { log.push(typeof v + ':' + v + ':' + t); });"));
+    QCOMPARE(uncaughtName(engine), QString());
+
+    emit sender.fired(1, QStringLiteral("a"));
+    engine.evaluate(QStringLiteral("sender.fire(2)"));
+    QCOMPARE(log(engine), QStringLiteral("number:1:a,number:2:s2"));
+}
+
+// disconnect 按函数对象的身份匹配，不是按源码
+void tst_Signals::disconnectIdentity()
+{
+    QScriptEngine engine;
+    Sender sender;
+    install(engine, &sender);
+
+    engine.evaluate(QStringLiteral(
+        "function make() { return function (v) { log.push(v); }; }"
+        "var f = make(), g = make();"
+        "sender.fired.connect(f);"));
+
+    engine.evaluate(QStringLiteral("sender.fired.disconnect(g)"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+    sender.fire(1);
+
+    // 每次读取得到新的信号对象，断开的仍然是同一个连接
+    QVERIFY(!engine.evaluate(QStringLiteral("sender.fired === sender.fired")).toBool());
+    engine.evaluate(QStringLiteral("sender.fired.disconnect(f)"));
+    QCOMPARE(uncaughtName(engine), QString());
+    sender.fire(2);
+
+    engine.evaluate(QStringLiteral("sender.fired.disconnect(f)"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+    QCOMPARE(log(engine), QStringLiteral("1"));
+
+    engine.evaluate(QStringLiteral("sender.fired.connect(42)"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+// 带 thisObject 的 disconnect 只断开 thisObject 相同的连接，不带时断开任意一个
+void tst_Signals::disconnectThisObject()
+{
+    QScriptEngine engine;
+    Sender sender;
+    install(engine, &sender);
+
+    engine.evaluate(QStringLiteral(
+        "var a = { name: 'a' }, b = { name: 'b' };"
+        "function f() { log.push(this.name); }"
+        "sender.fired.connect(a, f);"
+        "sender.fired.connect(b, f);"
+        "sender.fired.disconnect(b, f);"));
+    QCOMPARE(uncaughtName(engine), QString());
+    sender.fire(1);
+    QCOMPARE(log(engine), QStringLiteral("a"));
+
+    engine.evaluate(QStringLiteral("sender.fired.disconnect(b, f)"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+    engine.evaluate(QStringLiteral("sender.fired.disconnect(f)"));
+    QCOMPARE(uncaughtName(engine), QString());
+    sender.fire(2);
+    QCOMPARE(log(engine), QStringLiteral("a"));
+}
+
+// 同一个函数连接两次就执行两次，断开一次还剩一次
+void tst_Signals::connectTwice()
+{
+    QScriptEngine engine;
+    Sender sender;
+    install(engine, &sender);
+
+    engine.evaluate(QStringLiteral("function f(v) { log.push(v); } sender.fired.connect(f); sender.fired.connect(f);"));
+    sender.fire(1);
+    engine.evaluate(QStringLiteral("sender.fired.disconnect(f)"));
+    sender.fire(2);
+    QCOMPARE(log(engine), QStringLiteral("1,1,2"));
+}
+
+void tst_Signals::disconnectInsideHandler()
+{
+    QScriptEngine engine;
+    Sender sender;
+    install(engine, &sender);
+
+    engine.evaluate(QStringLiteral(
+        "function once(v) { log.push(v); sender.fired.disconnect(once); }"
+        "sender.fired.connect(once);"));
+    sender.fire(1);
+    sender.fire(2);
+    QCOMPARE(uncaughtName(engine), QString());
+    QCOMPARE(log(engine), QStringLiteral("1"));
+}
+
+// 其它线程发射的信号复制参数后排队到引擎所在的线程执行
+void tst_Signals::queuedFromOtherThread()
+{
+    QScriptEngine engine;
+    Sender sender;
+    install(engine, &sender);
+
+    engine.evaluate(QStringLiteral("sender.fired.connect(function (v, t) { log.push(v + t); });"));
+
+    QThread *thread = QThread::create([&sender]() {
+        for (int i = 0; i < 3; ++i)
+        {
+            // 临时字符串在发射之后就释放了
+            const QString text = QString(QStringLiteral("text%1")).repeated(2).arg(i);
+            emit sender.fired(i, text);
+        }
+    });
+    thread->start();
+    QVERIFY(thread->wait(5000));
+    delete thread;
+
+    // 发射的线程里没有执行
+    QCOMPARE(log(engine), QString());
+    QTRY_COMPARE(log(engine), QStringLiteral("0text0text0,1text1text1,2text2text2"));
+}
+
+void tst_Signals::coalescing_data()
+{
+    QTest::addColumn<bool>("coalesce");
+    QTest::addColumn<QString>("expected");
+
+    // 每个事件执行完都会执行Promise任务，从任务的位置可以看出一个事件执行了几个信号
+    QTest::newRow("separate")  << false << QStringLiteral("0,job0,1,job1,2,job2");
+    QTest::newRow("coalesced") << true  << QStringLiteral("0,1,2,job0,job1,job2");
+}
+
+void tst_Signals::coalescing()
+{
+    QFETCH(bool, coalesce);
+    QFETCH(QString, expected);
+
+    QScriptEngine engine;
+    engine.setQueuedSignalCoalescingEnabled(coalesce);
+    Sender sender;
+    install(engine, &sender);
+
+    engine.evaluate(QStringLiteral(
+        "sender.fired.connect(function (v) { log.push(v); Promise.resolve().then(function () { log.push('job' + v); }); });"));
+
+    QThread *thread = QThread::create([&sender]() {
+        for (int i = 0; i < 3; ++i)
+            sender.fire(i);
+    });
+    thread->start();
+    QVERIFY(thread->wait(5000));
+    delete thread;
+
+    QCoreApplication::sendPostedEvents();
+    QCOMPARE(log(engine), expected);
+
+    // 处理完之后不再有排队的事件
+    QCoreApplication::sendPostedEvents();
+    QCOMPARE(log(engine), expected);
+}
+
+// 连接的函数被 tracker 的包装对象引用；包装对象是 ScriptOwnership，被回收时删除 tracker
+static void connectTracked(QScriptEngine &engine, Sender *sender, QObject *tracker)
+{
+    engine.globalObject().setProperty(QStringLiteral("sender"), engine.newQObject(sender));
+    engine.globalObject().setProperty(QStringLiteral("tracker"), engine.newQObject(tracker, QScriptEngine::ScriptOwnership));
+    engine.evaluate(QStringLiteral(
+        "(function () { var t = tracker; sender.fired.connect(function () { t.objectName = 'fired'; }); })();"
+        "sender = null; tracker = null;"));
+}
+
+// 发送者删除后立即释放连接的函数，不用等到下一次 connect
+void tst_Signals::senderDestroyedReleasesHandler()
+{
+    QScriptEngine engine;
+    Sender *sender = new Sender;
+    QPointer<QObject> tracker = new QObject;
+    connectTracked(engine, sender, tracker);
+    QCOMPARE(uncaughtName(engine), QString());
+
+    sender->fire(1);
+    QCOMPARE(tracker->objectName(), QStringLiteral("fired"));
+    engine.collectGarbage();
+    QVERIFY(tracker);
+
+    delete sender;
+    engine.collectGarbage();
+    QVERIFY(tracker.isNull());
+}
+
+// 在其它线程删除发送者时排队释放
+void tst_Signals::senderDestroyedInOtherThread()
+{
+    QScriptEngine engine;
+    Sender *sender = new Sender;
+    QPointer<QObject> tracker = new QObject;
+    connectTracked(engine, sender, tracker);
+
+    QThread *thread = QThread::create([sender]() { delete sender; });
+    sender->moveToThread(thread);
+    thread->start();
+    QVERIFY(thread->wait(5000));
+    delete thread;
+
+    engine.collectGarbage();
+    QVERIFY(tracker);
+
+    QCoreApplication::sendPostedEvents();
+    engine.collectGarbage();
+    QVERIFY(tracker.isNull());
+
+    // 之后的连接不受影响
+    Sender other;
+    install(engine, &other);
+    engine.evaluate(QStringLiteral("sender.fired.connect(function (v) { log.push(v); });"));
+    other.fire(3);
+    QCOMPARE(log(engine), QStringLiteral("3"));
+}
+
+// 发送者删除之后信号对象的 connect/disconnect 抛出 TypeError
+void tst_Signals::deletedSender()
+{
+    QScriptEngine engine;
+    Sender *sender = new Sender;
+    install(engine, sender);
+    engine.evaluate(QStringLiteral("var signal = sender.fired; function f() {} signal.connect(f);"));
+    delete sender;
+
+    engine.evaluate(QStringLiteral("signal.connect(f)"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+    engine.evaluate(QStringLiteral("signal.disconnect(f)"));
+    QCOMPARE(uncaughtName(engine), QStringLiteral("TypeError"));
+}
+
+QTEST_GUILESS_MAIN(tst_Signals)
+
+#include "tst_signals.moc"
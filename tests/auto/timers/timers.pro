@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_timers
+SOURCES += tst_timers.cpp
@@ -0,0 +1,205 @@
+﻿#include <QtTest>
+#include <QSet>
+
+#include <climits>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptContext>
+#include <QScriptTimerWheel>
+
+class tst_Timers : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void ordering();
+    void arguments();
+    void intervalRearm();
+    void clearInsideCallback();
+    void clearIntervalInsideOwnCallback();
+    void distinctIds();
+    void idWrapSkipsLiveIds();
+    void abortCancelsTimers();
+    void abortInsideCallback();
+    void wheelAdvance();
+};
+
+static QString logOf(QScriptEngine &engine)
+{
+    return engine.globalObject().property(QStringLiteral("log")).toString();
+}
+
+static QScriptValue abortFromCallback(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(context);
+    engine->abortEvaluation();
+    return QScriptValue();
+}
+
+// 按到期时间触发，同时到期的按添加顺序
+void tst_Timers::ordering()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var log = [];"
+        "setTimeout(function () { log.push('b'); }, 30);"
+        "setTimeout(function () { log.push('a'); }, 10);"
+        "setTimeout(function () { log.push('c'); }, 30);"
+        "setTimeout(function () { log.push('z'); });"));
+
+    QTRY_COMPARE(logOf(engine), QStringLiteral("z,a,b,c"));
+}
+
+void tst_Timers::arguments()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var log = [];"
+        "setTimeout(function (a, b) { log.push(a + b); }, 0, 40, 2);"));
+
+    QTRY_COMPARE(logOf(engine), QStringLiteral("42"));
+}
+
+void tst_Timers::intervalRearm()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var log = [];"
+        "var id = setInterval(function () { log.push(log.length); if (log.length === 5) clearInterval(id); }, 5);"));
+
+    QTRY_COMPARE(logOf(engine), QStringLiteral("0,1,2,3,4"));
+    QTest::qWait(50);
+    QCOMPARE(logOf(engine), QStringLiteral("0,1,2,3,4"));
+}
+
+// 同一时刻到期的定时器，前一个回调中取消的后一个不会再触发
+void tst_Timers::clearInsideCallback()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var log = [];"
+        "var second;"
+        "setTimeout(function () { log.push('first'); clearTimeout(second); }, 10);"
+        "second = setTimeout(function () { log.push('second'); }, 10);"
+        "setTimeout(function () { log.push('last'); }, 30);"));
+
+    QTRY_COMPARE(logOf(engine), QStringLiteral("first,last"));
+}
+
+void tst_Timers::clearIntervalInsideOwnCallback()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var log = [];"
+        "var id = setInterval(function () { log.push('tick'); clearInterval(id); }, 5);"));
+
+    QTRY_COMPARE(logOf(engine), QStringLiteral("tick"));
+    QTest::qWait(50);
+    QCOMPARE(logOf(engine), QStringLiteral("tick"));
+}
+
+// 回调中新建的定时器不会拿到正在触发的 setInterval 的id
+void tst_Timers::distinctIds()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var ids = [];"
+        "for (var i = 0; i < 100; ++i) ids.push(setTimeout(function () {}, 1000));"
+        "var log = [];"
+        "var interval = setInterval(function () {"
+        "    var inner = setTimeout(function () {}, 1000);"
+        "    log.push(inner !== interval && ids.indexOf(inner) < 0);"
+        "    clearInterval(interval);"
+        "}, 5);"
+        "ids.push(interval);"));
+
+    QTRY_COMPARE(logOf(engine), QStringLiteral("true"));
+
+    QScriptValue ids = engine.evaluate(QStringLiteral("ids.every(function (id, i) { return id > 0 && ids.indexOf(id) === i; })"));
+    QVERIFY(ids.toBool());
+}
+
+// id 用到 INT_MAX 后从1开始，跳过还在使用的id
+void tst_Timers::idWrapSkipsLiveIds()
+{
+    const QSet<int> live = { INT_MAX, 1, 2 };
+    auto isUsed = [&live](int id) { return live.contains(id); };
+
+    int next = INT_MAX - 1;
+    QCOMPARE(QScriptTimerWheel::allocateId(next, isUsed), INT_MAX - 1);
+    QCOMPARE(next, INT_MAX);
+    QCOMPARE(QScriptTimerWheel::allocateId(next, isUsed), 3);
+    QCOMPARE(next, 4);
+    QCOMPARE(QScriptTimerWheel::allocateId(next, isUsed), 4);
+
+    next = INT_MAX;
+    QCOMPARE(QScriptTimerWheel::allocateId(next, [](int) { return false; }), INT_MAX);
+    QCOMPARE(next, 1);
+}
+
+// 不在执行脚本时调用 abortEvaluation()，所有还没触发的定时器都被取消
+void tst_Timers::abortCancelsTimers()
+{
+    QScriptEngine engine;
+    engine.evaluate(QStringLiteral(
+        "var log = [];"
+        "setTimeout(function () { log.push('timeout'); }, 10);"
+        "setInterval(function () { log.push('interval'); }, 10);"));
+
+    engine.abortEvaluation();
+    QTest::qWait(100);
+    QCOMPARE(logOf(engine), QString());
+
+    // 之后新建的定时器照常工作
+    engine.evaluate(QStringLiteral("setTimeout(function () { log.push('after'); }, 0);"));
+    QTRY_COMPARE(logOf(engine), QStringLiteral("after"));
+}
+
+// 在定时器回调中调用 abortEvaluation()，同一批和之后的定时器都不再触发
+void tst_Timers::abortInsideCallback()
+{
+    QScriptEngine engine;
+    engine.globalObject().setProperty(QStringLiteral("abort"), engine.newFunction(abortFromCallback, 0, QStringLiteral("abort")));
+    engine.evaluate(QStringLiteral(
+        "var log = [];"
+        "setTimeout(function () { log.push('first'); abort(); }, 10);"
+        "setTimeout(function () { log.push('same tick'); }, 10);"
+        "setInterval(function () { log.push('interval'); }, 20);"));
+
+    QTRY_COMPARE(logOf(engine), QStringLiteral("first"));
+    QTest::qWait(100);
+    QCOMPARE(logOf(engine), QStringLiteral("first"));
+}
+
+void tst_Timers::wheelAdvance()
+{
+    QScriptTimerWheel wheel(8, 1);
+    QCOMPARE(wheel.nextTimeout(0), qint64(-1));
+
+    // 超过一圈的定时器要多转几圈才到期
+    wheel.start(1, 20, 0);
+    wheel.start(2, 5, 0);
+    wheel.start(3, 5, 0);
+    QCOMPARE(wheel.count(), 3);
+    QVERIFY(wheel.stop(3));
+    QVERIFY(!wheel.stop(3));
+    QCOMPARE(wheel.nextTimeout(0), qint64(4));
+
+    QList<int> expired;
+    wheel.advance(10, expired);
+    QCOMPARE(expired, QList<int>() << 2);
+
+    // 重新计时
+    wheel.start(1, 30, 10);
+    expired.clear();
+    wheel.advance(30, expired);
+    QVERIFY(expired.isEmpty());
+    wheel.advance(40, expired);
+    QCOMPARE(expired, QList<int>() << 1);
+    QCOMPARE(wheel.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_Timers)
+
+#include "tst_timers.moc"
@@ -0,0 +1,132 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptEngineAgent>
+#include <QScriptValue>
+
+class tst_TypedFunctions : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void conversions_data();
+    void conversions();
+    void agentNotified();
+};
+
+// 只记录原生函数（scriptId 为-1）的进入和退出
+class NativeCallAgent : public QScriptEngineAgent
+{
+public:
+    explicit NativeCallAgent(QScriptEngine *engine) : QScriptEngineAgent(engine) {}
+
+    void functionEntry(qint64 scriptId) override
+    {
+        if (scriptId == -1)
+            ++entries;
+    }
+    void functionExit(qint64 scriptId, const QScriptValue &returnValue) override
+    {
+        if (scriptId == -1)
+            exits << (returnValue.isValid() ? returnValue.toString() : QStringLiteral("<invalid>"));
+    }
+
+    int entries{0};
+    QStringList exits;
+};
+
+static int negate(int value)
+{
+    return -value;
+}
+
+static qint64 half(qint64 value)
+{
+    return value / 2;
+}
+
+static uint twice(uint value)
+{
+    return value * 2;
+}
+
+static QString join(QString a, bool b, double c)
+{
+    return a + QLatin1Char(':') + (b ? QLatin1String("true") : QLatin1String("false"))
+           + QLatin1Char(':') + QString::number(c);
+}
+
+// result 为空时期望 TypeError
+void tst_TypedFunctions::conversions_data()
+{
+    QTest::addColumn<QString>("script");
+    QTest::addColumn<QString>("result");
+
+    QTest::newRow("int")                << QStringLiteral("negate(5)")            << QStringLiteral("-5");
+    QTest::newRow("int truncated")      << QStringLiteral("negate(2.75)")         << QStringLiteral("-2");
+    QTest::newRow("int min")            << QStringLiteral("negate(-2147483647)")  << QStringLiteral("2147483647");
+    QTest::newRow("int too large")      << QStringLiteral("negate(2147483648)")   << QString();
+    QTest::newRow("int too small")      << QStringLiteral("negate(-2147483649)")  << QString();
+    QTest::newRow("int NaN")            << QStringLiteral("negate(NaN)")          << QString();
+    QTest::newRow("int Infinity")       << QStringLiteral("negate(Infinity)")     << QString();
+    QTest::newRow("int from string")    << QStringLiteral("negate('5')")          << QString();
+    QTest::newRow("int missing")        << QStringLiteral("negate()")             << QString();
+    QTest::newRow("uint")               << QStringLiteral("twice(21)")            << QStringLiteral("42");
+    QTest::newRow("uint max")           << QStringLiteral("twice(4294967295) > 0") << QStringLiteral("true");
+    QTest::newRow("uint negative")      << QStringLiteral("twice(-1)")            << QString();
+    QTest::newRow("uint too large")     << QStringLiteral("twice(4294967296)")    << QString();
+    QTest::newRow("qint64")             << QStringLiteral("half(9007199254740992)") << QStringLiteral("4503599627370496");
+    QTest::newRow("qint64 min")         << QStringLiteral("half(-9223372036854775808) === -4611686018427387904") << QStringLiteral("true");
+    QTest::newRow("qint64 2^63")        << QStringLiteral("half(9223372036854775808)") << QString();
+    QTest::newRow("qint64 NaN")         << QStringLiteral("half(NaN)")            << QString();
+    QTest::newRow("qint64 -Infinity")   << QStringLiteral("half(-Infinity)")      << QString();
+    QTest::newRow("qint64 1e300")       << QStringLiteral("half(1e300)")          << QString();
+    QTest::newRow("mixed")              << QStringLiteral("join('a', true, 1.5)") << QStringLiteral("a:true:1.5");
+    QTest::newRow("mixed bool mismatch") << QStringLiteral("join('a', 1, 1.5)")   << QString();
+    QTest::newRow("mixed extra args")   << QStringLiteral("join('a', false, 2, 'ignored')") << QStringLiteral("a:false:2");
+}
+
+void tst_TypedFunctions::conversions()
+{
+    QFETCH(QString, script);
+    QFETCH(QString, result);
+
+    QScriptEngine engine;
+    QScriptValue global = engine.globalObject();
+    global.setProperty(QStringLiteral("negate"), engine.newFunction(negate, QStringLiteral("negate")));
+    global.setProperty(QStringLiteral("twice"), engine.newFunction(twice, QStringLiteral("twice")));
+    global.setProperty(QStringLiteral("half"), engine.newFunction(half, QStringLiteral("half")));
+    global.setProperty(QStringLiteral("join"), engine.newFunction(join, QStringLiteral("join")));
+
+    QScriptValue value = engine.evaluate(script);
+    if (result.isEmpty())
+    {
+        QVERIFY(engine.hasUncaughtException());
+        QCOMPARE(engine.uncaughtException().property(QStringLiteral("name")).toString(), QStringLiteral("TypeError"));
+    }
+    else
+    {
+        QVERIFY(!engine.hasUncaughtException());
+        QCOMPARE(value.toString(), result);
+    }
+}
+
+// 与 newFunction(FunctionSignature) 注册的函数一样通知agent，包括抛出 TypeError 的调用
+void tst_TypedFunctions::agentNotified()
+{
+    QScriptEngine engine;
+    NativeCallAgent agent(&engine);
+    engine.setAgent(&agent);
+    engine.globalObject().setProperty(QStringLiteral("negate"), engine.newFunction(negate, QStringLiteral("negate")));
+
+    engine.evaluate(QStringLiteral("negate(5); try { negate('x'); } catch (e) {} try { negate(); } catch (e) {}"),
+                    QStringLiteral("typedfunctions.js"));
+    engine.setAgent(nullptr);
+
+    QCOMPARE(agent.entries, 3);
+    QCOMPARE(agent.exits, QStringList() << QStringLiteral("-5") << QStringLiteral("<invalid>") << QStringLiteral("<invalid>"));
+}
+
+QTEST_GUILESS_MAIN(tst_TypedFunctions)
+
+#include "tst_typedfunctions.moc"
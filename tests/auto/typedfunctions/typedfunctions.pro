@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_typedfunctions
+SOURCES += tst_typedfunctions.cpp
@@ -0,0 +1,158 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+#include <new>
+
+// 以 PreferExistingWrapperObject 包装的对象缓存
+class tst_WrapperCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sameWrapper();
+    void separateConfigurations();
+    void destroyedRemovesEntry();
+    void destroyedInOtherThread();
+    void collectedWrapperRecreated();
+    void collectedCycleRecreated();
+};
+
+static const QScriptEngine::QObjectWrapOptions s_prefer = QScriptEngine::PreferExistingWrapperObject;
+
+// 在同一块内存上先后构造两个 QObject，模拟删除后地址被复用
+struct ReusedSlot
+{
+    alignas(QObject) char storage[sizeof(QObject)];
+
+    QObject *construct() { return new (storage) QObject; }
+    void destroy() { reinterpret_cast<QObject *>(storage)->~QObject(); }
+};
+
+void tst_WrapperCache::sameWrapper()
+{
+    QScriptEngine engine;
+    QObject object;
+
+    QScriptValue first = engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer);
+    QScriptValue second = engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer);
+    QVERIFY(first.strictlyEquals(second));
+
+    // 脚本里加的属性在再次包装后还在
+    first.setProperty(QStringLiteral("tag"), QScriptValue(1));
+    QCOMPARE(engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer).property(QStringLiteral("tag")).toInt32(), 1);
+
+    // 不带 PreferExistingWrapperObject 时每次都是新的包装对象，也不会进入缓存
+    QScriptValue plain = engine.newQObject(&object);
+    QVERIFY(!plain.strictlyEquals(first));
+    QVERIFY(!plain.strictlyEquals(engine.newQObject(&object)));
+    QVERIFY(first.strictlyEquals(engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer)));
+}
+
+// 不同的包装选项和所有权各有各的包装对象
+void tst_WrapperCache::separateConfigurations()
+{
+    QScriptEngine engine;
+    QObject object;
+
+    QScriptValue qt = engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer);
+    QScriptValue auto_ = engine.newQObject(&object, QScriptEngine::AutoOwnership, s_prefer);
+    QScriptValue noSlots = engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer | QScriptEngine::ExcludeSlots);
+    QVERIFY(!qt.strictlyEquals(auto_));
+    QVERIFY(!qt.strictlyEquals(noSlots));
+
+    QVERIFY(auto_.strictlyEquals(engine.newQObject(&object, QScriptEngine::AutoOwnership, s_prefer)));
+    QVERIFY(noSlots.strictlyEquals(engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer | QScriptEngine::ExcludeSlots)));
+    QVERIFY(qt.strictlyEquals(engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer)));
+}
+
+// QObject 删除后缓存项被移除，同一地址上的新对象得到新的包装对象
+void tst_WrapperCache::destroyedRemovesEntry()
+{
+    QScriptEngine engine;
+    ReusedSlot slot;
+
+    QObject *first = slot.construct();
+    QScriptValue firstWrapper = engine.newQObject(first, QScriptEngine::QtOwnership, s_prefer);
+    QScriptValue firstAuto = engine.newQObject(first, QScriptEngine::AutoOwnership, s_prefer);
+    firstWrapper.setProperty(QStringLiteral("tag"), QScriptValue(1));
+    slot.destroy();
+    QVERIFY(firstWrapper.toQObject() == nullptr);
+
+    QObject *second = slot.construct();
+    QCOMPARE(second, first);
+    QScriptValue secondWrapper = engine.newQObject(second, QScriptEngine::QtOwnership, s_prefer);
+    QVERIFY(!secondWrapper.strictlyEquals(firstWrapper));
+    QVERIFY(secondWrapper.property(QStringLiteral("tag")).isUndefined());
+    QCOMPARE(secondWrapper.toQObject(), second);
+    QVERIFY(!engine.newQObject(second, QScriptEngine::AutoOwnership, s_prefer).strictlyEquals(firstAuto));
+
+    QVERIFY(secondWrapper.strictlyEquals(engine.newQObject(second, QScriptEngine::QtOwnership, s_prefer)));
+    slot.destroy();
+}
+
+// 在其它线程删除时缓存项排队移除；排队期间同一地址上的新对象不会拿到旧的包装对象，
+// 排队的移除也不会删掉新对象的项
+void tst_WrapperCache::destroyedInOtherThread()
+{
+    QScriptEngine engine;
+    ReusedSlot slot;
+
+    QObject *first = slot.construct();
+    QScriptValue firstWrapper = engine.newQObject(first, QScriptEngine::QtOwnership, s_prefer);
+
+    QThread *thread = QThread::create([&slot]() { slot.destroy(); });
+    first->moveToThread(thread);
+    thread->start();
+    QVERIFY(thread->wait(5000));
+    delete thread;
+
+    // 还没处理排队的移除
+    QObject *second = slot.construct();
+    QScriptValue secondWrapper = engine.newQObject(second, QScriptEngine::QtOwnership, s_prefer);
+    QVERIFY(!secondWrapper.strictlyEquals(firstWrapper));
+
+    QCoreApplication::sendPostedEvents();
+    QVERIFY(secondWrapper.strictlyEquals(engine.newQObject(second, QScriptEngine::QtOwnership, s_prefer)));
+    slot.destroy();
+}
+
+// 缓存不持有引用：包装对象被回收后再包装得到新的包装对象
+void tst_WrapperCache::collectedWrapperRecreated()
+{
+    QScriptEngine engine;
+    QObject object;
+
+    QScriptValue wrapper = engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer);
+    wrapper.setProperty(QStringLiteral("tag"), QScriptValue(1));
+    wrapper = QScriptValue();
+    engine.collectGarbage();
+
+    QScriptValue again = engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer);
+    QVERIFY(again.property(QStringLiteral("tag")).isUndefined());
+    QCOMPARE(again.toQObject(), &object);
+    QVERIFY(again.strictlyEquals(engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer)));
+}
+
+// 包装对象只被环引用时，在回收环之前仍然复用，回收之后重新创建
+void tst_WrapperCache::collectedCycleRecreated()
+{
+    QScriptEngine engine;
+    QObject object;
+
+    engine.globalObject().setProperty(QStringLiteral("wrap"), engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer));
+    engine.evaluate(QStringLiteral("wrap.self = wrap; wrap.tag = 1; wrap = null;"));
+    QVERIFY(!engine.hasUncaughtException());
+
+    QCOMPARE(engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer).property(QStringLiteral("tag")).toInt32(), 1);
+
+    engine.collectGarbage();
+    QScriptValue again = engine.newQObject(&object, QScriptEngine::QtOwnership, s_prefer);
+    QVERIFY(again.property(QStringLiteral("tag")).isUndefined());
+    QVERIFY(again.property(QStringLiteral("self")).isUndefined());
+}
+
+QTEST_GUILESS_MAIN(tst_WrapperCache)
+
+#include "tst_wrappercache.moc"
@@ -0,0 +1,4 @@
+include(../../tests.pri)
+
+TARGET = tst_wrappercache
+SOURCES += tst_wrappercache.cpp
@@ -0,0 +1,77 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptEngineAgent>
+#include <QScriptValue>
+
+// 逐指令回调（opcode hook）的开销：只在设置了agent时安装，取消agent后卸载
+// "detached" 与 "never attached" 应该没有差别，"attached" 是调试时要付出的代价
+class tst_Agent : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void loop_data();
+    void loop();
+};
+
+// 什么都不做的agent，测到的只是回调本身的开销
+class NullAgent : public QScriptEngineAgent
+{
+public:
+    explicit NullAgent(QScriptEngine *engine) : QScriptEngineAgent(engine) {}
+    void positionChange(qint64, int, int) override { ++positions; }
+
+    qint64 positions{0};
+};
+
+enum AgentState { NeverAttached, Attached, Detached };
+Q_DECLARE_METATYPE(AgentState)
+
+void tst_Agent::loop_data()
+{
+    QTest::addColumn<AgentState>("state");
+
+    QTest::newRow("never attached") << NeverAttached;
+    QTest::newRow("attached")       << Attached;
+    QTest::newRow("detached")       << Detached;
+}
+
+void tst_Agent::loop()
+{
+    QFETCH(AgentState, state);
+
+    QScriptEngine engine;
+    NullAgent agent(&engine);
+    if (state != NeverAttached)
+    {
+        engine.setAgent(&agent);
+    }
+    if (state == Detached)
+    {
+        engine.setAgent(nullptr);
+    }
+
+    const QScriptProgram program(QStringLiteral("function add(a, b) { return a + b; }\n"
+                                                "var s = 0;\n"
+                                                "for (var i = 0; i < 200000; ++i)\n"
+                                                "    s = add(s, i) | 0;\n"
+                                                "s"));
+    QVERIFY(!engine.evaluate(program).isError());
+
+    // 卸载之后不应该再收到回调
+    if (state != Attached)
+    {
+        QCOMPARE(agent.positions, qint64(0));
+    }
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+
+    engine.setAgent(nullptr);
+}
+
+QTEST_GUILESS_MAIN(tst_Agent)
+
+#include "tst_bench_agent.moc"
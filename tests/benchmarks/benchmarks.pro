@@ -0,0 +1,20 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    qscriptprogram \
+    modulecache \
+    dispatch \
+    dispatch_fast \
+    agent \
+    siblings \
+    evaluateasync \
+    nativeprofiling \
+    nativecalls \
+    nativeargs \
+    typedfunctions \
+    callbatch \
+    qobjectwrap \
+    qobjectmethods \
+    qobjectproperties \
+    signals \
+    scriptclass
@@ -0,0 +1,90 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// 用同样的参数分别逐次 call() 和一次 callBatch()，对比每次调用都加锁、检查中断、
+// 构造参数列表的开销
+class tst_CallBatch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void call_data();
+    void call();
+
+private:
+    QVector<int> m_numbers;
+    QVector<QString> m_names;
+};
+
+enum Mode { Loop, Rows, Typed };
+
+void tst_CallBatch::initTestCase()
+{
+    for (int i = 0; i < 100000; ++i)
+    {
+        m_numbers << i;
+        m_names << QStringLiteral("name%1").arg(i);
+    }
+}
+
+void tst_CallBatch::call_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<int>("rows");
+
+    for (int rows : {100, 10000, 100000})
+    {
+        QTest::addRow("call() loop, %d rows", rows)          << int(Loop)  << rows;
+        QTest::addRow("callBatch(rows), %d rows", rows)      << int(Rows)  << rows;
+        QTest::addRow("callBatch(columns), %d rows", rows)   << int(Typed) << rows;
+    }
+}
+
+void tst_CallBatch::call()
+{
+    QFETCH(int, mode);
+    QFETCH(int, rows);
+
+    QScriptEngine engine;
+    QScriptValue f = engine.evaluate(QStringLiteral("(function (n, s) { return n + s.length; })"));
+
+    // 参数的准备不计入
+    QList<QVariantList> variantRows;
+    std::vector<int> numbers(m_numbers.begin(), m_numbers.begin() + rows);
+    std::vector<QString> names(m_names.begin(), m_names.begin() + rows);
+    if (mode == Rows)
+    {
+        variantRows.reserve(rows);
+        for (int i = 0; i < rows; ++i)
+            variantRows << (QVariantList() << m_numbers.at(i) << m_names.at(i));
+    }
+
+    int count = 0;
+    QBENCHMARK {
+        switch (mode)
+        {
+        case Loop:
+            for (int i = 0; i < rows; ++i)
+            {
+                const QScriptValue args[] = { QScriptValue(m_numbers.at(i)), QScriptValue(m_names.at(i)) };
+                f.call(QScriptValue(), args, 2);
+            }
+            count = rows;
+            break;
+        case Rows:
+            count = f.callBatch(QScriptValue(), variantRows).size();
+            break;
+        case Typed:
+            count = f.callBatch(QScriptValue(), nullptr, numbers, names).size();
+            break;
+        }
+    }
+    QCOMPARE(count, rows);
+}
+
+QTEST_GUILESS_MAIN(tst_CallBatch)
+
+#include "tst_bench_callbatch.moc"
@@ -0,0 +1,56 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// 解释器指令分派的开销：没有agent，只执行纯脚本
+// 同一份源码分别编译成 tst_bench_dispatch（switch 分派）和 tst_bench_dispatch_fast（qscript_fast_dispatch，computed goto）
+class tst_Dispatch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void script_data();
+    void script();
+};
+
+void tst_Dispatch::initTestCase()
+{
+#ifdef QSCRIPT_FAST_DISPATCH
+    qDebug("dispatch: computed goto (qscript_fast_dispatch)");
+#else
+    qDebug("dispatch: switch");
+#endif
+}
+
+void tst_Dispatch::script_data()
+{
+    QTest::addColumn<QString>("program");
+
+    QTest::newRow("arithmetic loop")
+        << QStringLiteral("var s = 0; for (var i = 0; i < 1000000; ++i) s = (s + i * 3) | 0; s");
+    QTest::newRow("function calls")
+        << QStringLiteral("function add(a, b) { return a + b; } var s = 0; for (var i = 0; i < 300000; ++i) s = add(s, i) | 0; s");
+    QTest::newRow("property access")
+        << QStringLiteral("var o = { x: 1, y: 2 }; for (var i = 0; i < 500000; ++i) { o.x = o.y + i; o.y = o.x & 255; } o.y");
+    QTest::newRow("array fill and sum")
+        << QStringLiteral("var a = []; for (var i = 0; i < 200000; ++i) a.push(i); var s = 0; for (var j = 0; j < a.length; ++j) s += a[j]; s");
+}
+
+void tst_Dispatch::script()
+{
+    QFETCH(QString, program);
+
+    QScriptEngine engine;
+    const QScriptProgram compiled(program);
+    QVERIFY(!engine.evaluate(compiled).isError());
+
+    QBENCHMARK {
+        engine.evaluate(compiled);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_Dispatch)
+
+#include "tst_bench_dispatch.moc"
@@ -0,0 +1,9 @@
+# 与 dispatch 是同一个基准测试，只是以 qscript_fast_dispatch 编译（computed goto 分派），两者的结果直接对比
+CONFIG += qscript_fast_dispatch
+
+include(../../tests.pri)
+
+CONFIG += benchmark
+
+TARGET = tst_bench_dispatch_fast
+SOURCES += ../dispatch/tst_bench_dispatch.cpp
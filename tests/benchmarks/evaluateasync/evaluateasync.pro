@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+CONFIG += benchmark
+
+TARGET = tst_bench_evaluateasync
+SOURCES += tst_bench_evaluateasync.cpp
@@ -0,0 +1,66 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// evaluateAsync 的吞吐量：一次提交一批小脚本，等全部完成，与在调用线程中逐个 evaluate 的对比
+// 差值就是排队、线程切换和 QFuture 的开销
+class tst_EvaluateAsync : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void throughput_data();
+    void throughput();
+};
+
+void tst_EvaluateAsync::throughput_data()
+{
+    QTest::addColumn<bool>("async");
+    QTest::addColumn<int>("jobs");
+
+    QTest::newRow("evaluate 100")      << false << 100;
+    QTest::newRow("evaluateAsync 100") << true  << 100;
+    QTest::newRow("evaluate 1000")     << false << 1000;
+    QTest::newRow("evaluateAsync 1000") << true << 1000;
+}
+
+void tst_EvaluateAsync::throughput()
+{
+    QFETCH(bool, async);
+    QFETCH(int, jobs);
+
+    QScriptEngine engine;
+    const QScriptProgram program(QStringLiteral("var s = 0; for (var i = 0; i < 100; ++i) s += i; s"));
+    // 工作线程在第一次 evaluateAsync 时创建，不计入
+    QCOMPARE(engine.evaluateAsync(program).result().toInt32(), 4950);
+
+    QList<QFuture<QScriptValue>> futures;
+    futures.reserve(jobs);
+
+    QBENCHMARK {
+        if (async)
+        {
+            futures.clear();
+            for (int i = 0; i < jobs; ++i)
+            {
+                futures.append(engine.evaluateAsync(program));
+            }
+            for (QFuture<QScriptValue> &future : futures)
+            {
+                future.waitForFinished();
+            }
+        }
+        else
+        {
+            for (int i = 0; i < jobs; ++i)
+            {
+                engine.evaluate(program);
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_EvaluateAsync)
+
+#include "tst_bench_evaluateasync.moc"
@@ -0,0 +1,93 @@
+﻿#include <QtTest>
+#include <QTemporaryDir>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// 文件模块的加载：每次都解析源码，与 setModuleCacheDirectory() 之后从磁盘上的字节码缓存读取的对比
+// 每次迭代都用一个新的引擎，模块在引擎内只会加载一次
+class tst_ModuleCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void loadModule_data();
+    void loadModule();
+
+private:
+    QTemporaryDir m_root;
+    QString m_previousCurrent;
+};
+
+static const char s_moduleName[] = "bench_module.js";
+
+static QByteArray makeModule(int bytes)
+{
+    QByteArray source;
+    int i = 0;
+    while (source.size() < bytes)
+    {
+        source += "export function f" + QByteArray::number(i++)
+                  + "(a, b) { var s = 0; for (var k = 0; k < 3; ++k) s += a * k + b; return s; }\n";
+    }
+    return source;
+}
+
+// 模块加载器在当前目录的上两级查找文件，因此在临时目录下建两层子目录作为当前目录
+void tst_ModuleCache::initTestCase()
+{
+    QVERIFY(m_root.isValid());
+    QVERIFY(QDir(m_root.path()).mkpath(QStringLiteral("work/dir")));
+    QVERIFY(QDir(m_root.path()).mkpath(QStringLiteral("cache")));
+
+    QFile module(QDir(m_root.path()).filePath(QLatin1String(s_moduleName)));
+    QVERIFY(module.open(QIODevice::WriteOnly));
+    module.write(makeModule(256 * 1024));
+    module.close();
+
+    m_previousCurrent = QDir::currentPath();
+    QVERIFY(QDir::setCurrent(QDir(m_root.path()).filePath(QStringLiteral("work/dir"))));
+}
+
+void tst_ModuleCache::cleanupTestCase()
+{
+    QDir::setCurrent(m_previousCurrent);
+}
+
+void tst_ModuleCache::loadModule_data()
+{
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("source")   << false;
+    QTest::newRow("bytecode") << true;
+}
+
+void tst_ModuleCache::loadModule()
+{
+    QFETCH(bool, cached);
+
+    const QString cacheDir = cached ? QDir(m_root.path()).filePath(QStringLiteral("cache")) : QString();
+    const QString program = QStringLiteral("var ok = false; import('%1').then(function (m) { ok = m.f0(1, 2) === 9; });")
+                                .arg(QLatin1String(s_moduleName));
+
+    // 先加载一次，既检查模块能正常使用，也把缓存文件写好
+    {
+        QScriptEngine engine;
+        engine.setModuleCacheDirectory(cacheDir);
+        engine.evaluate(program);
+        QVERIFY(engine.evaluate(QStringLiteral("ok")).toBool());
+    }
+
+    QBENCHMARK {
+        QScriptEngine engine;
+        engine.setModuleCacheDirectory(cacheDir);
+        engine.evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_ModuleCache)
+
+#include "tst_bench_modulecache.moc"
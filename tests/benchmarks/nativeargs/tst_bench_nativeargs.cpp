@@ -0,0 +1,120 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptContext>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+// 原生函数每次调用的开销随参数个数（0到8个）的变化
+// context：只构造 QScriptContext，对比复制参数（每个参数 JS_DupValue/JS_FreeValue）和借用参数两种模式
+// call：脚本调用原生函数的完整路径，nativeFunctionShim 使用借用参数的上下文
+class tst_NativeArgs : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void context_data();
+    void context();
+    void call_data();
+    void call();
+};
+
+enum { MaxArguments = 8 };
+
+static QScriptValue argumentCount(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(engine);
+    return QScriptValue(context->argumentCount());
+}
+
+void tst_NativeArgs::context_data()
+{
+    QTest::addColumn<int>("argc");
+    QTest::addColumn<bool>("borrow");
+
+    for (int argc = 0; argc <= MaxArguments; ++argc)
+    {
+        QTest::addRow("%d args, copied", argc)   << argc << false;
+        QTest::addRow("%d args, borrowed", argc) << argc << true;
+    }
+}
+
+// 参数用对象，复制模式下每个参数都有真实的引用计数操作
+void tst_NativeArgs::context()
+{
+    QFETCH(int, argc);
+    QFETCH(bool, borrow);
+
+    QScriptEngine engine;
+    JSContext *ctx = engine.ctx();
+
+    JSValue argv[MaxArguments];
+    for (int i = 0; i < MaxArguments; ++i)
+    {
+        argv[i] = JS_NewObject(ctx);
+    }
+    JSValue thisObject = JS_NewObject(ctx);
+
+    int total = 0;
+    QBENCHMARK {
+        for (int n = 0; n < 10000; ++n)
+        {
+            if (borrow)
+            {
+                QScriptContext context(QScriptContext::BorrowArguments, ctx, thisObject, argc, argv, &engine, JS_UNDEFINED);
+                total += context.argumentCount();
+            }
+            else
+            {
+                QScriptContext context(ctx, thisObject, argc, argv, &engine, JS_UNDEFINED);
+                total += context.argumentCount();
+            }
+        }
+    }
+    QVERIFY(total % 10000 == 0);
+
+    JS_FreeValue(ctx, thisObject);
+    for (int i = 0; i < MaxArguments; ++i)
+    {
+        JS_FreeValue(ctx, argv[i]);
+    }
+}
+
+void tst_NativeArgs::call_data()
+{
+    QTest::addColumn<int>("argc");
+
+    for (int argc = 0; argc <= MaxArguments; ++argc)
+    {
+        QTest::addRow("%d args", argc) << argc;
+    }
+}
+
+// 每轮调用 100000 次
+void tst_NativeArgs::call()
+{
+    QFETCH(int, argc);
+
+    QScriptEngine engine;
+    engine.globalObject().setProperty(QStringLiteral("argumentCount"), engine.newFunction(argumentCount));
+
+    QStringList args;
+    for (int i = 0; i < argc; ++i)
+    {
+        args << QStringLiteral("o");
+    }
+    const QScriptProgram program(QStringLiteral(
+        "var o = {}; var n = 0; for (var i = 0; i < 100000; ++i) n += argumentCount(%1); n").arg(args.join(QLatin1Char(','))));
+    QCOMPARE(engine.evaluate(program).toInt32(), 100000 * argc);
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_NativeArgs)
+
+#include "tst_bench_nativeargs.moc"
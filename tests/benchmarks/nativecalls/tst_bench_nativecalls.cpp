@@ -0,0 +1,85 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptContext>
+
+// 原生函数调用的吞吐量：函数对象直接持有表项指针，调用时不加锁、不查表，
+// 注册了多少个函数（分布在多少个段中）都不影响调用开销
+class tst_NativeCalls : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void call_data();
+    void call();
+    void registration();
+};
+
+static QScriptValue nop(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(context);
+    Q_UNUSED(engine);
+    return QScriptValue();
+}
+
+static QScriptValue nopWithArg(QScriptContext *context, QScriptEngine *engine, void *arg)
+{
+    Q_UNUSED(context);
+    Q_UNUSED(engine);
+    Q_UNUSED(arg);
+    return QScriptValue();
+}
+
+void tst_NativeCalls::call_data()
+{
+    QTest::addColumn<int>("registered");
+    QTest::addColumn<bool>("roundRobin");
+
+    QTest::newRow("1 function")                 << 1      << false;
+    QTest::newRow("1024 functions, last")       << 1024   << false;
+    QTest::newRow("100000 functions, last")     << 100000 << false;
+    QTest::newRow("1024 functions, round robin") << 1024  << true;
+    QTest::newRow("100000 functions, round robin") << 100000 << true;
+}
+
+// 每轮调用 100000 次
+void tst_NativeCalls::call()
+{
+    QFETCH(int, registered);
+    QFETCH(bool, roundRobin);
+
+    QScriptEngine engine;
+    QScriptValue functions = engine.newArray(uint(registered));
+    for (int i = 0; i < registered; ++i)
+    {
+        functions.setProperty(quint32(i), engine.newFunction(nop));
+    }
+    engine.globalObject().setProperty(QStringLiteral("functions"), functions);
+
+    const QScriptProgram program(roundRobin
+        ? QStringLiteral("var n = functions.length; for (var i = 0; i < 100000; ++i) functions[i % n]();")
+        : QStringLiteral("var f = functions[functions.length - 1]; for (var i = 0; i < 100000; ++i) f();"));
+    QVERIFY(!engine.evaluate(program).isError());
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+// 注册 10000 个函数，表按段增长，已有的表项不会被移动
+void tst_NativeCalls::registration()
+{
+    QScriptEngine engine;
+
+    QBENCHMARK {
+        for (int i = 0; i < 10000; ++i)
+        {
+            engine.newFunction(nopWithArg, reinterpret_cast<void *>(quintptr(i)));
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_NativeCalls)
+
+#include "tst_bench_nativecalls.moc"
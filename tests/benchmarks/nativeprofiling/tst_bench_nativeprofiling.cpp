@@ -0,0 +1,49 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptContext>
+
+// 原生函数调用的开销：统计关闭（只多读一个标志）和打开（两次读时钟加原子计数）的对比
+class tst_NativeProfiling : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void call_data();
+    void call();
+};
+
+static QScriptValue nop(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(context);
+    Q_UNUSED(engine);
+    return QScriptValue();
+}
+
+void tst_NativeProfiling::call_data()
+{
+    QTest::addColumn<bool>("profiling");
+
+    QTest::newRow("profiling off") << false;
+    QTest::newRow("profiling on")  << true;
+}
+
+void tst_NativeProfiling::call()
+{
+    QFETCH(bool, profiling);
+
+    QScriptEngine engine;
+    engine.setNativeProfilingEnabled(profiling);
+    engine.globalObject().setProperty(QStringLiteral("nop"), engine.newFunction(nop, 0, QStringLiteral("nop")));
+    const QScriptProgram program(QStringLiteral("for (var i = 0; i < 100000; ++i) nop();"));
+    engine.evaluate(program);
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_NativeProfiling)
+
+#include "tst_bench_nativeprofiling.moc"
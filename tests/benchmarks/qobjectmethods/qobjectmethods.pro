@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+CONFIG += benchmark
+
+TARGET = tst_bench_qobjectmethods
+SOURCES += tst_bench_qobjectmethods.cpp
@@ -0,0 +1,62 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// 从脚本调用 QObject 方法的开销，按参数和返回值的类型分开
+class Target : public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE void noArguments() {}
+    Q_INVOKABLE int addInt(int value) { return value + 1; }
+    Q_INVOKABLE double addDouble(double value) { return value + 0.5; }
+    Q_INVOKABLE QString echo(const QString &text) { return text; }
+    Q_INVOKABLE QObject *same(QObject *object) { return object; }
+    Q_INVOKABLE int mixed(int a, double b, const QString &c, QObject *d) { return a + int(b) + c.size() + (d ? 1 : 0); }
+};
+
+class tst_QObjectMethods : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void call_data();
+    void call();
+};
+
+void tst_QObjectMethods::call_data()
+{
+    QTest::addColumn<QString>("call");
+
+    QTest::newRow("void()")                              << QStringLiteral("target.noArguments()");
+    QTest::newRow("int(int)")                            << QStringLiteral("target.addInt(i)");
+    QTest::newRow("double(double)")                      << QStringLiteral("target.addDouble(i)");
+    QTest::newRow("QString(QString)")                    << QStringLiteral("target.echo('text')");
+    QTest::newRow("QObject*(QObject*)")                  << QStringLiteral("target.same(other)");
+    QTest::newRow("int(int, double, QString, QObject*)") << QStringLiteral("target.mixed(i, 1.5, 'text', other)");
+}
+
+// 每轮调用 100000 次
+void tst_QObjectMethods::call()
+{
+    QFETCH(QString, call);
+
+    QScriptEngine engine;
+    Target target;
+    Target other;
+    engine.globalObject().setProperty(QStringLiteral("target"), engine.newQObject(&target));
+    engine.globalObject().setProperty(QStringLiteral("other"), engine.newQObject(&other));
+
+    const QScriptProgram program(QStringLiteral("var r; for (var i = 0; i < 100000; ++i) r = %1; r").arg(call));
+    engine.evaluate(program);
+    QVERIFY(!engine.hasUncaughtException());
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_QObjectMethods)
+
+#include "tst_bench_qobjectmethods.moc"
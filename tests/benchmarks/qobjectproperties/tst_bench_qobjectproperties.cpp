@@ -0,0 +1,106 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// 从脚本读写 QObject 属性的开销：int、double、bool、QString、qlonglong 直接读写，
+// uint 和枚举经过 QVariant，作为对照
+class Props : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int intValue MEMBER m_int)
+    Q_PROPERTY(double doubleValue MEMBER m_double)
+    Q_PROPERTY(bool boolValue MEMBER m_bool)
+    Q_PROPERTY(QString stringValue MEMBER m_string)
+    Q_PROPERTY(qlonglong longValue MEMBER m_long)
+    Q_PROPERTY(uint uintValue MEMBER m_uint)
+    Q_PROPERTY(Color color MEMBER m_color)
+
+public:
+    enum Color { Red, Green, Blue };
+    Q_ENUM(Color)
+
+    int m_int{1};
+    double m_double{1.5};
+    bool m_bool{true};
+    QString m_string{QStringLiteral("text")};
+    qlonglong m_long{1};
+    uint m_uint{1};
+    Color m_color{Green};
+};
+
+class tst_QObjectProperties : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void get_data();
+    void get();
+    void set_data();
+    void set();
+};
+
+// value 是写入时的右值，读取时不用
+static void addRows()
+{
+    QTest::addColumn<QString>("property");
+    QTest::addColumn<QString>("value");
+    QTest::newRow("int")                << QStringLiteral("intValue")    << QStringLiteral("i");
+    QTest::newRow("double")             << QStringLiteral("doubleValue") << QStringLiteral("i + 0.5");
+    QTest::newRow("bool")               << QStringLiteral("boolValue")   << QStringLiteral("(i & 1) === 0");
+    QTest::newRow("QString")            << QStringLiteral("stringValue") << QStringLiteral("'text'");
+    QTest::newRow("qlonglong")          << QStringLiteral("longValue")   << QStringLiteral("i * 4096");
+    QTest::newRow("uint (QVariant)")    << QStringLiteral("uintValue")   << QStringLiteral("i");
+    QTest::newRow("enum (QVariant)")    << QStringLiteral("color")       << QStringLiteral("i % 3");
+}
+
+void tst_QObjectProperties::get_data()
+{
+    addRows();
+}
+
+// 每轮读取 100000 次
+void tst_QObjectProperties::get()
+{
+    QFETCH(QString, property);
+
+    QScriptEngine engine;
+    Props props;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(&props));
+
+    const QScriptProgram program(QStringLiteral("var r; for (var i = 0; i < 100000; ++i) r = o.%1; r").arg(property));
+    engine.evaluate(program);
+    QVERIFY(!engine.hasUncaughtException());
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+void tst_QObjectProperties::set_data()
+{
+    addRows();
+}
+
+// 每轮写入 100000 次
+void tst_QObjectProperties::set()
+{
+    QFETCH(QString, property);
+    QFETCH(QString, value);
+
+    QScriptEngine engine;
+    Props props;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(&props));
+
+    const QScriptProgram program(QStringLiteral("for (var i = 0; i < 100000; ++i) o.%1 = %2;").arg(property, value));
+    engine.evaluate(program);
+    QVERIFY(!engine.hasUncaughtException());
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_QObjectProperties)
+
+#include "tst_bench_qobjectproperties.moc"
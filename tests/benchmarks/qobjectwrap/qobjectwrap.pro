@@ -0,0 +1,8 @@
+include(../../tests.pri)
+
+CONFIG += benchmark
+# 用 QMetaObjectBuilder 生成不同大小的元对象
+QT += core-private
+
+TARGET = tst_bench_qobjectwrap
+SOURCES += tst_bench_qobjectwrap.cpp
@@ -0,0 +1,222 @@
+﻿#include <QtTest>
+#include <private/qmetaobjectbuilder_p.h>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+extern "C" {
+#include "quickjs.h"
+}
+
+#include <cstdlib>
+#include <memory>
+
+// 包装 QObject 的时间和内存：成员在第一次访问时才解析，
+// 第一次包装某个类和之后的包装都不应该随元对象的大小增长；
+// 成员解析后按名字缓存，查找和调用也不随元对象的大小增长
+class tst_QObjectWrap : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void wrap_data();
+    void wrap();
+    void memory_data();
+    void memory();
+    void lookup_data();
+    void lookup();
+
+private:
+    QMetaObject *metaObjectWith(int methods) const;
+
+    QMap<int, QMetaObject*> m_metaObjects;
+};
+
+// 元对象在运行时生成，方法 mN 返回 N，属性 pN 的值是 N
+class Generated : public QObject
+{
+public:
+    explicit Generated(const QMetaObject *metaObject) : m_metaObject(metaObject) {}
+
+    const QMetaObject *metaObject() const override { return m_metaObject; }
+
+    int qt_metacall(QMetaObject::Call call, int id, void **args) override
+    {
+        id = QObject::qt_metacall(call, id, args);
+        if (id < 0)
+            return id;
+        switch (call)
+        {
+        case QMetaObject::InvokeMetaMethod:
+        case QMetaObject::ReadProperty:
+            if (args[0])
+                *static_cast<int *>(args[0]) = id;
+            return -1;
+        case QMetaObject::WriteProperty:
+            return -1;
+        default:
+            return id;
+        }
+    }
+
+private:
+    const QMetaObject *m_metaObject;
+};
+
+static const int s_methodCounts[] = { 0, 100, 10000 };
+
+void tst_QObjectWrap::initTestCase()
+{
+    for (int methods : s_methodCounts)
+    {
+        QMetaObjectBuilder builder;
+        builder.setClassName("Generated" + QByteArray::number(methods));
+        builder.setSuperClass(&QObject::staticMetaObject);
+        for (int i = 0; i < methods; ++i)
+        {
+            builder.addMethod("m" + QByteArray::number(i) + "(int)", "int");
+            builder.addProperty("p" + QByteArray::number(i), "int");
+        }
+        m_metaObjects.insert(methods, builder.toMetaObject());
+    }
+}
+
+void tst_QObjectWrap::cleanupTestCase()
+{
+    for (QMetaObject *metaObject : qAsConst(m_metaObjects))
+        std::free(metaObject);
+    m_metaObjects.clear();
+}
+
+QMetaObject *tst_QObjectWrap::metaObjectWith(int methods) const
+{
+    return m_metaObjects.value(methods);
+}
+
+enum Mode { EngineOnly, FirstWrap, Wrap, WrapExisting };
+
+void tst_QObjectWrap::wrap_data()
+{
+    QTest::addColumn<int>("methods");
+    QTest::addColumn<int>("mode");
+
+    // 第一次包装的成本等于 "first wrap" 减去 "engine only"
+    QTest::newRow("engine only") << 0 << int(EngineOnly);
+    for (int methods : s_methodCounts)
+    {
+        QTest::addRow("first wrap, %d methods+properties", methods)     << methods << int(FirstWrap);
+        QTest::addRow("wrap, %d methods+properties", methods)           << methods << int(Wrap);
+        QTest::addRow("wrap existing, %d methods+properties", methods)  << methods << int(WrapExisting);
+    }
+}
+
+// 每轮包装 1000 个对象（第一次包装的行只包装 1 个）
+void tst_QObjectWrap::wrap()
+{
+    QFETCH(int, methods);
+    QFETCH(int, mode);
+
+    std::vector<std::unique_ptr<Generated>> objects;
+    for (int i = 0; i < 1000; ++i)
+        objects.emplace_back(new Generated(metaObjectWith(methods)));
+
+    if (mode == EngineOnly || mode == FirstWrap)
+    {
+        QBENCHMARK {
+            QScriptEngine engine;
+            if (mode == FirstWrap)
+                engine.newQObject(objects.front().get());
+        }
+        return;
+    }
+
+    const QScriptEngine::QObjectWrapOptions options =
+        mode == WrapExisting ? QScriptEngine::PreferExistingWrapperObject : QScriptEngine::QObjectWrapOptions();
+    QScriptEngine engine;
+    QScriptValueList wrappers;
+    for (const auto &object : objects)
+        wrappers << engine.newQObject(object.get(), QScriptEngine::QtOwnership, options);
+
+    QBENCHMARK {
+        for (const auto &object : objects)
+            engine.newQObject(object.get(), QScriptEngine::QtOwnership, options);
+    }
+}
+
+void tst_QObjectWrap::memory_data()
+{
+    QTest::addColumn<int>("methods");
+
+    for (int methods : s_methodCounts)
+        QTest::addRow("%d methods+properties", methods) << methods;
+}
+
+// 报告的是 1000 个包装对象（以及同一个类的绑定）占用的JS堆内存
+void tst_QObjectWrap::memory()
+{
+    QFETCH(int, methods);
+
+    std::vector<std::unique_ptr<Generated>> objects;
+    for (int i = 0; i < 1000; ++i)
+        objects.emplace_back(new Generated(metaObjectWith(methods)));
+
+    QScriptEngine engine;
+    engine.collectGarbage();
+    JSMemoryUsage before;
+    JS_ComputeMemoryUsage(engine.runtime(), &before);
+
+    QScriptValueList wrappers;
+    for (const auto &object : objects)
+        wrappers << engine.newQObject(object.get());
+
+    JSMemoryUsage after;
+    JS_ComputeMemoryUsage(engine.runtime(), &after);
+    QTest::setBenchmarkResult(qreal(after.malloc_size - before.malloc_size), QTest::BytesAllocated);
+}
+
+void tst_QObjectWrap::lookup_data()
+{
+    QTest::addColumn<int>("methods");
+    QTest::addColumn<QString>("expression");
+
+    for (int methods : s_methodCounts)
+    {
+        if (methods == 0)
+        {
+            QTest::newRow("0 methods+properties, objectName") << methods << QStringLiteral("o.objectName");
+            continue;
+        }
+        const int last = methods - 1;
+        QTest::addRow("%d methods+properties, first method", methods)   << methods << QStringLiteral("o.m0");
+        QTest::addRow("%d methods+properties, last method", methods)    << methods << QStringLiteral("o.m%1").arg(last);
+        QTest::addRow("%d methods+properties, call last", methods)      << methods << QStringLiteral("o.m%1(i)").arg(last);
+        QTest::addRow("%d methods+properties, first property", methods) << methods << QStringLiteral("o.p0");
+        QTest::addRow("%d methods+properties, last property", methods)  << methods << QStringLiteral("o.p%1").arg(last);
+        QTest::addRow("%d methods+properties, missing", methods)        << methods << QStringLiteral("o.missing");
+    }
+}
+
+// 每轮访问 100000 次；第一次解析成员在计时之前
+void tst_QObjectWrap::lookup()
+{
+    QFETCH(int, methods);
+    QFETCH(QString, expression);
+
+    Generated object(metaObjectWith(methods));
+    QScriptEngine engine;
+    engine.globalObject().setProperty(QStringLiteral("o"), engine.newQObject(&object));
+
+    const QScriptProgram program(QStringLiteral("var r; for (var i = 0; i < 100000; ++i) r = %1; r").arg(expression));
+    engine.evaluate(program);
+    QVERIFY(!engine.hasUncaughtException());
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_QObjectWrap)
+
+#include "tst_bench_qobjectwrap.moc"
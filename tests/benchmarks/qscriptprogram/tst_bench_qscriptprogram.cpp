@@ -0,0 +1,105 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptProgram>
+#include <QScriptValue>
+
+// 同一段源码反复执行：每次都传字符串（每次重新解析、编译）与 QScriptProgram（只编译一次）的对比
+// 源码大小从1KB到1MB，解析的开销随大小线性增长，执行的部分保持很小
+class tst_QScriptProgram : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void evaluateString_data();
+    void evaluateString();
+    void evaluateProgram_data();
+    void evaluateProgram();
+    void evaluateProgramInSibling_data();
+    void evaluateProgramInSibling();
+};
+
+// 大量的小函数加一行顶层调用，接近真实脚本的解析负担
+static QString makeSource(int bytes)
+{
+    QString source;
+    source.reserve(bytes + 128);
+    int i = 0;
+    while (source.size() < bytes)
+    {
+        source += QStringLiteral("function f%1(a, b) { var s = 0; for (var k = 0; k < 3; ++k) s += a * k + b; return s; }\n").arg(i++);
+    }
+    source += QStringLiteral("f0(1, 2);\n");
+    return source;
+}
+
+static void addSizes()
+{
+    QTest::addColumn<int>("bytes");
+
+    QTest::newRow("1KB")   << 1024;
+    QTest::newRow("16KB")  << 16 * 1024;
+    QTest::newRow("256KB") << 256 * 1024;
+    QTest::newRow("1MB")   << 1024 * 1024;
+}
+
+void tst_QScriptProgram::evaluateString_data()
+{
+    addSizes();
+}
+
+void tst_QScriptProgram::evaluateString()
+{
+    QFETCH(int, bytes);
+
+    QScriptEngine engine;
+    const QString source = makeSource(bytes);
+    QCOMPARE(engine.evaluate(source).toInt32(), 9);
+
+    QBENCHMARK {
+        engine.evaluate(source);
+    }
+}
+
+void tst_QScriptProgram::evaluateProgram_data()
+{
+    addSizes();
+}
+
+void tst_QScriptProgram::evaluateProgram()
+{
+    QFETCH(int, bytes);
+
+    QScriptEngine engine;
+    const QScriptProgram program(makeSource(bytes), QStringLiteral("bench.js"));
+    // 第一次执行时编译，不计入
+    QCOMPARE(engine.evaluate(program).toInt32(), 9);
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+// 在另一个引擎中第一次执行：从序列化的字节码实例化，不重新解析源码
+void tst_QScriptProgram::evaluateProgramInSibling_data()
+{
+    addSizes();
+}
+
+void tst_QScriptProgram::evaluateProgramInSibling()
+{
+    QFETCH(int, bytes);
+
+    QScriptEngine engine;
+    const QScriptProgram program(makeSource(bytes), QStringLiteral("bench.js"));
+    QCOMPARE(engine.evaluate(program).toInt32(), 9);
+
+    QBENCHMARK {
+        QScopedPointer<QScriptEngine> sibling(engine.createSiblingEngine());
+        sibling->evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_QScriptProgram)
+
+#include "tst_bench_qscriptprogram.moc"
@@ -0,0 +1,127 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptClass>
+#include <QScriptString>
+
+#include <memory>
+
+// 100 万项的 C++ 映射表：用 QScriptClass 在访问时查询，和事先复制成JS对象比较
+// 创建的开销、每次查找的开销
+class MapClass : public QScriptClass
+{
+public:
+    MapClass(QScriptEngine *engine, const QHash<QString, int> *map) : QScriptClass(engine), m_map(map) {}
+
+    QueryFlags queryProperty(const QScriptValue &object, const QScriptString &name,
+                             QueryFlags flags, uint *id) override
+    {
+        Q_UNUSED(object);
+        Q_UNUSED(id);
+        return m_map->contains(name.toString()) ? (flags & HandlesReadAccess) : QueryFlags();
+    }
+
+    QScriptValue property(const QScriptValue &object, const QScriptString &name, uint id) override
+    {
+        Q_UNUSED(object);
+        Q_UNUSED(id);
+        return QScriptValue(m_map->value(name.toString()));
+    }
+
+private:
+    const QHash<QString, int> *m_map;
+};
+
+class tst_ScriptClass : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void create_data();
+    void create();
+    void lookup_data();
+    void lookup();
+
+private:
+    QHash<QString, int> m_map;
+};
+
+static const int s_entries = 1000000;
+
+void tst_ScriptClass::initTestCase()
+{
+    m_map.reserve(s_entries);
+    for (int i = 0; i < s_entries; ++i)
+        m_map.insert(QStringLiteral("k%1").arg(i), i);
+}
+
+// 把映射表复制成普通的JS对象
+static QScriptValue materialize(QScriptEngine &engine, const QHash<QString, int> &map)
+{
+    QScriptValue object = engine.newObject();
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it)
+        object.setProperty(it.key(), QScriptValue(it.value()));
+    return object;
+}
+
+void tst_ScriptClass::create_data()
+{
+    QTest::addColumn<bool>("lazy");
+
+    QTest::newRow("QScriptClass") << true;
+    QTest::newRow("materialized") << false;
+}
+
+void tst_ScriptClass::create()
+{
+    QFETCH(bool, lazy);
+
+    QScriptEngine *engine = new QScriptEngine;
+    MapClass mapClass(engine, &m_map);
+    std::unique_ptr<QScriptEngine> engineOwner(engine);
+
+    QBENCHMARK_ONCE {
+        QScriptValue object = lazy ? engine->newObject(&mapClass) : materialize(*engine, m_map);
+        engine->globalObject().setProperty(QStringLiteral("m"), object);
+    }
+    QCOMPARE(engine->evaluate(QStringLiteral("m.k999999")).toInt32(), 999999);
+}
+
+void tst_ScriptClass::lookup_data()
+{
+    QTest::addColumn<bool>("lazy");
+    QTest::addColumn<QString>("key");
+
+    QTest::newRow("QScriptClass, fixed key")    << true  << QStringLiteral("'k123456'");
+    QTest::newRow("materialized, fixed key")    << false << QStringLiteral("'k123456'");
+    QTest::newRow("QScriptClass, varying keys") << true  << QStringLiteral("'k' + (i * 7919 % 1000000)");
+    QTest::newRow("materialized, varying keys") << false << QStringLiteral("'k' + (i * 7919 % 1000000)");
+    QTest::newRow("QScriptClass, missing key")  << true  << QStringLiteral("'missing'");
+    QTest::newRow("materialized, missing key")  << false << QStringLiteral("'missing'");
+}
+
+// 每轮查找 100000 次，对象的创建不计入
+void tst_ScriptClass::lookup()
+{
+    QFETCH(bool, lazy);
+    QFETCH(QString, key);
+
+    QScriptEngine *engine = new QScriptEngine;
+    MapClass mapClass(engine, &m_map);
+    std::unique_ptr<QScriptEngine> engineOwner(engine);
+    engine->globalObject().setProperty(QStringLiteral("m"), lazy ? engine->newObject(&mapClass) : materialize(*engine, m_map));
+
+    const QScriptProgram program(QStringLiteral("var r; for (var i = 0; i < 100000; ++i) r = m[%1]; r").arg(key));
+    engine->evaluate(program);
+    QVERIFY(!engine->hasUncaughtException());
+
+    QBENCHMARK {
+        engine->evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_ScriptClass)
+
+#include "tst_bench_scriptclass.moc"
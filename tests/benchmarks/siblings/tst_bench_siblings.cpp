@@ -0,0 +1,52 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+// 创建独立的引擎（新的 JSRuntime）与创建共享runtime的兄弟引擎的开销对比
+class tst_Siblings : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void isolation();
+    void create_data();
+    void create();
+};
+
+// 兄弟引擎共享runtime，但全局对象各自独立
+void tst_Siblings::isolation()
+{
+    QScriptEngine engine;
+    QScopedPointer<QScriptEngine> sibling(engine.createSiblingEngine());
+    QVERIFY(sibling->sharesRuntimeWith(&engine));
+
+    engine.evaluate(QStringLiteral("var shared = 1;"));
+    QCOMPARE(sibling->evaluate(QStringLiteral("typeof shared")).toString(), QStringLiteral("undefined"));
+}
+
+void tst_Siblings::create_data()
+{
+    QTest::addColumn<bool>("sibling");
+
+    QTest::newRow("standalone") << false;
+    QTest::newRow("sibling")    << true;
+}
+
+// 创建引擎并执行一小段脚本，模拟“一个请求一个上下文”
+void tst_Siblings::create()
+{
+    QFETCH(bool, sibling);
+
+    QScriptEngine base;
+    const QString program = QStringLiteral("var o = { a: 1, b: [1, 2, 3] }; o.a + o.b.length");
+
+    QBENCHMARK {
+        QScopedPointer<QScriptEngine> engine(sibling ? base.createSiblingEngine() : new QScriptEngine);
+        engine->evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_Siblings)
+
+#include "tst_bench_siblings.moc"
@@ -0,0 +1,86 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+
+class Sender : public QObject
+{
+    Q_OBJECT
+public:
+    Q_INVOKABLE void fire(int value) { emit fired(value, m_text); }
+
+    QString m_text{QStringLiteral("text")};
+
+signals:
+    void fired(int value, const QString &text);
+};
+
+// 信号连接到脚本函数时每轮发射 10000 次的开销：
+// 同一线程直接执行，其它线程发射时逐个排队或者合并成一批
+class tst_Signals : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emission_data();
+    void emission();
+};
+
+enum Mode { Direct, FromScript, Queued, Coalesced };
+
+static const int s_emissions = 10000;
+
+void tst_Signals::emission_data()
+{
+    QTest::addColumn<int>("mode");
+
+    QTest::newRow("direct, emitted from C++")  << int(Direct);
+    QTest::newRow("direct, emitted by script") << int(FromScript);
+    QTest::newRow("queued from other thread")  << int(Queued);
+    QTest::newRow("queued, coalesced")         << int(Coalesced);
+}
+
+void tst_Signals::emission()
+{
+    QFETCH(int, mode);
+
+    QScriptEngine engine;
+    engine.setQueuedSignalCoalescingEnabled(mode == Coalesced);
+    Sender sender;
+    engine.globalObject().setProperty(QStringLiteral("sender"), engine.newQObject(&sender));
+    engine.evaluate(QStringLiteral("var count = 0; sender.fired.connect(function (v, t) { count += t.length; });"));
+    QVERIFY(!engine.hasUncaughtException());
+
+    const QScriptProgram program(QStringLiteral("for (var i = 0; i < %1; ++i) sender.fire(i);").arg(s_emissions));
+
+    QBENCHMARK {
+        switch (mode)
+        {
+        case Direct:
+            for (int i = 0; i < s_emissions; ++i)
+                sender.fire(i);
+            break;
+        case FromScript:
+            engine.evaluate(program);
+            break;
+        default: {
+            // 包括发射线程的启动和排队的事件全部处理完
+            QThread *thread = QThread::create([&sender]() {
+                for (int i = 0; i < s_emissions; ++i)
+                    sender.fire(i);
+            });
+            thread->start();
+            thread->wait();
+            delete thread;
+            QCoreApplication::sendPostedEvents();
+            break;
+        }
+        }
+    }
+
+    QVERIFY(engine.evaluate(QStringLiteral("count")).toInt32() >= s_emissions * 4);
+}
+
+QTEST_GUILESS_MAIN(tst_Signals)
+
+#include "tst_bench_signals.moc"
@@ -0,0 +1,102 @@
+﻿#include <QtTest>
+
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QScriptContext>
+
+// 同一个函数分别用通用签名（QScriptContext + QScriptValue 返回值）和类型化签名注册，
+// 对比参数和返回值转换的开销
+class tst_TypedFunctions : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void call_data();
+    void call();
+};
+
+static double typedAdd(double a, int b)
+{
+    return a + b;
+}
+
+static QScriptValue genericAdd(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(engine);
+    return QScriptValue(context->argument(0).toNumber() + context->argument(1).toInt32());
+}
+
+static double typedMix(double a, int b, QString c)
+{
+    return a * b + c.size();
+}
+
+static QScriptValue genericMix(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(engine);
+    return QScriptValue(context->argument(0).toNumber() * context->argument(1).toInt32()
+                        + context->argument(2).toString().size());
+}
+
+static QString typedGreet(QString name)
+{
+    return QStringLiteral("hello ") + name;
+}
+
+static QScriptValue genericGreet(QScriptContext *context, QScriptEngine *engine)
+{
+    Q_UNUSED(engine);
+    return QScriptValue(QStringLiteral("hello ") + context->argument(0).toString());
+}
+
+enum Function { Add, Mix, Greet };
+
+void tst_TypedFunctions::call_data()
+{
+    QTest::addColumn<int>("function");
+    QTest::addColumn<bool>("typed");
+    QTest::addColumn<QString>("call");
+
+    QTest::newRow("add(double, int), generic")          << int(Add)   << false << QStringLiteral("f(i, 2)");
+    QTest::newRow("add(double, int), typed")            << int(Add)   << true  << QStringLiteral("f(i, 2)");
+    QTest::newRow("mix(double, int, QString), generic") << int(Mix)   << false << QStringLiteral("f(i, 2, 'abc')");
+    QTest::newRow("mix(double, int, QString), typed")   << int(Mix)   << true  << QStringLiteral("f(i, 2, 'abc')");
+    QTest::newRow("greet(QString), generic")            << int(Greet) << false << QStringLiteral("f('world')");
+    QTest::newRow("greet(QString), typed")              << int(Greet) << true  << QStringLiteral("f('world')");
+}
+
+// 每轮调用 100000 次
+void tst_TypedFunctions::call()
+{
+    QFETCH(int, function);
+    QFETCH(bool, typed);
+    QFETCH(QString, call);
+
+    QScriptEngine engine;
+    QScriptValue f;
+    switch (function)
+    {
+    case Add:
+        f = typed ? engine.newFunction(typedAdd) : engine.newFunction(genericAdd);
+        break;
+    case Mix:
+        f = typed ? engine.newFunction(typedMix) : engine.newFunction(genericMix);
+        break;
+    default:
+        f = typed ? engine.newFunction(typedGreet) : engine.newFunction(genericGreet);
+        break;
+    }
+    engine.globalObject().setProperty(QStringLiteral("f"), f);
+
+    const QScriptProgram program(QStringLiteral("var r; for (var i = 0; i < 100000; ++i) r = %1; r").arg(call));
+    engine.evaluate(program);
+    QVERIFY(!engine.hasUncaughtException());
+
+    QBENCHMARK {
+        engine.evaluate(program);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_TypedFunctions)
+
+#include "tst_bench_typedfunctions.moc"
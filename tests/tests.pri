@@ -0,0 +1,10 @@
+# 测试共用的设置，每个测试程序直接把引擎的源码编译进去，与示例程序使用 ScriptEngine.pri 的方式相同
+TEMPLATE = app
+
+QT += testlib
+QT -= gui
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+include($$PWD/../src/QScriptEngine/ScriptEngine.pri)
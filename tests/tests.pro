@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+# auto 下是功能测试，用 make check 运行；benchmarks 下是基准测试，用 make benchmark 运行
+SUBDIRS += \
+    auto \
+    benchmarks